@@ -0,0 +1,87 @@
+/* Copyright (C) 2026 RZ781
+ *
+ * This file is part of libcitrus.
+ *
+ * libcitrus is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 2.1 of the License, or (at your option)
+ * any later version.
+ *
+ * libcitrus is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// Benchmark for the parallel bot. The same game is played with 1, 2, 4, ...
+// up to the given number of threads, and the time per move is reported
+// along with the speedup over one thread.
+//
+// usage: bot_bench [threads] [beam width] [depth] [pieces]
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "citrus.h"
+#include "citrus_driver.h"
+
+#define QUEUE_SIZE 5
+#define ARENA_SIZE (16 << 20)
+#define TABLE_SIZE (1 << 20)
+
+// returns the current time in nanoseconds
+uint64_t bench_time(void)
+{
+	struct timespec time;
+	clock_gettime(CLOCK_MONOTONIC, &time);
+	return (uint64_t) time.tv_sec * 1000000000 + time.tv_nsec;
+}
+
+int main(int argc, char **argv)
+{
+	int max_threads = argc > 1 ? atoi(argv[1]) : 8;
+	int beam_width = argc > 2 ? atoi(argv[2]) : 256;
+	int depth = argc > 3 ? atoi(argv[3]) : 6;
+	int n_pieces = argc > 4 ? atoi(argv[4]) : 100;
+	CitrusGameConfig config = citrus_preset_delayless;
+	config.next_piece_queue_size = QUEUE_SIZE;
+
+	printf("threads  ms/move  moves/s  speedup  lines\n");
+	double base = 0;
+	for (int threads = 1; threads <= max_threads; threads *= 2) {
+		CitrusParallelBot bot;
+		if (!CitrusParallelBot_init(&bot, threads, beam_width, depth,
+					    ARENA_SIZE, TABLE_SIZE)) {
+			fprintf(stderr, "out of memory\n");
+			return 1;
+		}
+		CitrusCell board[10 * 40];
+		const CitrusPiece *queue[QUEUE_SIZE];
+		CitrusBagRandomizer bag;
+		CitrusBagRandomizer_init(&bag, 1);
+		CitrusGame game;
+		CitrusGame_init(&game, board, queue, &config, &bag, NULL);
+		int moves = 0;
+		uint64_t start = bench_time();
+		while (moves < n_pieces && game.alive) {
+			CitrusBotMove move;
+			if (!CitrusParallelBot_plan(&bot, &game, &move))
+				break;
+			CitrusBotMove_apply(&move, &game);
+			moves++;
+		}
+		double seconds = (bench_time() - start) / 1e9;
+		if (threads == 1)
+			base = seconds / moves;
+		printf("%7d  %7.3f  %7.1f  %7.2f  %5d\n", threads,
+		       seconds * 1000 / moves, moves / seconds,
+		       base / (seconds / moves), game.lines);
+		CitrusParallelBot_destroy(&bot);
+	}
+	return 0;
+}
@@ -0,0 +1,244 @@
+/* Copyright (C) 2026 RZ781
+ *
+ * This file is part of libcitrus.
+ *
+ * libcitrus is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 2.1 of the License, or (at your option)
+ * any later version.
+ *
+ * libcitrus is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// Load benchmark for the threaded server driver. Simulated clients send a
+// batch of inputs every tick and the workers' tick durations are reported.
+//
+// usage: server_bench [workers] [lobbies] [clients per lobby] [seconds]
+
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include "citrus.h"
+#include "citrus_driver.h"
+
+#define IO_THREADS 2
+#define TICK_RATE 60
+#define ENCODER_BUFFER_SIZE 32
+
+typedef struct {
+	CitrusCell board[10 * 40];
+	const CitrusPiece *queue[3];
+	CitrusBagRandomizer bag;
+} BenchGame;
+
+typedef struct {
+	CitrusServer *server;
+	int io;
+	int seconds;
+	uint64_t inputs;
+	uint64_t retries;
+} BenchIo;
+
+BenchGame *games;
+CitrusServer server;
+uint64_t bytes_sent;
+uint64_t sends;
+
+// counts the data sent to clients
+void bench_send(void *data, int n, uint8_t *bytes, int id)
+{
+	(void)data;
+	(void)bytes;
+	(void)id;
+	__atomic_fetch_add(&bytes_sent, n, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&sends, 1, __ATOMIC_RELAXED);
+}
+
+// starts a game for each client as it connects
+void bench_connect(void *data, CitrusServerLobby *lobby, int id)
+{
+	(void)data;
+	CitrusLobbySlot *slot = CitrusServerLobby_get_slot(lobby, id);
+	int index = (lobby - server.lobbies) * server.config.lobby_capacity
+	    + (slot - lobby->lobby.slots);
+	BenchGame *game = &games[index];
+	CitrusBagRandomizer_init(&game->bag, index);
+	CitrusGame_init(&slot->game, game->board, game->queue,
+			&citrus_preset_modern, &game->bag, NULL);
+	CitrusServerLobby_start_game(lobby, id);
+}
+
+// returns the current time in nanoseconds
+uint64_t bench_time(void)
+{
+	struct timespec time;
+	clock_gettime(CLOCK_MONOTONIC, &time);
+	return (uint64_t) time.tv_sec * 1000000000 + time.tv_nsec;
+}
+
+// sleeps until an absolute time
+void bench_sleep_until(uint64_t deadline)
+{
+	struct timespec time;
+	time.tv_sec = deadline / 1000000000;
+	time.tv_nsec = deadline % 1000000000;
+	clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &time, NULL);
+}
+
+// simulates the clients of every lobby handled by an io thread
+void *bench_io(void *data)
+{
+	BenchIo *io = data;
+	CitrusServerConfig *config = &io->server->config;
+	int capacity = config->lobby_capacity;
+	uint64_t state = io->io + 1;
+
+	// each client keeps its own encoder so tick deltas are per client
+	int n_clients = config->n_lobbies * capacity;
+	CitrusInputEncoder *encoders = calloc(n_clients,
+					      sizeof(CitrusInputEncoder));
+	uint8_t *buffers = calloc(n_clients, ENCODER_BUFFER_SIZE);
+	if (!encoders || !buffers) {
+		fprintf(stderr, "out of memory\n");
+		exit(1);
+	}
+	for (int i = 0; i < n_clients; i++)
+		CitrusInputEncoder_init(&encoders[i],
+					buffers + i * ENCODER_BUFFER_SIZE,
+					ENCODER_BUFFER_SIZE, 0);
+
+	for (int lobby = io->io; lobby < config->n_lobbies;
+	     lobby += IO_THREADS) {
+		for (int i = 0; i < capacity; i++) {
+			int id = lobby * capacity + i;
+			while (!CitrusServer_connect(io->server, io->io, lobby,
+						     id))
+				io->retries++;
+		}
+	}
+
+	uint64_t interval = 1000000000 / TICK_RATE;
+	uint64_t deadline = bench_time();
+	int n_ticks = io->seconds * TICK_RATE;
+	for (int tick = 1; tick <= n_ticks; tick++) {
+		for (int lobby = io->io; lobby < config->n_lobbies;
+		     lobby += IO_THREADS) {
+			for (int i = 0; i < capacity; i++) {
+				// tap a random key every tick
+				int id = lobby * capacity + i;
+				CitrusInputEncoder *encoder = &encoders[id];
+				unsigned key = 1 << (Citrus_random(&state) % 8);
+				CitrusInputEncoder_add(encoder, tick, key, key);
+				uint8_t *frame;
+				int n = CitrusInputEncoder_finish(encoder,
+								  &frame);
+				while (!CitrusServer_recv(io->server, io->io,
+							  lobby, id, n, frame))
+					io->retries++;
+				io->inputs++;
+			}
+		}
+		deadline += interval;
+		bench_sleep_until(deadline);
+	}
+	free(encoders);
+	free(buffers);
+	return NULL;
+}
+
+int main(int argc, char **argv)
+{
+	CitrusServerConfig config;
+	config.n_workers = sysconf(_SC_NPROCESSORS_ONLN);
+	if (argc > 1)
+		config.n_workers = atoi(argv[1]);
+	config.n_lobbies = argc > 2 ? atoi(argv[2]) : config.n_workers * 4;
+	config.lobby_capacity = argc > 3 ? atoi(argv[3]) : 64;
+	int seconds = argc > 4 ? atoi(argv[4]) : 5;
+	if (config.n_workers < 1 || config.n_lobbies < 1
+	    || config.lobby_capacity < 1 || seconds < 1) {
+		fprintf(stderr, "usage: %s [workers] [lobbies] "
+			"[clients per lobby] [seconds]\n", argv[0]);
+		return 1;
+	}
+	config.n_io_threads = IO_THREADS;
+	config.parser_buffer_size = 64;
+	config.output_buffer_size = 256;
+	config.max_message_size = 64;
+	config.ring_size = 1 << 20;
+	config.tick_rate = TICK_RATE;
+	config.pin_threads = true;
+	config.send = bench_send;
+	config.connect = bench_connect;
+	config.data = NULL;
+
+	int n_clients = config.n_lobbies * config.lobby_capacity;
+	games = calloc(n_clients, sizeof(BenchGame));
+	if (!games || !CitrusServer_init(&server, &config)) {
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+	printf("%d workers, %d lobbies, %d clients\n", config.n_workers,
+	       config.n_lobbies, n_clients);
+
+	if (!CitrusServer_start(&server)) {
+		fprintf(stderr, "failed to start workers\n");
+		return 1;
+	}
+	pthread_t threads[IO_THREADS];
+	BenchIo io[IO_THREADS];
+	uint64_t start = bench_time();
+	for (int i = 0; i < IO_THREADS; i++) {
+		io[i].server = &server;
+		io[i].io = i;
+		io[i].seconds = seconds;
+		io[i].inputs = 0;
+		io[i].retries = 0;
+		pthread_create(&threads[i], NULL, bench_io, &io[i]);
+	}
+	uint64_t inputs = 0;
+	uint64_t retries = 0;
+	for (int i = 0; i < IO_THREADS; i++) {
+		pthread_join(threads[i], NULL);
+		inputs += io[i].inputs;
+		retries += io[i].retries;
+	}
+	CitrusServer_stop(&server);
+	double elapsed = (bench_time() - start) / 1e9;
+
+	uint64_t ticks = 0;
+	uint64_t late_ticks = 0;
+	uint64_t tick_ns_total = 0;
+	uint64_t tick_ns_max = 0;
+	for (int i = 0; i < config.n_workers; i++) {
+		CitrusServerWorker *worker = &server.workers[i];
+		ticks += worker->ticks;
+		late_ticks += worker->late_ticks;
+		tick_ns_total += worker->tick_ns_total;
+		if (worker->tick_ns_max > tick_ns_max)
+			tick_ns_max = worker->tick_ns_max;
+	}
+	printf("ticks: %llu, late: %llu\n", (unsigned long long)ticks,
+	       (unsigned long long)late_ticks);
+	printf("tick duration: mean %.1f us, max %.1f us, budget %.1f us\n",
+	       tick_ns_total / 1e3 / ticks, tick_ns_max / 1e3,
+	       1e6 / TICK_RATE);
+	printf("inputs: %.0f/s, ring full retries: %llu\n", inputs / elapsed,
+	       (unsigned long long)retries);
+	printf("sent: %.0f sends/s, %.1f MB/s\n", sends / elapsed,
+	       bytes_sent / elapsed / 1e6);
+	CitrusServer_destroy(&server);
+	free(games);
+	return 0;
+}
@@ -0,0 +1,113 @@
+/* Copyright (C) 2026 RZ781
+ *
+ * This file is part of libcitrus.
+ *
+ * libcitrus is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 2.1 of the License, or (at your option)
+ * any later version.
+ *
+ * libcitrus is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "citrus.h"
+#include "citrus_driver.h"
+
+// initializes a parallel bot
+bool CitrusParallelBot_init(CitrusParallelBot *bot, int n_workers,
+			    int beam_width, int max_depth, size_t arena_size,
+			    uint32_t table_size)
+{
+	uint32_t capacity = 1;
+	while (capacity < table_size)
+		capacity *= 2;
+	arena_size = (arena_size + 63) & ~(size_t) 63;
+	size_t size = n_workers * arena_size
+	    + capacity * sizeof(CitrusTableEntry);
+	uint8_t *memory = aligned_alloc(64, (size + 63) & ~(size_t) 63);
+	bot->workers = aligned_alloc(64, ((n_workers * sizeof(CitrusBotWorker)
+					   + 63) & ~(size_t) 63));
+	if (!memory || !bot->workers) {
+		free(memory);
+		free(bot->workers);
+		return false;
+	}
+	bot->memory = memory;
+	bot->n_workers = n_workers;
+	bot->game = NULL;
+	CitrusTranspositionTable_init(&bot->table, (CitrusTableEntry *) memory,
+				      capacity);
+	memory += capacity * sizeof(CitrusTableEntry);
+	// the beam is shared out so the total work matches a single search
+	int worker_width = (beam_width + n_workers - 1) / n_workers;
+	for (int i = 0; i < n_workers; i++) {
+		CitrusBotWorker *worker = &bot->workers[i];
+		worker->parallel = bot;
+		CitrusBot_init(&worker->bot, worker_width, max_depth);
+		CitrusBot_set_table(&worker->bot, &bot->table);
+		CitrusBot_set_split(&worker->bot, i, n_workers);
+		CitrusArena_init(&worker->arena, memory, arena_size);
+		memory += arena_size;
+	}
+	return true;
+}
+
+// searches a worker's share of the first moves
+void *CitrusBotWorker_run(void *data)
+{
+	CitrusBotWorker *worker = data;
+	worker->found = CitrusBot_plan(&worker->bot, worker->parallel->game,
+				       &worker->arena, &worker->move);
+	return NULL;
+}
+
+// plans a move on every worker and picks the best
+bool CitrusParallelBot_plan(CitrusParallelBot *bot, CitrusGame *game,
+			    CitrusBotMove *move)
+{
+	bot->game = game;
+	CitrusTranspositionTable_new_search(&bot->table);
+	// the calling thread searches the first share itself
+	int started = 1;
+	bool ok = true;
+	for (; started < bot->n_workers; started++) {
+		CitrusBotWorker *worker = &bot->workers[started];
+		if (pthread_create(&worker->thread, NULL, CitrusBotWorker_run,
+				   worker)) {
+			ok = false;
+			break;
+		}
+	}
+	CitrusBotWorker_run(&bot->workers[0]);
+	for (int i = 1; i < started; i++)
+		pthread_join(bot->workers[i].thread, NULL);
+	if (!ok)
+		return false;
+	bool found = false;
+	for (int i = 0; i < bot->n_workers; i++) {
+		CitrusBotWorker *worker = &bot->workers[i];
+		if (worker->found && (!found
+				      || worker->move.value > move->value)) {
+			*move = worker->move;
+			found = true;
+		}
+	}
+	return found;
+}
+
+// frees a parallel bot's memory
+void CitrusParallelBot_destroy(CitrusParallelBot *bot)
+{
+	free(bot->workers);
+	free(bot->memory);
+}
@@ -0,0 +1,356 @@
+/* Copyright (C) 2026 RZ781
+ *
+ * This file is part of libcitrus.
+ *
+ * libcitrus is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 2.1 of the License, or (at your option)
+ * any later version.
+ *
+ * libcitrus is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <sched.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "citrus.h"
+#include "citrus_driver.h"
+
+// copies into the ring, wrapping around the end of the buffer
+void CitrusRing_write(CitrusRing *ring, uint64_t position, const void *data,
+		      uint64_t n)
+{
+	if (n == 0)
+		return;
+	uint64_t start = position & (ring->capacity - 1);
+	uint64_t first = ring->capacity - start;
+	if (first > n)
+		first = n;
+	memcpy(ring->buffer + start, data, first);
+	memcpy(ring->buffer, (const uint8_t *)data + first, n - first);
+}
+
+// copies out of the ring, wrapping around the end of the buffer
+void CitrusRing_read(CitrusRing *ring, uint64_t position, void *data,
+		     uint64_t n)
+{
+	if (n == 0)
+		return;
+	uint64_t start = position & (ring->capacity - 1);
+	uint64_t first = ring->capacity - start;
+	if (first > n)
+		first = n;
+	memcpy(data, ring->buffer + start, first);
+	memcpy((uint8_t *) data + first, ring->buffer, n - first);
+}
+
+// initializes a ring
+void CitrusRing_init(CitrusRing *ring, uint8_t *buffer, uint64_t capacity)
+{
+	ring->head = 0;
+	ring->tail = 0;
+	ring->buffer = buffer;
+	ring->capacity = capacity;
+}
+
+// adds a message to a ring
+bool CitrusRing_push(CitrusRing *ring, const CitrusMessage *message,
+		     const uint8_t *data)
+{
+	uint64_t size = sizeof(CitrusMessage) + message->length;
+	uint64_t head = ring->head;
+	uint64_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+	if (ring->capacity - (head - tail) < size)
+		return false;
+	CitrusRing_write(ring, head, message, sizeof(CitrusMessage));
+	CitrusRing_write(ring, head + sizeof(CitrusMessage), data,
+			 message->length);
+	__atomic_store_n(&ring->head, head + size, __ATOMIC_RELEASE);
+	return true;
+}
+
+// removes a message from a ring
+bool CitrusRing_pop(CitrusRing *ring, CitrusMessage *message, uint8_t *data,
+		    int capacity)
+{
+	uint64_t tail = ring->tail;
+	uint64_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+	if (head == tail)
+		return false;
+	CitrusRing_read(ring, tail, message, sizeof(CitrusMessage));
+	int length = message->length;
+	if (length > capacity)
+		length = capacity;
+	CitrusRing_read(ring, tail + sizeof(CitrusMessage), data, length);
+	uint64_t size = sizeof(CitrusMessage) + message->length;
+	__atomic_store_n(&ring->tail, tail + size, __ATOMIC_RELEASE);
+	return true;
+}
+
+// returns the smallest power of two which is at least n
+uint64_t CitrusServer_power_of_two(uint64_t n)
+{
+	uint64_t result = 1;
+	while (result < n)
+		result *= 2;
+	return result;
+}
+
+// initializes a server
+bool CitrusServer_init(CitrusServer *server, const CitrusServerConfig *config)
+{
+	server->config = *config;
+	server->running = false;
+	int n_workers = config->n_workers;
+	int n_lobbies = config->n_lobbies;
+	int capacity = config->lobby_capacity;
+	int connections_size = CitrusServer_power_of_two(capacity * 2);
+	uint64_t ring_size = CitrusServer_power_of_two(config->ring_size);
+	int n_rings = n_workers * config->n_io_threads;
+
+	// every buffer is carved out of one allocation
+	size_t lobby_size = capacity * sizeof(CitrusLobbySlot)
+	    + capacity * sizeof(int)
+	    + connections_size * sizeof(CitrusIdEntry)
+	    + capacity * sizeof(CitrusParser)
+	    + (size_t)capacity * config->parser_buffer_size
+	    + (size_t)capacity * config->output_buffer_size;
+	lobby_size = (lobby_size + 63) & ~(size_t) 63;
+	size_t size = n_lobbies * lobby_size
+	    + n_rings * ring_size
+	    + n_workers * (size_t)config->max_message_size;
+	uint8_t *memory = aligned_alloc(64, (size + 63) & ~(size_t) 63);
+	server->workers = calloc(n_workers, sizeof(CitrusServerWorker));
+	server->lobbies = calloc(n_lobbies, sizeof(CitrusServerLobby));
+	CitrusRing *rings = aligned_alloc(64, n_rings * sizeof(CitrusRing));
+	if (!memory || !server->workers || !server->lobbies || !rings) {
+		free(memory);
+		free(server->workers);
+		free(server->lobbies);
+		free(rings);
+		return false;
+	}
+	server->memory = memory;
+
+	for (int i = 0; i < n_lobbies; i++) {
+		uint8_t *p = memory + i * lobby_size;
+		CitrusLobbySlot *slots = (CitrusLobbySlot *) p;
+		p += capacity * sizeof(CitrusLobbySlot);
+		CitrusIdEntry *connections = (CitrusIdEntry *) p;
+		p += connections_size * sizeof(CitrusIdEntry);
+		CitrusParser *parsers = (CitrusParser *) p;
+		p += capacity * sizeof(CitrusParser);
+		int *active_slots = (int *)p;
+		p += capacity * sizeof(int);
+		uint8_t *parser_buffers = p;
+		p += capacity * config->parser_buffer_size;
+		uint8_t *output_buffers = p;
+		if (!CitrusServerLobby_init(&server->lobbies[i], slots,
+					    active_slots, connections,
+					    connections_size, parsers,
+					    parser_buffers,
+					    config->parser_buffer_size,
+					    output_buffers,
+					    config->output_buffer_size,
+					    capacity, config->send,
+					    config->data)) {
+			free(memory);
+			free(server->workers);
+			free(server->lobbies);
+			free(rings);
+			return false;
+		}
+	}
+	memory += n_lobbies * lobby_size;
+
+	for (int i = 0; i < n_workers; i++) {
+		CitrusServerWorker *worker = &server->workers[i];
+		worker->index = i;
+		worker->server = server;
+		worker->rings = rings + i * config->n_io_threads;
+		for (int j = 0; j < config->n_io_threads; j++) {
+			CitrusRing_init(&worker->rings[j], memory, ring_size);
+			memory += ring_size;
+		}
+		worker->message_buffer = memory;
+		memory += config->max_message_size;
+	}
+	return true;
+}
+
+// returns the current time in nanoseconds
+uint64_t CitrusServer_time(void)
+{
+	struct timespec time;
+	clock_gettime(CLOCK_MONOTONIC, &time);
+	return (uint64_t) time.tv_sec * 1000000000 + time.tv_nsec;
+}
+
+// passes every queued message to the worker's lobbies
+void CitrusServerWorker_drain(CitrusServerWorker *worker)
+{
+	CitrusServer *server = worker->server;
+	CitrusServerConfig *config = &server->config;
+	CitrusMessage message;
+	for (int i = 0; i < config->n_io_threads; i++) {
+		CitrusRing *ring = &worker->rings[i];
+		while (CitrusRing_pop(ring, &message, worker->message_buffer,
+				      config->max_message_size)) {
+			CitrusServerLobby *lobby =
+			    &server->lobbies[message.lobby];
+			worker->messages++;
+			switch (message.type) {
+			case CITRUS_MESSAGE_CONNECT:
+				if (CitrusServerLobby_client_connect
+				    (lobby, message.id) && config->connect)
+					config->connect(config->data, lobby,
+							message.id);
+				break;
+			case CITRUS_MESSAGE_DISCONNECT:
+				CitrusServerLobby_client_disconnect(lobby,
+								    message.id);
+				break;
+			case CITRUS_MESSAGE_RECV:
+				// drop clients sending malformed data
+				if (!CitrusServerLobby_recv
+				    (lobby, message.length,
+				     worker->message_buffer, message.id))
+					CitrusServerLobby_client_disconnect
+					    (lobby, message.id);
+				break;
+			}
+		}
+	}
+}
+
+// runs a worker's lobbies at a fixed tick rate until the server stops
+void *CitrusServerWorker_run(void *data)
+{
+	CitrusServerWorker *worker = data;
+	CitrusServer *server = worker->server;
+	CitrusServerConfig *config = &server->config;
+	uint64_t interval = 1000000000 / config->tick_rate;
+	uint64_t deadline = CitrusServer_time();
+	while (__atomic_load_n(&server->running, __ATOMIC_ACQUIRE)) {
+		uint64_t start = CitrusServer_time();
+		if (start > deadline + interval)
+			worker->late_ticks++;
+		CitrusServerWorker_drain(worker);
+		for (int i = worker->index; i < config->n_lobbies;
+		     i += config->n_workers)
+			CitrusServerLobby_tick(&server->lobbies[i]);
+		uint64_t end = CitrusServer_time();
+		uint64_t duration = end - start;
+		worker->ticks++;
+		worker->tick_ns_total += duration;
+		if (duration > worker->tick_ns_max)
+			worker->tick_ns_max = duration;
+
+		// skip ticks rather than running them back to back when the
+		// worker falls far behind
+		deadline += interval;
+		if (end > deadline + interval)
+			deadline = end;
+		struct timespec time;
+		time.tv_sec = deadline / 1000000000;
+		time.tv_nsec = deadline % 1000000000;
+		clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &time, NULL);
+	}
+	return NULL;
+}
+
+// starts the worker threads
+bool CitrusServer_start(CitrusServer *server)
+{
+	CitrusServerConfig *config = &server->config;
+	__atomic_store_n(&server->running, true, __ATOMIC_RELEASE);
+	for (int i = 0; i < config->n_workers; i++) {
+		CitrusServerWorker *worker = &server->workers[i];
+		if (pthread_create(&worker->thread, NULL,
+				   CitrusServerWorker_run, worker)) {
+			__atomic_store_n(&server->running, false,
+					 __ATOMIC_RELEASE);
+			for (int j = 0; j < i; j++)
+				pthread_join(server->workers[j].thread, NULL);
+			return false;
+		}
+		if (config->pin_threads) {
+			cpu_set_t cpus;
+			CPU_ZERO(&cpus);
+			CPU_SET(i % CPU_SETSIZE, &cpus);
+			pthread_setaffinity_np(worker->thread,
+					       sizeof(cpu_set_t), &cpus);
+		}
+	}
+	return true;
+}
+
+// stops the worker threads
+void CitrusServer_stop(CitrusServer *server)
+{
+	if (!__atomic_load_n(&server->running, __ATOMIC_ACQUIRE))
+		return;
+	__atomic_store_n(&server->running, false, __ATOMIC_RELEASE);
+	for (int i = 0; i < server->config.n_workers; i++)
+		pthread_join(server->workers[i].thread, NULL);
+}
+
+// frees a server's memory
+void CitrusServer_destroy(CitrusServer *server)
+{
+	free(server->workers[0].rings);
+	free(server->workers);
+	free(server->lobbies);
+	free(server->memory);
+}
+
+// queues a message for the worker running a lobby
+bool CitrusServer_push(CitrusServer *server, int io, int type, int lobby,
+		       int id, int n, const uint8_t *data)
+{
+	CitrusServerConfig *config = &server->config;
+	if (lobby < 0 || lobby >= config->n_lobbies)
+		return false;
+	if (n > config->max_message_size)
+		return false;
+	CitrusServerWorker *worker = &server->workers[lobby % config->n_workers];
+	CitrusMessage message;
+	message.type = type;
+	message.lobby = lobby;
+	message.id = id;
+	message.length = n;
+	return CitrusRing_push(&worker->rings[io], &message, data);
+}
+
+// hands a new connection to a worker
+bool CitrusServer_connect(CitrusServer *server, int io, int lobby, int id)
+{
+	return CitrusServer_push(server, io, CITRUS_MESSAGE_CONNECT, lobby, id,
+				 0, NULL);
+}
+
+// hands a closed connection to a worker
+bool CitrusServer_disconnect(CitrusServer *server, int io, int lobby, int id)
+{
+	return CitrusServer_push(server, io, CITRUS_MESSAGE_DISCONNECT, lobby,
+				 id, 0, NULL);
+}
+
+// hands received data to a worker
+bool CitrusServer_recv(CitrusServer *server, int io, int lobby, int id, int n,
+		       const uint8_t *data)
+{
+	return CitrusServer_push(server, io, CITRUS_MESSAGE_RECV, lobby, id, n,
+				 data);
+}
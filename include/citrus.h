@@ -20,9 +20,31 @@
 #define CITRUS_H
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
-#define CITRUS_PARSER_BUFFER_SIZE 16
+// maximum size of a frame header, which is the varint encoded frame length
+#define CITRUS_FRAME_HEADER_SIZE 10
+// size of the header written at the start of a record stream
+#define CITRUS_RECORD_HEADER_SIZE 16
+#define CITRUS_BITBOARD_BLOCK_ROWS 8
+#define CITRUS_BOT_MAX_KEYS 32
+#define CITRUS_BOT_MAX_PIECES 16
+#define CITRUS_BOT_MAX_MOVES 512
+// ticks a client's inputs may run ahead of the server lobby's tick
+#define CITRUS_MAX_INPUT_LEAD 256
+// most ticks a validator fast forwards in one go before giving up
+#define CITRUS_VALIDATOR_MAX_SKIP 65536
+// inputs a lobby slot holds until its game reaches their tick
+#define CITRUS_LOBBY_PENDING_INPUTS 64
+// sizes of an opening book's header and of each of its entries
+#define CITRUS_BOOK_HEADER_SIZE 16
+#define CITRUS_BOOK_ENTRY_SIZE 16
+// number of 64 bit words in a row of an occupancy bitboard
+#define CITRUS_ROW_WORDS(width) (((width) + 63) / 64)
+// large enough for any output of CitrusRenderer_draw_frame
+#define CITRUS_RENDER_BUFFER_SIZE(width, height) \
+	((height) * ((width) * 32 + 16) + 16)
 
 typedef enum {
 	CITRUS_KEY_LEFT,
@@ -35,6 +57,16 @@ typedef enum {
 	CITRUS_KEY_HOLD
 } CitrusKey;
 
+typedef enum {
+	CITRUS_EVENT_CONNECT,
+	CITRUS_EVENT_DISCONNECT,
+	CITRUS_EVENT_INPUT,
+	CITRUS_EVENT_ACK,
+	CITRUS_EVENT_SPECTATE,
+	CITRUS_EVENT_BOARD,
+	CITRUS_EVENT_CHECKSUM
+} CitrusEventType;
+
 typedef enum {
 	CITRUS_CELL_EMPTY,
 	CITRUS_CELL_SHADOW,
@@ -68,20 +100,25 @@ typedef struct {
 typedef struct {
 	int width;		// width of the board
 	int height;		// spawn height, suggested display height
-	int full_height;	// height of the board
+	int full_height;	// height of the board, at most 32767
 	int next_piece_queue_size;	// how many next pieces to show
 	double gravity;		// cells moved per tick
-	int lock_delay;		// number of ticks before locking on ground
-	int max_move_reset;	// maximum times lock delay can be reset by moving
+	int lock_delay;		// ticks before locking on ground, at most 32767
+	// maximum times lock delay can be reset by moving, at most 32767
+	int max_move_reset;
 	const CitrusPiece *(*randomizer)(void *);	// randomizer function
 	int clear_scores[5];	// score given by clearing 0 to 4 lines
 	int all_clear_scores[5];	// score given by  0 to 4 line all clear
 	int t_spin_scores[4];	// score given spin zero to triple
 	int mini_t_spin_scores[4];	// score given by mini spins zero to triple
-	int line_clear_delay;	// ticks before next piece after clearing lines
+	// ticks before next piece after clearing lines, at most 32767
+	int line_clear_delay;
 	bool shadow;		// whether or not to display shadows
+	// movement is counted in subticks, so (das + arr + 1) * subticks must
+	// be at most 32767
 	int das;		// frames until movement keys start to repeat
 	int arr;		// frames between repetition of movement keys
+	int subticks;		// resolution of key press times within a tick
 	// arguments: lines cleared, combo, b2b, all clear, spin, mini spin
 	void (*action_text)(void *, int, int, bool, bool, bool, bool);
 } CitrusGameConfig;
@@ -91,60 +128,272 @@ typedef struct {
 	int y;
 } CitrusVector;
 
+typedef enum {
+	CITRUS_TRACE_TICK,
+	CITRUS_TRACE_RECV,
+	CITRUS_TRACE_PARSE,
+	CITRUS_TRACE_LOCK,
+	CITRUS_TRACE_SEND,
+	CITRUS_TRACE_LINE_CLEAR,
+	CITRUS_TRACE_TOP_OUT
+} CitrusTraceName;
+
+typedef enum {
+	CITRUS_TRACE_BEGIN,
+	CITRUS_TRACE_END,
+	CITRUS_TRACE_INSTANT
+} CitrusTracePhase;
+
+typedef struct {
+	uint64_t time;		// result of the tracer's clock
+	int32_t id;		// slot the event is about, or -1 for the lobby
+	uint16_t arg;		// bytes or lines cleared, capped at 65535
+	uint8_t name;		// CitrusTraceName
+	uint8_t phase;		// CitrusTracePhase
+} CitrusTraceRecord;
+
+typedef struct {
+	CitrusTraceRecord *records;
+	uint32_t capacity;	// always a power of two
+	uint64_t count;		// total records written, older ones are overwritten
+	uint64_t (*clock)(void *clock_data);
+	void *clock_data;
+} CitrusTracer;
+
+typedef struct {
+	CitrusKey key;
+	bool down;		// whether the key was pressed or released
+	int offset;		// subticks between the last tick and the press
+} CitrusInput;
+
 typedef struct {
-	CitrusGameConfig config;
+	// fields used every tick, by every collision test and by the lock
+	// delay rules, kept together in one cache line
 	CitrusCell *board;
-	void *randomizer_data;
-	void *action_text_data;
+	const CitrusGameConfig *config;	// shared, must outlive the game
 	const CitrusPiece *current_piece;
-	const CitrusPiece *hold_piece;
-	const CitrusPiece **next_piece_queue;
-	bool held;
-	CitrusVector position;
+	uint64_t *occupancy;	// bitboard of full cells, or NULL
 	double fall_amount;
-	int rotation;
+	CitrusVector position;
+	int16_t move_frames;	// subticks since the movement key was pressed
+	int16_t line_clear_delay;
+	int16_t lock_delay;
+	int16_t move_reset_count;
+	int16_t lowest_y;
+	int8_t rotation;
+	int8_t move_direction;
+	int8_t last_kick;
+	bool soft_drop;
 	bool alive;
-	int lock_delay;
-	int move_reset_count;
-	int lowest_y;
+	// fields only written when cells of the board change, or used when the
+	// piece is dropped, held, locks or clears lines
+	// rows changed since the mask was last cleared, bit 63 also covers
+	// every row above it
+	uint64_t dirty_rows;
+	const CitrusPiece *hold_piece;
+	const CitrusPiece **next_piece_queue;
+	void *randomizer_data;
+	void *action_text_data;
+	CitrusTracer *tracer;	// records locks and line clears, or NULL
+	int trace_id;		// id given to the game's trace records
 	int score;
 	int level;
 	int lines;
-	int line_clear_delay;
-	bool b2b;
 	int combo;
-	int last_kick;
-	int move_direction;
-	int move_frames;
-	bool soft_drop;
+	bool held;
+	bool b2b;
 } CitrusGame;
 
+_Static_assert(offsetof(CitrusGame, dirty_rows) <= 64,
+	       "the fields used every tick must fit in one cache line");
+
+typedef enum {
+	CITRUS_PARSER_EMPTY,	// all received data has been consumed
+	CITRUS_PARSER_FRAME,	// a frame was decoded
+	CITRUS_PARSER_OVERFLOW,	// a split frame is larger than the buffer
+	CITRUS_PARSER_INVALID	// the frame header is malformed
+} CitrusParserStatus;
+
+typedef struct {
+	const uint8_t *data;
+	int length;
+} CitrusFrame;
+
 typedef struct {
-	uint8_t buffer[CITRUS_PARSER_BUFFER_SIZE];
-	int write_pointer;
-	int read_pointer;
+	uint8_t *buffer;	// staging buffer for frames split between reads
+	int capacity;
+	int length;		// number of bytes staged in buffer
+	int frame_length;	// total size of the staged frame, 0 if unknown
+	const uint8_t *input;	// received data that hasn't been parsed yet
+	int input_length;
 } CitrusParser;
 
 typedef struct {
-	bool in_game_clients[256];
-	bool connected_clients[256];
-	CitrusGame games[256];
+	uint8_t *buffer;
+	int capacity;
+	int length;		// bytes written including space for the header
+	int client_id;
+	int tick;		// tick of the last input written
+} CitrusInputEncoder;
+
+typedef struct {
+	// aligned so the game's hot fields share one cache line
+	_Alignas(64) CitrusGame game;
+	CitrusGameConfig config;	// client's config without action text
+	int tick;		// number of ticks the game has run
+	int checked_tick;	// tick of the last checksum compared
+	bool desynced;		// whether a checksum has not matched
+} CitrusValidator;
+
+typedef struct {
+	int key;		// -1 if the entry is empty
+	int value;
+} CitrusIdEntry;
+
+typedef struct {
+	CitrusIdEntry *entries;
+	int capacity;		// always a power of two
+	int count;
+} CitrusIdTable;
+
+typedef struct {
+	int tick;		// tick of the client's game the keys changed on
+	uint8_t down;
+	uint8_t up;
+} CitrusLobbyInput;
+
+typedef struct {
+	// aligned so the game's hot fields share one cache line
+	_Alignas(64) CitrusGame game;
+	CitrusValidator *validator;	// replays the client's inputs, or NULL
+	int connection_id;	// id the server uses for the client's connection
+	bool connected;
+	bool in_game;
+	int active_index;	// position of this slot in active_slots
+	int input_tick;		// tick of the last input received
+	// checksum sent for a tick past input_tick, compared once an input
+	// past its tick shows the validator has every input for it
+	bool checksum_pending;
+	int checksum_tick;
+	uint32_t checksum;
+	int game_tick;		// number of ticks the game has run
+	// ring of received inputs not yet applied to the game
+	CitrusLobbyInput pending[CITRUS_LOBBY_PENDING_INPUTS];
+	int pending_start;
+	int n_pending;
+	int applied_tick;	// tick of the last input applied to the game
+	int acked_tick;		// tick of the last input acknowledged
+	int output_length;	// bytes waiting to be sent to the client
+	int spectating;		// id of the client being spectated, or -1
+	// doubly linked list of clients spectating this client
+	int first_spectator;
+	int next_spectator;
+	int previous_spectator;
+	bool keyframe_needed;	// whether spectators need a full board
+} CitrusLobbySlot;
+
+_Static_assert(sizeof(CitrusLobbySlot) % 64 == 0,
+	       "every slot in an array must start on a cache line");
+
+typedef struct {
+	CitrusLobbySlot *slots;
+	// permutation of all slot indices, connected slots come first
+	int *active_slots;
+	int n_active_slots;
+	bool active_slots_sorted;	// whether connected slots are in order
+	int capacity;
+	int max_input_tick;	// inputs and checksums past this are rejected
+	CitrusTracer *tracer;	// NULL if tracing is disabled
 } CitrusLobby;
 
 typedef struct {
 	CitrusLobby lobby;
 	CitrusParser parser;
+	CitrusInputEncoder input_encoder;
+	int acked_tick;		// tick of the last input the server acknowledged
+	int spectate_id;	// id of the client being spectated, or -1
+	uint8_t *spectate_frame;	// board of the client being spectated
+	int spectate_width;
+	int spectate_height;
+	int spectate_tick;	// tick the spectated board was last updated
 	void (*send)(void *send_data, int n, uint8_t * data);
 	void *send_data;
 } CitrusClientLobby;
 
 typedef struct {
 	CitrusLobby lobby;
-	CitrusParser parsers[256];
+	CitrusIdTable connections;	// maps connection ids to slots
+	CitrusParser *parsers;
+	uint8_t *parser_buffers;
+	int parser_buffer_size;
+	uint8_t *output_buffers;
+	int output_buffer_size;
+	uint8_t *spectator_frames;	// last board sent to each client's spectators
+	int spectator_frame_size;
+	uint8_t *board_buffer;	// used to encode board updates once per game
+	int board_buffer_size;
+	int keyframe_interval;	// ticks between full boards sent to spectators
+	int tick;		// number of ticks run
 	void (*send)(void *send_data, int n, uint8_t * data, int id);
 	void *send_data;
 } CitrusServerLobby;
 
+typedef struct {
+	uint64_t time;		// timestamp in the caller's clock
+	CitrusKey key;
+	bool down;		// whether the key was pressed or released
+} CitrusTimedInput;
+
+typedef struct {
+	// written by the producer
+	_Alignas(64) uint32_t head;
+	// written by the consumer
+	_Alignas(64) uint32_t tail;
+	_Alignas(64) CitrusTimedInput *inputs;
+	uint32_t capacity;	// always a power of two
+} CitrusInputQueue;
+
+typedef struct {
+	uint8_t *cells;		// locked cells, 0 if empty otherwise color + 1
+	int width;
+	int full_height;
+	const CitrusPiece *current_piece;	// NULL if no piece is shown
+	CitrusVector position;
+	int rotation;
+	int ghost_y;		// y position the current piece would land at
+	const CitrusPiece *hold_piece;
+	const CitrusPiece **next_pieces;
+	int n_next_pieces;
+	int score;
+	int lines;
+	int level;
+	bool alive;
+} CitrusSnapshot;
+
+typedef struct {
+	CitrusSnapshot snapshots[3];
+	int back;		// snapshot being written, only used by the writer
+	int front;		// snapshot being read, only used by the reader
+	// latest published snapshot, shared between both threads
+	int middle;
+	// rows each snapshot is missing, only used by the writer
+	uint64_t stale_rows[3];
+} CitrusSnapshotBuffer;
+
+typedef struct {
+	uint8_t *previous;	// cells last written to the terminal
+	uint8_t *current;	// frame built by CitrusRenderer_draw_game
+	int width;
+	int height;		// number of rows drawn, counted from the bottom
+	int row;		// terminal row of the top of the board, from 1
+	int column;		// terminal column of the left of the board, from 1
+	// terminal state while a frame is being written
+	int cursor_row;
+	int cursor_column;
+	int style;
+	bool redraw;		// whether the next game frame is built in full
+} CitrusRenderer;
+
 typedef struct {
 	uint64_t state;
 	int chosen_pieces[7];
@@ -156,10 +405,185 @@ typedef struct {
 	int previous_piece;
 } CitrusClassicRandomizer;
 
+typedef enum {
+	CITRUS_OBSERVATION_ALIVE,
+	CITRUS_OBSERVATION_HELD,	// 1 if hold has been used on this piece
+	CITRUS_OBSERVATION_B2B,
+	CITRUS_OBSERVATION_COMBO,
+	CITRUS_OBSERVATION_LEVEL,
+	CITRUS_OBSERVATION_LOCK_DELAY,	// ticks left before the piece locks
+	CITRUS_OBSERVATION_MOVE_RESETS,	// lock delay resets used
+	CITRUS_OBSERVATION_LINE_CLEAR_DELAY,	// ticks left in a line clear
+	CITRUS_OBSERVATION_N_SCALARS
+} CitrusObservationScalar;
+
+typedef struct {
+	int width;
+	int full_height;
+	int n_next;		// pieces of the queue included
+	// offsets of each part of an observation, in bytes
+	int board;		// width*full_height locked cells, bottom row first
+	int piece;		// width*full_height cells of the current piece
+	int current;		// 7 bytes, one-hot current piece
+	int hold;		// 8 bytes, one-hot hold piece with 7 for none
+	int queue;		// n_next*7 bytes, one-hot next pieces
+	int scalars;		// CITRUS_OBSERVATION_N_SCALARS bytes
+	int size;		// total size of an observation
+} CitrusObservationLayout;
+
+typedef struct {
+	const CitrusObservationLayout *layout;
+	uint8_t *buffer;	// records waiting to be written
+	int capacity;
+	int length;
+	// called with the bytes to append to the stream, returning false if
+	// they couldn't be written
+	bool (*write)(void *data, const uint8_t * bytes, int n);
+	void *data;
+} CitrusRecordWriter;
+
+typedef struct {
+	uint8_t *data;
+	size_t capacity;
+	size_t used;
+} CitrusArena;
+
+typedef struct {
+	// rows in blocks of CITRUS_BITBOARD_BLOCK_ROWS, which can be shared
+	// between boards, where bit x of a row is set if the cell is full
+	const uint64_t **blocks;
+	int n_blocks;		// at most 32
+	uint32_t owned;		// bit i is set if blocks[i] can be written to
+} CitrusBitboard;
+
+typedef struct {
+	uint64_t check;		// key xor data, so torn writes don't verify
+	uint64_t data;		// value, depth, generation and a valid bit
+} CitrusTableEntry;
+
+typedef struct {
+	CitrusTableEntry *entries;
+	uint32_t capacity;	// always a power of two
+	uint32_t generation;	// entries from other searches are ignored
+} CitrusTranspositionTable;
+
+typedef struct {
+	uint64_t key;		// from CitrusBot_book_key
+	int32_t value;		// value the search gave the placement
+	int8_t x;		// placement of the piece
+	int8_t y;
+	uint8_t rotation;
+	bool hold;		// whether the piece is placed after holding
+} CitrusBookEntry;
+
+typedef struct {
+	const uint8_t *entries;	// entries sorted by key, in the caller's buffer
+	uint32_t n_entries;
+	int n_next;		// number of next pieces included in each key
+} CitrusBook;
+
+typedef struct {
+	int height;		// penalty for each full column height
+	int holes;		// penalty for each empty cell under a full one
+	int bumpiness;		// penalty for each step between neighbouring columns
+	int clears[5];		// reward for clearing 0 to 4 lines
+} CitrusBotWeights;
+
+typedef struct {
+	int piece;		// index in citrus_pieces of the piece placed
+	bool hold;		// whether hold is pressed before the keys
+	CitrusVector position;	// where the piece locks
+	int rotation;
+	int value;		// score of the best board found after the move
+	int n_keys;
+	CitrusKey keys[CITRUS_BOT_MAX_KEYS];	// taps ending with a hard drop
+} CitrusBotMove;
+
+typedef struct {
+	int8_t x;
+	int8_t y;
+	int8_t rotation;
+	uint8_t key;		// key tapped to reach this state from its parent
+	int16_t parent;		// index of the previous state, or -1
+} CitrusBotState;
+
+typedef struct {
+	CitrusBitboard board;
+	int move;		// root move the node comes from
+	int next;		// index in pieces of the piece to place next
+	int hold;		// index in citrus_pieces of the held piece, or -1
+	int reward;		// line clear rewards so far
+	int value;		// reward plus the evaluation of rows
+} CitrusBotNode;
+
+typedef struct {
+	int parent;		// node the piece is placed on
+	int move;
+	int next;
+	int hold;
+	int piece;
+	CitrusVector position;
+	int rotation;
+	int reward;
+	int value;
+} CitrusBotCandidate;
+
+typedef struct {
+	CitrusBotWeights weights;
+	int beam_width;
+	int max_depth;
+	// rows of each piece's cells in each rotation and the bounds of them
+	uint64_t masks[7][4][4];
+	int left[7][4];
+	int right[7][4];
+	int bottom[7][4];
+	int top[7][4];
+	// state of the current search
+	int width;
+	int height;
+	int full_height;
+	uint64_t full_row;
+	int pieces[CITRUS_BOT_MAX_PIECES];
+	int n_pieces;
+	bool can_hold;
+	CitrusVector start;	// position and rotation of the current piece
+	int start_rotation;
+	int start_hold;		// held piece, or -1
+	CitrusBotMove *moves;
+	int n_moves;
+	CitrusBotNode *nodes;
+	int n_nodes;
+	CitrusBotCandidate *candidates;
+	int n_candidates;
+	int depth;
+	int expanding;		// node being expanded at this depth
+	int stage;		// whether the node's hold has been tried
+	int best;		// best move of the deepest finished depth, or -1
+	bool done;
+	CitrusArena *arena;
+	CitrusTranspositionTable *table;	// shared between searches, or NULL
+	const CitrusBook *book;	// placements played without searching, or NULL
+	int split_index;	// first moves kept are split_index mod split_count
+	int split_count;
+	uint64_t *board;	// rows of the game's board when the search began
+	// scratch space for finding placements
+	CitrusBotState *states;
+	CitrusBotState *placements;
+	uint64_t *visited;
+	uint64_t *landed;
+	uint64_t *rows;
+	CitrusBitboard scratch;	// board of the placement being scored
+	CitrusArena scratch_arena;
+} CitrusBot;
+
 extern const CitrusPiece citrus_pieces[7];
+extern const CitrusVector citrus_kick_table[4][5];
+extern const CitrusVector citrus_i_kick_table[4][5];
 extern const CitrusGameConfig citrus_preset_modern;
 extern const CitrusGameConfig citrus_preset_delayless;
 extern const CitrusGameConfig citrus_preset_classic;
+extern const CitrusBotWeights citrus_bot_default_weights;
+extern const uint64_t citrus_bitboard_empty_block[CITRUS_BITBOARD_BLOCK_ROWS];
 
 /**
  * @brief Initializes a CitrusPiece struct.
@@ -183,13 +607,15 @@ void CitrusPiece_init(CitrusPiece * piece, const CitrusCell * piece_data,
  * @param game Struct to be initialized
  * @param board Array of config.width*config.full_height cells that will be used
  * to store the board
- * @param config Configuration options
+ * @param config Configuration options. These are referenced rather than
+ * copied, so they can be shared between games but must not be changed or freed
+ * while the game is in use
  * @param randomizer_data Private internal state for randomizer function passed
- * in config.randomizer
+ * in config->randomizer
  */
 void CitrusGame_init(CitrusGame * game, CitrusCell * board,
 		     const CitrusPiece ** next_piece_queue,
-		     CitrusGameConfig config, void *randomizer_data,
+		     const CitrusGameConfig * config, void *randomizer_data,
 		     void *action_text_data);
 
 /**
@@ -201,6 +627,43 @@ void CitrusGame_init(CitrusGame * game, CitrusCell * board,
  */
 void CitrusGame_key_down(CitrusGame * game, CitrusKey key);
 
+/**
+ * @brief Indicates a key has been pressed between two ticks.
+ * DAS and ARR are counted from the time of the press rather than from the
+ * next tick, in units of 1/config.subticks of a tick. An offset of 0 is the
+ * same as calling CitrusGame_key_down.
+ *
+ * @param game Game where key was pressed
+ * @param key Key that has been pressed
+ * @param offset Subticks between the last tick and the press, from 0 to
+ * config.subticks - 1
+ */
+void CitrusGame_key_down_at(CitrusGame * game, CitrusKey key, int offset);
+
+/**
+ * @brief Applies a list of key presses and releases in order.
+ * This gives the same result as calling CitrusGame_key_down_at and
+ * CitrusGame_key_up for each input, but the piece is only erased from and
+ * drawn onto the board once rather than for every input.
+ *
+ * @param game Game where the keys were pressed
+ * @param inputs Key presses and releases
+ * @param n Number of inputs
+ */
+void CitrusGame_apply_inputs(CitrusGame * game, const CitrusInput * inputs,
+			     int n);
+
+/**
+ * @brief Applies masks of keys pressed and released on a tick.
+ * Keys are given as bit masks, with key k represented by 1 << k, as sent by
+ * CitrusInputEncoder. Keys pressed are applied before keys released.
+ *
+ * @param game Game where the keys were pressed
+ * @param down Mask of keys pressed
+ * @param up Mask of keys released
+ */
+void CitrusGame_apply_masks(CitrusGame * game, unsigned down, unsigned up);
+
 /**
  * @brief Indicates a key has been released.
  * This should be called by the client whenever a key is released.
@@ -218,6 +681,27 @@ void CitrusGame_key_up(CitrusGame * game, CitrusKey key);
  */
 void CitrusGame_tick(CitrusGame * game);
 
+/**
+ * @brief Runs several ticks at once.
+ * This has the same effect as calling CitrusGame_tick n times, but ticks
+ * where the piece is only falling or waiting to lock are much cheaper.
+ *
+ * @param game Game to update
+ * @param n Number of ticks to run
+ */
+void CitrusGame_skip_ticks(CitrusGame * game, int n);
+
+/**
+ * @brief Returns a hash of the state of a game.
+ * Games which have been given the same inputs on the same ticks have the
+ * same checksum, so this can be used to check that a client and server
+ * agree on the state of a game.
+ *
+ * @param game Game to hash
+ * @return Hash of the board, pieces, score and lines
+ */
+uint32_t CitrusGame_checksum(CitrusGame * game);
+
 /**
  * @brief Returns whether or not the player is alive.
  * Functions including CitrusGame_key_down and CitrusGame_tick will not do
@@ -239,6 +723,49 @@ bool CitrusGame_is_alive(CitrusGame * game);
  */
 CitrusCell CitrusGame_get_cell(CitrusGame * game, CitrusVector position);
 
+/**
+ * @brief Gets the rows of the board which changed since the mask was cleared.
+ * Bit y is set if a cell in row y was changed by the piece moving, a lock or
+ * a line clear. Bit 63 stands for row 63 and every row above it. A new game
+ * starts with every row marked. Renderers, encoders and snapshots use the
+ * mask to skip unchanged rows, so when several of them follow a game the
+ * mask should only be cleared once all of them have seen it.
+ *
+ * @param game Game to check
+ * @return Mask of changed rows
+ */
+uint64_t CitrusGame_get_dirty_rows(CitrusGame * game);
+
+/**
+ * @brief Marks every row of a game's board as unchanged.
+ *
+ * @param game Game to update
+ */
+void CitrusGame_clear_dirty_rows(CitrusGame * game);
+
+/**
+ * @brief Keeps a bitboard of the full cells alongside a game's board.
+ * Collisions, drops, line clears and all clear checks then test bits rather
+ * than reading cells, which is faster on wide boards. The bitboard is
+ * built from the current board and kept up to date from then on, until the
+ * game is initialized again.
+ *
+ * @param game Game to update
+ * @param occupancy Array of CITRUS_ROW_WORDS(width)*full_height words, or
+ * NULL to go back to reading cells
+ */
+void CitrusGame_set_occupancy(CitrusGame * game, uint64_t * occupancy);
+
+/**
+ * @brief Checks whether a row is marked in a dirty row mask.
+ *
+ * @param rows Mask returned by CitrusGame_get_dirty_rows
+ * @param y Row to check, from the bottom of the board
+ * @retval true The row may have changed
+ * @retval false The row is unchanged
+ */
+bool Citrus_row_dirty(uint64_t rows, int y);
+
 /**
  * @brief Gets a piece in the next piece queue.
  *
@@ -248,6 +775,56 @@ CitrusCell CitrusGame_get_cell(CitrusGame * game, CitrusVector position);
  */
 const CitrusPiece *CitrusGame_get_next_piece(CitrusGame * game, int i);
 
+/**
+ * @brief Initializes a CitrusValidator struct.
+ * A validator replays a client's inputs on a game of its own, so that the
+ * checksums sent by the client can be checked. The game must be set up the
+ * same way as the client's game, including the randomizer seed.
+ *
+ * @param validator Struct to be initialized, aligned to 64 bytes if it is
+ * allocated at run time
+ * @param board Array of config.width*config.full_height cells
+ * @param next_piece_queue Array of config.next_piece_queue_size pieces
+ * @param config Configuration options used by the client, copied into the
+ * validator so the validator must not be moved after initialization
+ * @param randomizer_data Randomizer state, seeded the same as the client's
+ */
+void CitrusValidator_init(CitrusValidator * validator, CitrusCell * board,
+			  const CitrusPiece ** next_piece_queue,
+			  const CitrusGameConfig * config,
+			  void *randomizer_data);
+
+/**
+ * @brief Applies a client's key transitions.
+ * The game is fast forwarded to the given tick before the keys are applied,
+ * so ticks without inputs are cheap. A tick more than
+ * CITRUS_VALIDATOR_MAX_SKIP ticks ahead of the game isn't replayed, and
+ * desynced is set instead.
+ *
+ * @param validator Validator to update
+ * @param tick Number of ticks the client had run when the keys changed
+ * @param down Mask of keys pressed, with key k represented by 1 << k
+ * @param up Mask of keys released
+ */
+void CitrusValidator_input(CitrusValidator * validator, int tick,
+			   unsigned down, unsigned up);
+
+/**
+ * @brief Compares a client's checksum with the validator's game.
+ * The checksum for a tick is the result of CitrusGame_checksum after the
+ * inputs for that tick have been applied and before the next tick is run.
+ *
+ * @param validator Validator to check
+ * @param tick Tick the checksum was calculated on
+ * @param checksum Checksum calculated by the client
+ * @retval true The checksum matches, or is for a tick the validator has
+ * already replayed past and can't be compared
+ * @retval false The checksum doesn't match or the tick is too far ahead to
+ * replay, and desynced is set
+ */
+bool CitrusValidator_check(CitrusValidator * validator, int tick,
+			   uint32_t checksum);
+
 /**
  * @brief Initializes a CitrusBagRandomizer struct.
  *
@@ -264,6 +841,26 @@ void CitrusBagRandomizer_init(CitrusBagRandomizer * bag, int seed);
  */
 const CitrusPiece *CitrusBagRandomizer_randomizer(void *data);
 
+/**
+ * @brief Skips pieces from a bag.
+ * Whole bags are skipped by jumping the random number generator ahead, so
+ * this takes O(log n) time rather than generating every piece.
+ *
+ * @param bag Bag to skip pieces from
+ * @param n Number of pieces to skip
+ */
+void CitrusBagRandomizer_skip(CitrusBagRandomizer * bag, uint64_t n);
+
+/**
+ * @brief Gets the next pieces from a bag without removing them.
+ *
+ * @param bag Bag to look at
+ * @param pieces Array to store the next n pieces in
+ * @param n Number of pieces to get
+ */
+void CitrusBagRandomizer_peek(const CitrusBagRandomizer * bag,
+			      const CitrusPiece ** pieces, int n);
+
 /**
  * @brief Initializes a CitrusClassicRandomizer struct.
  *
@@ -281,6 +878,18 @@ void CitrusClassicRandomizer_init(CitrusClassicRandomizer * randomizer,
  */
 const CitrusPiece *CitrusClassicRandomizer_randomizer(void *data);
 
+/**
+ * @brief Gets the next pieces from a classic randomizer without changing it.
+ * Classic randomizers can't skip ahead quickly, since each piece uses one or
+ * two random numbers depending on the previous piece.
+ *
+ * @param randomizer Randomizer to look at
+ * @param pieces Array to store the next n pieces in
+ * @param n Number of pieces to get
+ */
+void CitrusClassicRandomizer_peek(const CitrusClassicRandomizer * randomizer,
+				  const CitrusPiece ** pieces, int n);
+
 /**
  * @brief Generates a random number between 0 and 2^32 - 1 using an internal
  * state.
@@ -289,16 +898,1143 @@ const CitrusPiece *CitrusClassicRandomizer_randomizer(void *data);
  */
 uint32_t Citrus_random(uint64_t * state);
 
+/**
+ * @brief Advances the internal state of Citrus_random by k steps in O(log k)
+ * time.
+ *
+ * @param state Pointer to 64-bit internal state
+ * @param k Number of random numbers to skip
+ */
+void Citrus_random_skip(uint64_t * state, uint64_t k);
+
+/**
+ * @brief Writes a variable length integer.
+ * Integers are written 7 bits at a time, least significant bits first, with
+ * the top bit of each byte set if more bytes follow.
+ *
+ * @param data Buffer of at least CITRUS_FRAME_HEADER_SIZE bytes to write to
+ * @param value Integer to write
+ * @return Number of bytes written
+ */
+int Citrus_write_varint(uint8_t * data, uint64_t value);
+
+/**
+ * @brief Reads a variable length integer written by Citrus_write_varint.
+ *
+ * @param data Buffer to read from
+ * @param n Number of bytes available in data
+ * @param value Integer that was read
+ * @retval >0 Number of bytes read
+ * @retval 0 More bytes are needed to read the integer
+ * @retval -1 The integer is malformed
+ */
+int Citrus_read_varint(const uint8_t * data, int n, uint64_t * value);
+
+/**
+ * @brief Writes the low bytes of an integer, least significant first.
+ *
+ * @param data Buffer of at least n bytes to write to
+ * @param value Integer to write
+ * @param n Number of bytes to write, up to 8
+ */
+void Citrus_write_le(uint8_t * data, uint64_t value, int n);
+
+/**
+ * @brief Reads an integer written by Citrus_write_le.
+ *
+ * @param data Buffer of at least n bytes to read from
+ * @param n Number of bytes to read, up to 8
+ * @return Integer that was read
+ */
+uint64_t Citrus_read_le(const uint8_t * data, int n);
+
+/**
+ * @brief Initializes a CitrusParser struct.
+ * Frames are a varint payload length followed by the payload. The buffer is
+ * only used to hold frames which are split between calls to
+ * CitrusParser_feed, so it only needs to fit the largest expected frame.
+ *
+ * @param parser Struct to be initialized
+ * @param buffer Staging buffer of at least CITRUS_FRAME_HEADER_SIZE bytes
+ * @param capacity Size of buffer
+ */
+void CitrusParser_init(CitrusParser * parser, uint8_t * buffer, int capacity);
+
+/**
+ * @brief Gives received data to the parser.
+ * The data is not copied, so it must stay valid until CitrusParser_next has
+ * returned something other than CITRUS_PARSER_FRAME.
+ *
+ * @param parser Parser to give data to
+ * @param n Number of bytes received
+ * @param data Bytes received
+ */
+void CitrusParser_feed(CitrusParser * parser, int n, const uint8_t * data);
+
+/**
+ * @brief Decodes the next frame from the received data.
+ * Frames which are contiguous in the received data are returned in place,
+ * otherwise they are assembled in the staging buffer. The frame is valid
+ * until the next call to CitrusParser_next or CitrusParser_feed.
+ *
+ * @param parser Parser to decode from
+ * @param frame Decoded frame payload
+ * @retval CITRUS_PARSER_FRAME A frame was decoded
+ * @retval CITRUS_PARSER_EMPTY All received data has been consumed
+ * @retval CITRUS_PARSER_OVERFLOW A frame split between reads doesn't fit in
+ * the staging buffer, the parser must be reinitialized before use
+ * @retval CITRUS_PARSER_INVALID The data is malformed, the parser must be
+ * reinitialized before use
+ */
+CitrusParserStatus CitrusParser_next(CitrusParser * parser,
+				     CitrusFrame * frame);
+
+/**
+ * @brief Initializes a CitrusInputEncoder struct.
+ * Inputs for many ticks are batched into a single frame. Each tick is written
+ * as a varint tick delta followed by a varint key mask, with the keys
+ * pressed in the low 8 bits and the keys released in the next 8 bits.
+ *
+ * @param encoder Struct to be initialized
+ * @param buffer Buffer the frame is written to
+ * @param capacity Size of buffer, at least 32 bytes
+ * @param client_id Id of the client the inputs are for
+ */
+void CitrusInputEncoder_init(CitrusInputEncoder * encoder, uint8_t * buffer,
+			     int capacity, int client_id);
+
+/**
+ * @brief Adds a tick's key transitions to the current batch.
+ * Ticks must be added in increasing order. Keys are given as bit masks, with
+ * key k represented by 1 << k. Keys pressed are applied before keys
+ * released, so a key can be tapped within a single tick.
+ *
+ * @param encoder Encoder to add to
+ * @param tick Tick the transitions happened on
+ * @param down Mask of keys pressed
+ * @param up Mask of keys released
+ * @retval true The transitions were added
+ * @retval false The buffer is full and the batch must be finished first
+ */
+bool CitrusInputEncoder_add(CitrusInputEncoder * encoder, int tick,
+			    unsigned down, unsigned up);
+
+/**
+ * @brief Finishes the current batch.
+ * The encoder can be used for the next batch once the frame has been sent.
+ *
+ * @param encoder Encoder to finish
+ * @param data Pointer to the encoded frame within the encoder's buffer
+ * @return Size of the encoded frame, or 0 if no inputs were added
+ */
+int CitrusInputEncoder_finish(CitrusInputEncoder * encoder, uint8_t ** data);
+
+/**
+ * @brief Encodes an event whose data is a list of varints.
+ *
+ * @param data Buffer of at least CITRUS_FRAME_HEADER_SIZE * (n + 3) bytes
+ * to write the frame to
+ * @param type Type of the event
+ * @param client_id Client the event is about
+ * @param values Integers written after the client id
+ * @param n Number of integers in values
+ * @return Size of the encoded frame
+ */
+int Citrus_write_event(uint8_t * data, CitrusEventType type, int client_id,
+		       const uint64_t * values, int n);
+
+/**
+ * @brief Writes a frame header in front of a payload.
+ *
+ * @param buffer Buffer containing CITRUS_FRAME_HEADER_SIZE bytes of free
+ * space followed by the payload
+ * @param length Size of the payload
+ * @param frame Pointer to the start of the frame within buffer
+ * @return Size of the frame
+ */
+int Citrus_finish_frame(uint8_t * buffer, int length, uint8_t ** frame);
+
+/**
+ * @brief Encodes the changes to a game's board since the previous frame.
+ * Frames store one byte per cell, 0 if the cell is empty and the color plus
+ * one if it is full. Each changed row is written as a varint row skip, a
+ * varint mask of the cells that were filled or emptied for every 64
+ * columns, then the colors of the row's full cells as varint runs of
+ * length << 3 | color.
+ *
+ * @param data Buffer to write to
+ * @param capacity Size of data
+ * @param game Game to encode the board of
+ * @param previous Frame of the last board sent, updated to the current board
+ * @param rows Rows which may have changed since previous was last updated,
+ * from CitrusGame_get_dirty_rows, or ~0 to compare every row
+ * @param keyframe Whether to encode the full board instead of the changes
+ * @return Number of bytes written, or -1 if data is too small
+ */
+int Citrus_write_board_diff(uint8_t * data, int capacity, CitrusGame * game,
+			    uint8_t * previous, uint64_t rows, bool keyframe);
+
+/**
+ * @brief Applies changes encoded by Citrus_write_board_diff to a frame.
+ *
+ * @param frame Frame of width * height cells to update
+ * @param width Width of the board
+ * @param height Full height of the board
+ * @param data Encoded changes
+ * @param length Size of data
+ * @param keyframe Whether the changes are a full board
+ * @retval true The frame was updated
+ * @retval false The data is malformed
+ */
+bool Citrus_read_board_diff(uint8_t * frame, int width, int height,
+			    const uint8_t * data, int length, bool keyframe);
+
+/**
+ * @brief Initializes an empty CitrusIdTable struct.
+ * The table is an open addressing hash table mapping non-negative ids to
+ * values, with constant time insertion, lookup and removal.
+ *
+ * @param table Struct to be initialized
+ * @param entries Array of capacity entries
+ * @param capacity Size of entries, which must be a power of two and should
+ * be at least twice the number of ids stored
+ * @retval true The table was initialized
+ * @retval false capacity isn't a power of two
+ */
+bool CitrusIdTable_init(CitrusIdTable * table, CitrusIdEntry * entries,
+			int capacity);
+
+/**
+ * @brief Adds an id to a table.
+ *
+ * @param table Table to add to
+ * @param key Id to add
+ * @param value Value to associate with the id
+ * @retval true The id was added
+ * @retval false The id is negative, already in the table or the table is
+ * full
+ */
+bool CitrusIdTable_insert(CitrusIdTable * table, int key, int value);
+
+/**
+ * @brief Looks up an id in a table.
+ *
+ * @param table Table to search
+ * @param key Id to look up
+ * @return Value associated with the id, or -1 if it isn't in the table
+ */
+int CitrusIdTable_get(CitrusIdTable * table, int key);
+
+/**
+ * @brief Removes an id from a table.
+ *
+ * @param table Table to remove from
+ * @param key Id to remove
+ * @retval true The id was removed
+ * @retval false The id wasn't in the table
+ */
+bool CitrusIdTable_remove(CitrusIdTable * table, int key);
+
+/**
+ * @brief Initializes a CitrusClientLobby struct.
+ *
+ * @param lobby Struct to be initialized
+ * @param slots Array of capacity slots, one for each client in the lobby,
+ * aligned to 64 bytes if it is allocated at run time
+ * @param active_slots Array of capacity ints used to track connected slots
+ * @param capacity Maximum number of clients in the lobby
+ * @param parser_buffer Staging buffer for frames received from the server
+ * @param parser_buffer_size Size of parser_buffer
+ * @param input_buffer Buffer used to batch inputs sent to the server
+ * @param input_buffer_size Size of input_buffer, at least 32 bytes
+ * @param send Callback used to send data to the server
+ * @param send_data Data passed to the send callback
+ */
 void CitrusClientLobby_init(CitrusClientLobby * lobby,
+			    CitrusLobbySlot * slots, int *active_slots,
+			    int capacity, uint8_t * parser_buffer,
+			    int parser_buffer_size, uint8_t * input_buffer,
+			    int input_buffer_size,
 			    void (*send)(void *send_data, int n,
 					 uint8_t * data), void *send_data);
-void CitrusClientLobby_recv(CitrusClientLobby * lobby, int n, uint8_t * data);
-void CitrusServerLobby_init(CitrusServerLobby * lobby,
-			    void (*send)(void *send_data, int n, uint8_t * data,
-					 int id), void *send_data);
-void CitrusServerLobby_client_connect(CitrusServerLobby * lobby, int id);
-void CitrusServerLobby_client_disconnect(CitrusServerLobby * lobby, int id);
-void CitrusServerLobby_recv(CitrusServerLobby * lobby, int n, uint8_t * data,
-			    int id);
+
+/**
+ * @brief Queues the local player's key transitions for a tick.
+ * Inputs are only sent when the batch is full or CitrusClientLobby_flush is
+ * called, so the caller can decide how many ticks to send at once.
+ *
+ * @param lobby Lobby to send inputs to
+ * @param tick Tick the transitions happened on
+ * @param down Mask of keys pressed, with key k represented by 1 << k
+ * @param up Mask of keys released
+ */
+void CitrusClientLobby_input(CitrusClientLobby * lobby, int tick,
+			     unsigned down, unsigned up);
+
+/**
+ * @brief Sends all queued inputs to the server with a single send call.
+ *
+ * @param lobby Lobby to flush
+ */
+void CitrusClientLobby_flush(CitrusClientLobby * lobby);
+
+/**
+ * @brief Handles data received from the server.
+ *
+ * @param lobby Lobby that received the data
+ * @param n Number of bytes received
+ * @param data Bytes received
+ * @retval true The data was handled
+ * @retval false The server sent malformed data or a frame too large for the
+ * parser buffer, and the connection should be closed
+ */
+bool CitrusClientLobby_recv(CitrusClientLobby * lobby, int n, uint8_t * data);
+
+/**
+ * @brief Sends the checksum of the local player's game to the server.
+ * Queued inputs are flushed first, so the server has every input up to the
+ * tick when it receives the checksum.
+ *
+ * @param lobby Lobby to send the checksum to
+ * @param tick Tick the checksum was calculated on
+ * @param checksum Result of CitrusGame_checksum
+ */
+void CitrusClientLobby_checksum(CitrusClientLobby * lobby, int tick,
+				uint32_t checksum);
+
+/**
+ * @brief Starts or stops spectating another client.
+ * The server then sends the client's board every tick that it changes.
+ *
+ * @param lobby Lobby the client is in
+ * @param id Id of the client to spectate, or -1 to stop spectating
+ * @param frame Array of width * height bytes to store the board in, using
+ * the format described in Citrus_write_board_diff
+ * @param width Width of the spectated board
+ * @param height Full height of the spectated board
+ */
+void CitrusClientLobby_spectate(CitrusClientLobby * lobby, int id,
+				uint8_t * frame, int width, int height);
+
+/**
+ * @brief Initializes a CitrusServerLobby struct.
+ * Clients are identified by connection ids, which can be any non-negative
+ * int, and are given a free slot when they connect. Events sent to clients
+ * refer to other clients by their slot index.
+ *
+ * @param lobby Struct to be initialized
+ * @param slots Array of capacity slots, one for each client in the lobby,
+ * aligned to 64 bytes if it is allocated at run time
+ * @param active_slots Array of capacity ints used to track connected slots
+ * @param connections Array of connections_size entries used to map
+ * connection ids to slots
+ * @param connections_size Size of connections, which must be a power of two
+ * greater than capacity
+ * @param parsers Array of capacity parsers, one for each client
+ * @param parser_buffers Array of capacity * parser_buffer_size bytes used
+ * by the parsers to stage frames
+ * @param parser_buffer_size Size of each parser's staging buffer
+ * @param output_buffers Array of capacity * output_buffer_size bytes used to
+ * collect data sent to each client during a tick
+ * @param output_buffer_size Size of each client's output buffer
+ * @param capacity Maximum number of clients in the lobby
+ * @param send Callback used to send data to the client with a connection id
+ * @param send_data Data passed to the send callback
+ * @retval true The lobby was initialized
+ * @retval false connections_size isn't a power of two greater than capacity
+ */
+bool CitrusServerLobby_init(CitrusServerLobby * lobby,
+			    CitrusLobbySlot * slots, int *active_slots,
+			    CitrusIdEntry * connections, int connections_size,
+			    CitrusParser * parsers, uint8_t * parser_buffers,
+			    int parser_buffer_size, uint8_t * output_buffers,
+			    int output_buffer_size, int capacity,
+			    void (*send)(void *send_data, int n, uint8_t * data,
+					 int id), void *send_data);
+
+/**
+ * @brief Gets the slot of a connected client.
+ * This is used to set up the client's game before calling
+ * CitrusServerLobby_start_game.
+ *
+ * @param lobby Lobby the client is in
+ * @param id Connection id of the client
+ * @return Slot of the client, or NULL if it isn't connected
+ */
+CitrusLobbySlot *CitrusServerLobby_get_slot(CitrusServerLobby * lobby, int id);
+
+/**
+ * @brief Starts ticking a client's game and applying its inputs.
+ * The game must have been initialized in the client's slot, and is given
+ * the lobby's tracer.
+ *
+ * @param lobby Lobby the client is in
+ * @param id Connection id of the client
+ */
+void CitrusServerLobby_start_game(CitrusServerLobby * lobby, int id);
+
+/**
+ * @brief Enables sending boards to spectators.
+ * Each tick, the changes to the board of every client with spectators are
+ * encoded once and the same data is queued for all of its spectators. Only
+ * the rows in each game's dirty row mask are compared, and the mask of every
+ * game is cleared at the end of the tick.
+ *
+ * @param lobby Lobby to enable spectating in
+ * @param frames Array of capacity * frame_size bytes storing the last board
+ * sent to each client's spectators
+ * @param frame_size Size of each frame, at least width * full_height of
+ * every game in the lobby
+ * @param board_buffer Buffer used to encode board updates
+ * @param board_buffer_size Size of board_buffer
+ * @param keyframe_interval Number of ticks between full boards being sent
+ */
+void CitrusServerLobby_init_spectators(CitrusServerLobby * lobby,
+				       uint8_t * frames, int frame_size,
+				       uint8_t * board_buffer,
+				       int board_buffer_size,
+				       int keyframe_interval);
+
+/**
+ * @brief Sets the validator used to check a client's game.
+ * The validator should be initialized when the client's game starts, after
+ * which every input and checksum received from the client is passed to it.
+ * A checksum for a tick past the client's last input is held until an input
+ * past its tick arrives, so it is only compared once every input it covers
+ * has been replayed.
+ *
+ * @param lobby Lobby the client is in
+ * @param id Connection id of the client
+ * @param validator Validator for the client, or NULL to stop validating
+ */
+void CitrusServerLobby_set_validator(CitrusServerLobby * lobby, int id,
+				     CitrusValidator * validator);
+
+/**
+ * @brief Queues data to be sent to a client.
+ * Data is collected in the client's output buffer and sent with a single
+ * send call at the end of CitrusServerLobby_tick, or earlier if the buffer
+ * fills up.
+ *
+ * @param lobby Lobby the client is in
+ * @param id Connection id of the client
+ * @param n Number of bytes to send
+ * @param data Bytes to send
+ */
+void CitrusServerLobby_send(CitrusServerLobby * lobby, int id, int n,
+			    uint8_t * data);
+
+/**
+ * @brief Sends all data queued for a client.
+ *
+ * @param lobby Lobby the client is in
+ * @param id Connection id of the client
+ */
+void CitrusServerLobby_flush(CitrusServerLobby * lobby, int id);
+
+/**
+ * @brief Indicates a tick has passed.
+ * Inputs received for the tick each game has reached are applied, every
+ * game in the lobby is advanced by one tick, clients are sent an
+ * acknowledgement of the last input applied to their game if it changed and
+ * all queued data is flushed. An input on tick n of a client's game is
+ * applied before the game runs its n + 1th tick, counting from
+ * CitrusServerLobby_start_game.
+ * This should be called by the server 60 times per second.
+ *
+ * @param lobby Lobby to update
+ */
+void CitrusServerLobby_tick(CitrusServerLobby * lobby);
+
+/**
+ * @brief Indicates a client has connected to the server.
+ *
+ * @param lobby Lobby the client connected to
+ * @param id Connection id of the client
+ * @retval true The client was given a slot
+ * @retval false The id is negative or already connected, or the lobby is full
+ */
+bool CitrusServerLobby_client_connect(CitrusServerLobby * lobby, int id);
+
+/**
+ * @brief Indicates a client has disconnected from the server.
+ *
+ * @param lobby Lobby the client disconnected from
+ * @param id Connection id of the client
+ */
+void CitrusServerLobby_client_disconnect(CitrusServerLobby * lobby, int id);
+
+/**
+ * @brief Handles data received from a client.
+ *
+ * @param lobby Lobby that received the data
+ * @param n Number of bytes received
+ * @param data Bytes received
+ * @param id Connection id of the client that sent the data
+ * @retval true The data was handled
+ * @retval false The client sent malformed data, a frame too large for its
+ * parser buffer or an input more than CITRUS_MAX_INPUT_LEAD ticks ahead of
+ * the lobby, and should be disconnected
+ */
+bool CitrusServerLobby_recv(CitrusServerLobby * lobby, int n, uint8_t * data,
+			    int id);
+
+/**
+ * @brief Initializes a CitrusInputQueue struct.
+ * The queue passes timestamped key presses from one input thread to one
+ * simulation thread without locking.
+ *
+ * @param queue Struct to be initialized
+ * @param inputs Array of capacity inputs
+ * @param capacity Size of inputs, which must be a power of two
+ */
+void CitrusInputQueue_init(CitrusInputQueue * queue, CitrusTimedInput * inputs,
+			   uint32_t capacity);
+
+/**
+ * @brief Adds an input to a queue, called by the input thread.
+ * Inputs must be pushed in order of time.
+ *
+ * @param queue Queue to add to
+ * @param key Key that was pressed or released
+ * @param down Whether the key was pressed
+ * @param time Time the key was pressed or released
+ * @retval true The input was added
+ * @retval false The queue is full
+ */
+bool CitrusInputQueue_push(CitrusInputQueue * queue, CitrusKey key, bool down,
+			   uint64_t time);
+
+/**
+ * @brief Removes the oldest input from a queue, called by the simulation
+ * thread.
+ *
+ * @param queue Queue to remove from
+ * @param input Input that was removed
+ * @param time Only inputs at or before this time are removed
+ * @retval true An input was removed
+ * @retval false The queue is empty or the oldest input is after time
+ */
+bool CitrusInputQueue_pop(CitrusInputQueue * queue, CitrusTimedInput * input,
+			  uint64_t time);
+
+/**
+ * @brief Applies all queued inputs during a tick to a game.
+ * This should be called by the simulation thread before running the tick
+ * that ends at start + config.subticks * subtick_length. Each press is given
+ * the offset of the subtick it happened on, so DAS and ARR are charged from
+ * the time of the press, and inputs from before start are treated as
+ * happening at start.
+ *
+ * @param queue Queue to remove inputs from
+ * @param game Game to apply the inputs to
+ * @param start Time the tick started, in the clock of the inputs
+ * @param subtick_length Length of a subtick in the clock of the inputs
+ * @return Number of inputs applied
+ */
+int CitrusInputQueue_apply(CitrusInputQueue * queue, CitrusGame * game,
+			   uint64_t start, uint64_t subtick_length);
+
+/**
+ * @brief Copies the state of a game needed to draw it into a snapshot.
+ * The current piece is stored separately from the locked cells, so the
+ * snapshot must have been initialized for the game's board size and queue
+ * size by CitrusSnapshotBuffer_init.
+ *
+ * @param game Game to copy
+ * @param snapshot Snapshot to write to
+ */
+void CitrusGame_snapshot(CitrusGame * game, CitrusSnapshot * snapshot);
+
+/**
+ * @brief Initializes a CitrusSnapshotBuffer struct.
+ * Snapshots are triple buffered so that a simulation thread can publish
+ * them while a render thread reads them, without either thread waiting.
+ *
+ * @param buffer Struct to be initialized
+ * @param cells Array of 3*width*full_height bytes used to store the boards
+ * @param next_pieces Array of 3*n_next_pieces pieces used to store the queues
+ * @param width Width of the board
+ * @param full_height Height of the board
+ * @param n_next_pieces Size of the next piece queue
+ */
+void CitrusSnapshotBuffer_init(CitrusSnapshotBuffer * buffer, uint8_t * cells,
+			       const CitrusPiece ** next_pieces, int width,
+			       int full_height, int n_next_pieces);
+
+/**
+ * @brief Gets the snapshot the simulation thread should write to.
+ *
+ * @param buffer Buffer to write to
+ * @return Snapshot which isn't visible to the reader until published
+ */
+CitrusSnapshot *CitrusSnapshotBuffer_back(CitrusSnapshotBuffer * buffer);
+
+/**
+ * @brief Copies a game into the snapshot returned by CitrusSnapshotBuffer_back.
+ * This is the same as CitrusGame_snapshot, except that only the rows changed
+ * since the back snapshot was last written are copied. Every change to the
+ * game's dirty row mask must be seen by this function before the mask is
+ * cleared, and the buffer must only be used for one game.
+ *
+ * @param buffer Buffer to write to
+ * @param game Game to copy
+ */
+void CitrusSnapshotBuffer_write(CitrusSnapshotBuffer * buffer,
+				CitrusGame * game);
+
+/**
+ * @brief Publishes the snapshot returned by CitrusSnapshotBuffer_back.
+ * The snapshot must not be used by the writer after it has been published.
+ *
+ * @param buffer Buffer to publish to
+ */
+void CitrusSnapshotBuffer_publish(CitrusSnapshotBuffer * buffer);
+
+/**
+ * @brief Gets the most recently published snapshot, called by the render
+ * thread.
+ *
+ * @param buffer Buffer to read from
+ * @return Snapshot which stays valid until the next call to this function
+ */
+const CitrusSnapshot *CitrusSnapshotBuffer_read(CitrusSnapshotBuffer * buffer);
+
+/**
+ * @brief Initializes a CitrusRenderer struct.
+ * The renderer draws boards to a terminal using ANSI escape codes, only
+ * writing the cells which changed since the last frame. Each cell is two
+ * columns wide.
+ *
+ * @param renderer Struct to be initialized
+ * @param frames Array of 2*width*height bytes used to store frames
+ * @param width Width of the board
+ * @param height Number of rows to draw, from the bottom of the board
+ * @param row Terminal row to draw the top of the board at, starting from 1
+ * @param column Terminal column to draw the left of the board at, starting
+ * from 1
+ */
+void CitrusRenderer_init(CitrusRenderer * renderer, uint8_t * frames, int width,
+			 int height, int row, int column);
+
+/**
+ * @brief Makes the next frame redraw every cell.
+ * This should be called if the terminal has been cleared or resized.
+ *
+ * @param renderer Renderer to reset
+ */
+void CitrusRenderer_invalidate(CitrusRenderer * renderer);
+
+/**
+ * @brief Writes the escape codes to update the terminal to a new frame.
+ * Cells are 0 if empty, color + 1 if full and color + 8 if they are part of
+ * a shadow, which matches the frames updated by Citrus_read_board_diff.
+ *
+ * @param renderer Renderer to draw with
+ * @param frame Frame of width*height cells, with the bottom row first
+ * @param buffer Buffer to write the escape codes to
+ * @param capacity Size of buffer, CITRUS_RENDER_BUFFER_SIZE is always enough
+ * @return Number of bytes written, or -1 if buffer is too small in which case
+ * the next frame is redrawn in full
+ */
+int CitrusRenderer_draw_frame(CitrusRenderer * renderer, const uint8_t * frame,
+			      uint8_t * buffer, int capacity);
+
+/**
+ * @brief Writes the escape codes to update the terminal to a game's board.
+ * Only the rows in the game's dirty row mask are read, so the renderer must
+ * be invalidated before drawing a different game, and changes to the mask must
+ * be drawn before it is cleared.
+ *
+ * @param renderer Renderer to draw with, which must be the same width as the
+ * game's board
+ * @param game Game to draw
+ * @param buffer Buffer to write the escape codes to
+ * @param capacity Size of buffer, CITRUS_RENDER_BUFFER_SIZE is always enough
+ * @return Number of bytes written, or -1 if buffer is too small
+ */
+int CitrusRenderer_draw_game(CitrusRenderer * renderer, CitrusGame * game,
+			     uint8_t * buffer, int capacity);
+
+/**
+ * @brief Initializes a CitrusTracer struct.
+ * The tracer keeps the most recent records in a ring buffer, overwriting
+ * the oldest once it is full. Tracing functions do nothing when passed a
+ * NULL tracer, so tracing can be left compiled in and enabled by setting a
+ * tracer.
+ *
+ * @param tracer Struct to be initialized
+ * @param records Array of capacity records
+ * @param capacity Size of records, which must be a power of two
+ * @param clock Returns the current time, e.g. in nanoseconds
+ * @param clock_data Data passed to clock
+ */
+void CitrusTracer_init(CitrusTracer * tracer, CitrusTraceRecord * records,
+		       uint32_t capacity, uint64_t (*clock)(void *clock_data),
+		       void *clock_data);
+
+/**
+ * @brief Adds a record to a tracer.
+ *
+ * @param tracer Tracer to add to, or NULL to do nothing
+ * @param name What is being traced
+ * @param phase Whether a span begins or ends, or the event is instant
+ * @param id Slot the event is about, or -1 for the lobby
+ * @param arg Extra information about the event, such as a size
+ */
+void CitrusTracer_record(CitrusTracer * tracer, CitrusTraceName name,
+			 CitrusTracePhase phase, int id, int arg);
+
+/**
+ * @brief Copies the records kept by a tracer, oldest first.
+ *
+ * @param tracer Tracer to copy from
+ * @param records Array to copy to
+ * @param capacity Size of records
+ * @return Number of records copied
+ */
+int CitrusTracer_copy(CitrusTracer * tracer, CitrusTraceRecord * records,
+		      int capacity);
+
+/**
+ * @brief Sets the tracer a game records its locks, line clears and top outs
+ * to.
+ *
+ * @param game Game to trace
+ * @param tracer Tracer to record to, or NULL to disable tracing
+ * @param id Id given to the game's records
+ */
+void CitrusGame_set_tracer(CitrusGame * game, CitrusTracer * tracer, int id);
+
+/**
+ * @brief Sets the tracer a lobby records its ticks, receives, parses and
+ * sends to.
+ * The games in the lobby are also traced, using their slot as the id.
+ *
+ * @param lobby Lobby to trace
+ * @param tracer Tracer to record to, or NULL to disable tracing
+ */
+void CitrusServerLobby_set_tracer(CitrusServerLobby * lobby,
+				  CitrusTracer * tracer);
+
+/**
+ * @brief Gets the index of a piece in citrus_pieces.
+ *
+ * @param piece Piece to look up
+ * @return Index of the piece, or 7 if it isn't one of citrus_pieces
+ */
+uint32_t Citrus_piece_index(const CitrusPiece * piece);
+
+/**
+ * @brief Initializes a CitrusArena struct.
+ * An arena hands out memory from a caller supplied buffer, which is all
+ * freed at once by resetting it.
+ *
+ * @param arena Struct to be initialized
+ * @param data Buffer to allocate from
+ * @param capacity Size of data
+ */
+void CitrusArena_init(CitrusArena * arena, void *data, size_t capacity);
+
+/**
+ * @brief Allocates memory from an arena, aligned to 16 bytes.
+ *
+ * @param arena Arena to allocate from
+ * @param size Number of bytes to allocate
+ * @return Pointer to the memory, or NULL if the arena is full
+ */
+void *CitrusArena_alloc(CitrusArena * arena, size_t size);
+
+/**
+ * @brief Frees everything allocated from an arena.
+ *
+ * @param arena Arena to reset
+ */
+void CitrusArena_reset(CitrusArena * arena);
+
+/**
+ * @brief Initializes a CitrusBitboard struct as an empty board.
+ * Boards are made of blocks of rows which are shared between copies of a
+ * board until one of them changes a row in the block, so copying a board
+ * only copies the pointers to its blocks. Empty blocks all point to
+ * citrus_bitboard_empty_block.
+ *
+ * @param board Struct to be initialized
+ * @param blocks Array of n_blocks pointers used to hold the board's blocks
+ * @param n_blocks Number of blocks, enough for the height of the board
+ */
+void CitrusBitboard_init(CitrusBitboard * board, const uint64_t ** blocks,
+			 int n_blocks);
+
+/**
+ * @brief Makes a board a copy of another board, sharing all its blocks.
+ * The source board must not be changed while blocks are shared with it,
+ * as it writes to its own blocks in place.
+ *
+ * @param board Board to copy to
+ * @param source Board to copy, with the same number of blocks
+ */
+void CitrusBitboard_copy(CitrusBitboard * board,
+			 const CitrusBitboard * source);
+
+/**
+ * @brief Gets a row of a board.
+ *
+ * @param board Board to read
+ * @param y Row to get, from the bottom
+ * @return Cells of the row, with bit x set if the cell is full
+ */
+uint64_t CitrusBitboard_get_row(const CitrusBitboard * board, int y);
+
+/**
+ * @brief Sets a row of a board, copying its block first if it is shared.
+ *
+ * @param board Board to change
+ * @param arena Arena to allocate a copied block from
+ * @param y Row to set, from the bottom
+ * @param row Cells of the row, with bit x set if the cell is full
+ * @retval true The row was set
+ * @retval false The arena is full
+ */
+bool CitrusBitboard_set_row(CitrusBitboard * board, CitrusArena * arena,
+			    int y, uint64_t row);
+
+/**
+ * @brief Removes full rows from a board, moving the rows above down.
+ * Only the blocks from the lowest full row up to the top of the stack are
+ * copied.
+ *
+ * @param board Board to change
+ * @param arena Arena to allocate copied blocks from
+ * @param full_row Value of a full row
+ * @return Number of rows removed, or -1 if the arena is full in which case
+ * the board is left partly cleared
+ */
+int CitrusBitboard_clear_lines(CitrusBitboard * board, CitrusArena * arena,
+			       uint64_t full_row);
+
+/**
+ * @brief Initializes a CitrusBot struct with citrus_bot_default_weights.
+ * The bot plays the standard pieces on boards up to 60 cells wide.
+ *
+ * @param bot Struct to be initialized
+ * @param beam_width Number of boards kept after placing each piece
+ * @param max_depth Number of pieces to place in each search, which is also
+ * limited by the current piece, the hold piece and the next piece queue
+ */
+void CitrusBot_init(CitrusBot * bot, int beam_width, int max_depth);
+
+/**
+ * @brief Starts a search for where to place a game's current piece.
+ * The search places the current piece and the pieces in the queue, using
+ * hold if it is available, and keeps the best beam_width boards after each
+ * piece. Everything used by the search comes from the arena, which is reset
+ * here and must not be used by anything else until the search is over. If
+ * the bot has an opening book with the game's state in it, the search is
+ * already finished when this returns.
+ *
+ * @param bot Bot to search with
+ * @param game Game to play, which must have a piece in play
+ * @param arena Arena to allocate the search from, which should be a few
+ * hundred kilobytes for a 10x40 board with a beam width of 64
+ * @retval true The search has started
+ * @retval false The arena is too small or the game can't be played by the
+ * bot
+ */
+bool CitrusBot_begin(CitrusBot * bot, CitrusGame * game, CitrusArena * arena);
+
+/**
+ * @brief Continues a search for a limited amount of work.
+ * Each unit of work finds every placement of one piece on one board and
+ * scores them, so the time a step takes is bounded by the budget. This
+ * allows the search to be spread over several ticks.
+ *
+ * @param bot Bot which has begun a search
+ * @param budget Maximum number of placement searches to do
+ * @retval true The search is finished
+ * @retval false There is more of the search left
+ */
+bool CitrusBot_step(CitrusBot * bot, int budget);
+
+/**
+ * @brief Gets the best move found so far.
+ * This is the best move after the deepest depth the search has finished,
+ * or the best placement of the first piece seen if no depth has finished.
+ *
+ * @param bot Bot which has begun a search
+ * @param move Set to the best move
+ * @retval true A move was found
+ * @retval false No move has been found yet, or every move tops out
+ */
+bool CitrusBot_best_so_far(CitrusBot * bot, CitrusBotMove * move);
+
+/**
+ * @brief Ends a search and plays the best move found so far.
+ * If the piece has fallen or moved since the search began, the keys are
+ * found again from where the piece is now.
+ *
+ * @param bot Bot which has begun a search
+ * @param game Game the search began from
+ * @param move Set to the move played, or NULL
+ * @retval true The move was played
+ * @retval false No move has been found, the game has moved on to another
+ * piece or the chosen place can no longer be reached
+ */
+bool CitrusBot_commit(CitrusBot * bot, CitrusGame * game,
+		      CitrusBotMove * move);
+
+/**
+ * @brief Searches for where to place a game's current piece without a
+ * budget.
+ * This is the same as CitrusBot_begin and stepping until the search is
+ * finished, except the move isn't played.
+ *
+ * @param bot Bot to search with
+ * @param game Game to play, which must have a piece in play
+ * @param arena Arena to allocate the search from
+ * @param move Set to the chosen move
+ * @retval true A move was found
+ * @retval false Every move tops out, the arena is too small or the game
+ * can't be played by the bot
+ */
+bool CitrusBot_plan(CitrusBot * bot, CitrusGame * game, CitrusArena * arena,
+		    CitrusBotMove * move);
+
+/**
+ * @brief Makes a bot share a transposition table.
+ * When a search reaches a board with the same pieces left as another
+ * branch, or another bot sharing the table, only the better of the two is
+ * kept, so bots searching different moves in parallel don't repeat work.
+ *
+ * @param bot Bot to set the table of
+ * @param table Table to share, or NULL to not use one
+ */
+void CitrusBot_set_table(CitrusBot * bot, CitrusTranspositionTable * table);
+
+/**
+ * @brief Limits a bot's searches to some of the first moves.
+ * Each first move is numbered, and the bot only searches the ones where
+ * the number mod count is index. This lets count bots search every move
+ * between them.
+ *
+ * @param bot Bot to limit
+ * @param index Which share of the moves to search
+ * @param count Number of shares, or 1 to search every move
+ */
+void CitrusBot_set_split(CitrusBot * bot, int index, int count);
+
+/**
+ * @brief Makes a bot play placements from an opening book.
+ * When CitrusBot_begin finds the game's state in the book, the search is
+ * finished straight away with the book's placement as the best move.
+ *
+ * @param bot Bot to set the book of
+ * @param book Book to use, or NULL to always search
+ */
+void CitrusBot_set_book(CitrusBot * bot, const CitrusBook * book);
+
+/**
+ * @brief Gets the opening book key of the state a search began from.
+ * The key is a hash of the board size, the locked cells, the current piece,
+ * n_next next pieces, the held piece and whether holding is allowed. It is
+ * only valid after a successful call to CitrusBot_begin.
+ *
+ * @param bot Bot that began a search
+ * @param n_next Number of next pieces to include, which must be less than
+ * the number of pieces the search knows about
+ * @return Key of the state
+ */
+uint64_t CitrusBot_book_key(CitrusBot * bot, int n_next);
+
+/**
+ * @brief Initializes a CitrusBook struct from a buffer holding a book.
+ * A book is a 16 byte header of "CTOB", then the little endian 16 bit
+ * version 1 and number of next pieces in each key, then the 32 bit number
+ * of entries and 4 reserved bytes. It is followed by 16 byte entries sorted
+ * by key, each with a 64 bit key, a 32 bit value, the x, y and rotation of
+ * the placement and whether it holds first. Lookups read the buffer in
+ * place, so it can be a read only mapping of a book file, and it must stay
+ * valid while the book is used.
+ *
+ * @param book Struct to be initialized
+ * @param data Buffer holding the book
+ * @param size Size of data
+ * @retval true The book was initialized
+ * @retval false The header is invalid or data is too small for the entries
+ */
+bool CitrusBook_init(CitrusBook * book, const uint8_t * data, size_t size);
+
+/**
+ * @brief Finds the entry with a key using a binary search.
+ *
+ * @param book Book to search
+ * @param key Key from CitrusBot_book_key
+ * @param entry Set to the entry if it was found
+ * @retval true The key was found
+ * @retval false The book has no entry for the key
+ */
+bool CitrusBook_lookup(const CitrusBook * book, uint64_t key,
+		       CitrusBookEntry * entry);
+
+/**
+ * @brief Writes a book in the format read by CitrusBook_init.
+ *
+ * @param data Buffer to write to
+ * @param capacity Size of data
+ * @param entries Entries sorted by key, with no two keys the same
+ * @param n_entries Number of entries
+ * @param n_next Number of next pieces included in each key
+ * @return Size of the book, or 0 if data is too small or the entries aren't
+ * sorted
+ */
+size_t CitrusBook_write(uint8_t * data, size_t capacity,
+			const CitrusBookEntry * entries, uint32_t n_entries,
+			int n_next);
+
+/**
+ * @brief Initializes a CitrusTranspositionTable struct.
+ * The table can be shared between threads without locking. Each entry is
+ * written as two words which are checked against each other on lookup, so
+ * an entry torn by two threads writing at once reads as missing rather
+ * than wrong.
+ *
+ * @param table Struct to be initialized
+ * @param entries Array of capacity entries
+ * @param capacity Size of entries, which must be a power of two
+ */
+void CitrusTranspositionTable_init(CitrusTranspositionTable * table,
+				   CitrusTableEntry * entries,
+				   uint32_t capacity);
+
+/**
+ * @brief Starts a new search, so entries stored before are ignored.
+ * This must not be called while the table is being used by other threads.
+ *
+ * @param table Table to reset
+ */
+void CitrusTranspositionTable_new_search(CitrusTranspositionTable * table);
+
+/**
+ * @brief Looks up a position in a table.
+ *
+ * @param table Table to look in
+ * @param key Hash of the position
+ * @param value Set to the value stored
+ * @param depth Set to the depth stored
+ * @retval true The position was found
+ * @retval false The position isn't in the table
+ */
+bool CitrusTranspositionTable_probe(CitrusTranspositionTable * table,
+				    uint64_t key, int *value, int *depth);
+
+/**
+ * @brief Stores a position in a table, replacing whatever was in its entry.
+ *
+ * @param table Table to store in
+ * @param key Hash of the position
+ * @param value Value to store
+ * @param depth Depth to store, from 0 to 255
+ */
+void CitrusTranspositionTable_store(CitrusTranspositionTable * table,
+				    uint64_t key, int value, int depth);
+
+/**
+ * @brief Taps the keys of a move in a game.
+ * This must be called before the game ticks again, as the keys move the
+ * piece from where it was when the move was planned.
+ *
+ * @param move Move to play
+ * @param game Game to play it in
+ */
+void CitrusBotMove_apply(const CitrusBotMove * move, CitrusGame * game);
+
+/**
+ * @brief Works out where each part of an observation goes.
+ * An observation is a flat array of bytes, which are 0 or 1 apart from the
+ * scalars. The board and piece planes have a byte per cell, with row y at
+ * offset y*width, so the bottom row comes first. Scalars larger than 255
+ * are clamped.
+ *
+ * @param layout Struct to be initialized
+ * @param width Width of the games' boards
+ * @param full_height Full height of the games' boards
+ * @param n_next Number of pieces of the queue to include, which must be at
+ * most the games' next_piece_queue_size
+ */
+void CitrusObservationLayout_init(CitrusObservationLayout * layout, int width,
+				  int full_height, int n_next);
+
+/**
+ * @brief Writes an observation of a game.
+ *
+ * @param game Game to observe
+ * @param layout Layout to write in
+ * @param observation Array of layout->size bytes to write to
+ */
+void CitrusGame_observe(CitrusGame * game,
+			const CitrusObservationLayout * layout,
+			uint8_t * observation);
+
+/**
+ * @brief Writes observations of a batch of games to one tensor.
+ * Observation i starts at byte i*layout->size, so the tensor can be passed
+ * to a training loop as an n by layout->size array without copying.
+ *
+ * @param games Array of n games, all with the same board size
+ * @param n Number of games
+ * @param layout Layout to write in
+ * @param tensor Array of n*layout->size bytes to write to
+ */
+void Citrus_observe_batch(CitrusGame * const *games, int n,
+			  const CitrusObservationLayout * layout,
+			  uint8_t * tensor);
+
+/**
+ * @brief Initializes a CitrusRecordWriter struct and adds the header.
+ * The writer streams records of an observation, an action and a reward.
+ * The stream starts with a CITRUS_RECORD_HEADER_SIZE byte header of the
+ * magic bytes "CTRC", then little endian 16-bit version (1), width,
+ * full_height and n_next, and a 32-bit record size. Each record is the
+ * observation followed by the action and reward as little endian 32-bit
+ * integers.
+ *
+ * @param writer Struct to be initialized
+ * @param layout Layout of the observations
+ * @param buffer Buffer to collect records in before writing them
+ * @param capacity Size of buffer
+ * @param write Called with the bytes to append to the stream
+ * @param data Data passed to write
+ * @retval true The writer was initialized
+ * @retval false capacity can't fit the header and one record, and the writer
+ * mustn't be used
+ */
+bool CitrusRecordWriter_init(CitrusRecordWriter * writer,
+			     const CitrusObservationLayout * layout,
+			     uint8_t * buffer, int capacity,
+			     bool (*write)(void *data, const uint8_t * bytes,
+					   int n), void *data);
+
+/**
+ * @brief Adds a record of a game's observation, an action and a reward.
+ * The observation is written straight into the writer's buffer.
+ *
+ * @param writer Writer to add to
+ * @param game Game to observe
+ * @param action Action taken, with a meaning chosen by the caller
+ * @param reward Reward received for the action
+ * @retval true The record was added
+ * @retval false Writing the buffered records failed
+ */
+bool CitrusRecordWriter_add(CitrusRecordWriter * writer, CitrusGame * game,
+			    int32_t action, int32_t reward);
+
+/**
+ * @brief Writes every buffered record.
+ *
+ * @param writer Writer to flush
+ * @retval true The records were written
+ * @retval false write returned false, and the records are kept
+ */
+bool CitrusRecordWriter_flush(CitrusRecordWriter * writer);
 
 #endif
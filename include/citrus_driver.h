@@ -0,0 +1,270 @@
+/* Copyright (C) 2026 RZ781
+ *
+ * This file is part of libcitrus.
+ *
+ * libcitrus is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 2.1 of the License, or (at your option)
+ * any later version.
+ *
+ * libcitrus is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// Optional drivers for running libcitrus on many threads. Unlike the core
+// library, these depend on libc and pthreads and are built separately into
+// libcitrus_driver.a.
+
+#ifndef CITRUS_DRIVER_H
+#define CITRUS_DRIVER_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "citrus.h"
+
+typedef struct {
+	// written by the producer
+	_Alignas(64) uint64_t head;
+	// written by the consumer
+	_Alignas(64) uint64_t tail;
+	_Alignas(64) uint8_t *buffer;
+	uint64_t capacity;	// always a power of two
+} CitrusRing;
+
+typedef enum {
+	CITRUS_MESSAGE_CONNECT,
+	CITRUS_MESSAGE_DISCONNECT,
+	CITRUS_MESSAGE_RECV
+} CitrusMessageType;
+
+typedef struct {
+	int type;
+	int lobby;
+	int id;
+	int length;		// bytes of received data following the message
+} CitrusMessage;
+
+typedef struct {
+	int n_workers;		// threads running lobbies
+	int n_io_threads;	// threads handing received data to workers
+	int n_lobbies;
+	int lobby_capacity;	// clients per lobby
+	int parser_buffer_size;
+	int output_buffer_size;
+	int max_message_size;	// largest amount of data passed to recv
+	int ring_size;		// bytes in each io thread to worker ring
+	int tick_rate;		// ticks per second
+	bool pin_threads;	// whether to pin each worker to a cpu
+	// called on a worker thread when data is sent to a client
+	void (*send)(void *data, int n, uint8_t * bytes, int id);
+	// called on a worker thread after a client connects, so its game can
+	// be set up, may be NULL
+	void (*connect)(void *data, CitrusServerLobby * lobby, int id);
+	void *data;
+} CitrusServerConfig;
+
+typedef struct {
+	CitrusServerLobby *lobbies;
+	CitrusRing *rings;	// n_io_threads rings per worker
+	uint8_t *message_buffer;
+	pthread_t thread;
+	int index;
+	struct CitrusServer *server;
+	// statistics, only updated by the worker
+	uint64_t ticks;
+	uint64_t late_ticks;	// ticks which started after their deadline
+	uint64_t messages;
+	uint64_t tick_ns_total;
+	uint64_t tick_ns_max;
+} CitrusServerWorker;
+
+typedef struct CitrusServer {
+	CitrusServerConfig config;
+	CitrusServerWorker *workers;
+	CitrusServerLobby *lobbies;
+	void *memory;		// single allocation holding every lobby's buffers
+	bool running;
+} CitrusServer;
+
+typedef struct {
+	CitrusBot bot;
+	CitrusArena arena;
+	pthread_t thread;
+	struct CitrusParallelBot *parallel;
+	CitrusBotMove move;
+	bool found;
+} CitrusBotWorker;
+
+typedef struct CitrusParallelBot {
+	CitrusBotWorker *workers;
+	int n_workers;
+	CitrusTranspositionTable table;
+	void *memory;		// single allocation holding arenas and the table
+	CitrusGame *game;	// game being planned for
+} CitrusParallelBot;
+
+/**
+ * @brief Initializes a CitrusRing struct.
+ * The ring is a lock-free queue of messages with a single producer thread
+ * and a single consumer thread.
+ *
+ * @param ring Struct to be initialized
+ * @param buffer Array of capacity bytes
+ * @param capacity Size of buffer, which must be a power of two
+ */
+void CitrusRing_init(CitrusRing * ring, uint8_t * buffer, uint64_t capacity);
+
+/**
+ * @brief Adds a message to a ring, called by the producer.
+ *
+ * @param ring Ring to add to
+ * @param message Message to add
+ * @param data message->length bytes following the message
+ * @retval true The message was added
+ * @retval false The ring is full, so the producer should retry later
+ */
+bool CitrusRing_push(CitrusRing * ring, const CitrusMessage * message,
+		     const uint8_t * data);
+
+/**
+ * @brief Removes a message from a ring, called by the consumer.
+ *
+ * @param ring Ring to remove from
+ * @param message Message that was removed
+ * @param data Buffer of at least message->length bytes to copy data into
+ * @param capacity Size of data
+ * @retval true A message was removed
+ * @retval false The ring is empty
+ */
+bool CitrusRing_pop(CitrusRing * ring, CitrusMessage * message,
+		    uint8_t * data, int capacity);
+
+/**
+ * @brief Initializes a CitrusServer struct and allocates its lobbies.
+ * Lobby i is run by worker i % n_workers, so all of a lobby's clients are
+ * handled by a single thread.
+ *
+ * @param server Struct to be initialized
+ * @param config Configuration options
+ * @retval true The server was initialized
+ * @retval false Memory could not be allocated
+ */
+bool CitrusServer_init(CitrusServer * server, const CitrusServerConfig * config);
+
+/**
+ * @brief Starts the worker threads.
+ *
+ * @param server Server to start
+ * @retval true The threads were started
+ * @retval false A thread could not be created
+ */
+bool CitrusServer_start(CitrusServer * server);
+
+/**
+ * @brief Stops the worker threads and waits for them to exit.
+ *
+ * @param server Server to stop
+ */
+void CitrusServer_stop(CitrusServer * server);
+
+/**
+ * @brief Frees the memory allocated by CitrusServer_init.
+ *
+ * @param server Server to destroy, which must not be running
+ */
+void CitrusServer_destroy(CitrusServer * server);
+
+/**
+ * @brief Hands a new connection to the worker running a lobby.
+ * Each io thread must use a different io index, and the same io index
+ * must not be used by two threads at once.
+ *
+ * @param server Server the lobby is in
+ * @param io Index of the calling io thread
+ * @param lobby Index of the lobby the client is joining
+ * @param id Connection id of the client
+ * @retval true The message was queued
+ * @retval false The worker's ring is full and the call should be retried
+ */
+bool CitrusServer_connect(CitrusServer * server, int io, int lobby, int id);
+
+/**
+ * @brief Hands a closed connection to the worker running a lobby.
+ *
+ * @param server Server the lobby is in
+ * @param io Index of the calling io thread
+ * @param lobby Index of the lobby the client is in
+ * @param id Connection id of the client
+ * @retval true The message was queued
+ * @retval false The worker's ring is full and the call should be retried
+ */
+bool CitrusServer_disconnect(CitrusServer * server, int io, int lobby, int id);
+
+/**
+ * @brief Hands received data to the worker running a lobby.
+ * The data is copied into the ring, so it can be reused once this returns.
+ * Clients sending malformed data are disconnected from the lobby.
+ *
+ * @param server Server the lobby is in
+ * @param io Index of the calling io thread
+ * @param lobby Index of the lobby the client is in
+ * @param id Connection id of the client
+ * @param n Number of bytes received, at most config.max_message_size
+ * @param data Bytes received
+ * @retval true The message was queued
+ * @retval false The worker's ring is full and the call should be retried
+ */
+bool CitrusServer_recv(CitrusServer * server, int io, int lobby, int id,
+		       int n, const uint8_t * data);
+
+/**
+ * @brief Initializes a CitrusParallelBot struct and allocates its memory.
+ * The first moves are split between the workers, which each run a beam
+ * search over their share with an even share of the beam width, and share
+ * a transposition table so branches reaching the same board are only
+ * searched once.
+ *
+ * @param bot Struct to be initialized
+ * @param n_workers Number of threads to search with, including the one
+ * calling CitrusParallelBot_plan
+ * @param beam_width Total number of boards kept after placing each piece
+ * @param max_depth Number of pieces to place in each search
+ * @param arena_size Bytes of arena for each worker
+ * @param table_size Entries in the transposition table, rounded up to a
+ * power of two
+ * @retval true The bot was initialized
+ * @retval false Memory could not be allocated
+ */
+bool CitrusParallelBot_init(CitrusParallelBot * bot, int n_workers,
+			    int beam_width, int max_depth, size_t arena_size,
+			    uint32_t table_size);
+
+/**
+ * @brief Chooses where to place a game's current piece using every worker.
+ * The game must not be changed until this returns. As the workers race to
+ * fill the table, the move chosen can differ between runs.
+ *
+ * @param bot Bot to search with
+ * @param game Game to play
+ * @param move Set to the chosen move
+ * @retval true A move was found
+ * @retval false No worker found a move, or a thread could not be created
+ */
+bool CitrusParallelBot_plan(CitrusParallelBot * bot, CitrusGame * game,
+			    CitrusBotMove * move);
+
+/**
+ * @brief Frees the memory allocated by CitrusParallelBot_init.
+ *
+ * @param bot Bot to destroy
+ */
+void CitrusParallelBot_destroy(CitrusParallelBot * bot);
+
+#endif
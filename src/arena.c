@@ -0,0 +1,48 @@
+/* Copyright (C) 2026 RZ781
+ *
+ * This file is part of libcitrus.
+ *
+ * libcitrus is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 2.1 of the License, or (at your option)
+ * any later version.
+ *
+ * libcitrus is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include "citrus.h"
+
+// initialise an empty arena over a buffer
+void CitrusArena_init(CitrusArena *arena, void *data, size_t capacity)
+{
+	arena->data = data;
+	arena->capacity = capacity;
+	arena->used = 0;
+}
+
+// allocate 16 byte aligned memory, or return NULL if there isn't enough
+void *CitrusArena_alloc(CitrusArena *arena, size_t size)
+{
+	uintptr_t address = (uintptr_t) (arena->data + arena->used);
+	size_t padding = (16 - (address & 15)) & 15;
+	if (padding + size > arena->capacity - arena->used) {
+		return NULL;
+	}
+	void *memory = arena->data + arena->used + padding;
+	arena->used += padding + size;
+	return memory;
+}
+
+// free everything allocated from the arena
+void CitrusArena_reset(CitrusArena *arena)
+{
+	arena->used = 0;
+}
@@ -0,0 +1,127 @@
+/* Copyright (C) 2026 RZ781
+ *
+ * This file is part of libcitrus.
+ *
+ * libcitrus is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 2.1 of the License, or (at your option)
+ * any later version.
+ *
+ * libcitrus is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "citrus.h"
+
+// block shared by every board for rows that are all empty
+const uint64_t citrus_bitboard_empty_block[CITRUS_BITBOARD_BLOCK_ROWS] = { 0 };
+
+// initialise an empty board
+void CitrusBitboard_init(CitrusBitboard *board, const uint64_t **blocks,
+			 int n_blocks)
+{
+	board->blocks = blocks;
+	board->n_blocks = n_blocks;
+	board->owned = 0;
+	for (int i = 0; i < n_blocks; i++) {
+		blocks[i] = citrus_bitboard_empty_block;
+	}
+}
+
+// make a board share every block of another board of the same size
+void CitrusBitboard_copy(CitrusBitboard *board, const CitrusBitboard *source)
+{
+	for (int i = 0; i < board->n_blocks; i++) {
+		board->blocks[i] = source->blocks[i];
+	}
+	board->owned = 0;
+}
+
+// get a row of the board
+uint64_t CitrusBitboard_get_row(const CitrusBitboard *board, int y)
+{
+	return board->blocks[y / CITRUS_BITBOARD_BLOCK_ROWS]
+	    [y % CITRUS_BITBOARD_BLOCK_ROWS];
+}
+
+// set a row, copying its block first if it's shared
+bool CitrusBitboard_set_row(CitrusBitboard *board, CitrusArena *arena, int y,
+			    uint64_t row)
+{
+	int i = y / CITRUS_BITBOARD_BLOCK_ROWS;
+	const uint64_t *block = board->blocks[i];
+	if (block[y % CITRUS_BITBOARD_BLOCK_ROWS] == row) {
+		return true;
+	}
+	if (!(board->owned & (uint32_t) 1 << i)) {
+		uint64_t *copy = CitrusArena_alloc(arena,
+						   CITRUS_BITBOARD_BLOCK_ROWS *
+						   sizeof(uint64_t));
+		if (copy == NULL) {
+			return false;
+		}
+		for (int j = 0; j < CITRUS_BITBOARD_BLOCK_ROWS; j++) {
+			copy[j] = block[j];
+		}
+		board->blocks[i] = copy;
+		board->owned |= (uint32_t) 1 << i;
+	}
+	// only blocks this board allocated are ever written to
+	uint64_t *owned = (uint64_t *) board->blocks[i];
+	owned[y % CITRUS_BITBOARD_BLOCK_ROWS] = row;
+	if (row != 0) {
+		return true;
+	}
+	// blocks which become empty go back to the shared empty block, so
+	// equal boards always have the same empty blocks
+	for (int j = 0; j < CITRUS_BITBOARD_BLOCK_ROWS; j++) {
+		if (owned[j] != 0) {
+			return true;
+		}
+	}
+	board->blocks[i] = citrus_bitboard_empty_block;
+	board->owned &= ~((uint32_t) 1 << i);
+	return true;
+}
+
+// remove full rows and move the rows above them down, returning the number
+// of rows removed or -1 if the arena is full
+int CitrusBitboard_clear_lines(CitrusBitboard *board, CitrusArena *arena,
+			       uint64_t full_row)
+{
+	int height = board->n_blocks * CITRUS_BITBOARD_BLOCK_ROWS;
+	int n = 0;
+	for (int y = 0; y < height; y++) {
+		// rows are only moved once the first full row has been passed
+		if (n == y && y % CITRUS_BITBOARD_BLOCK_ROWS == 0
+		    && board->blocks[y / CITRUS_BITBOARD_BLOCK_ROWS]
+		    == citrus_bitboard_empty_block) {
+			n += CITRUS_BITBOARD_BLOCK_ROWS;
+			y += CITRUS_BITBOARD_BLOCK_ROWS - 1;
+			continue;
+		}
+		uint64_t row = CitrusBitboard_get_row(board, y);
+		if (row == full_row) {
+			continue;
+		}
+		if (!CitrusBitboard_set_row(board, arena, n, row)) {
+			return -1;
+		}
+		n++;
+	}
+	int cleared = height - n;
+	for (; n < height; n++) {
+		if (!CitrusBitboard_set_row(board, arena, n, 0)) {
+			return -1;
+		}
+	}
+	return cleared;
+}
@@ -0,0 +1,114 @@
+/* Copyright (C) 2026 RZ781
+ *
+ * This file is part of libcitrus.
+ *
+ * libcitrus is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 2.1 of the License, or (at your option)
+ * any later version.
+ *
+ * libcitrus is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "citrus.h"
+
+// check the header of a book in a caller's buffer without copying it
+bool CitrusBook_init(CitrusBook *book, const uint8_t *data, size_t size)
+{
+	book->entries = NULL;
+	book->n_entries = 0;
+	book->n_next = 0;
+	const char *magic = "CTOB";
+	if (size < CITRUS_BOOK_HEADER_SIZE) {
+		return false;
+	}
+	for (int i = 0; i < 4; i++) {
+		if (data[i] != (uint8_t) magic[i]) {
+			return false;
+		}
+	}
+	uint32_t n_entries = Citrus_read_le(data + 8, 4);
+	if (Citrus_read_le(data + 4, 2) != 1
+	    || (size - CITRUS_BOOK_HEADER_SIZE) / CITRUS_BOOK_ENTRY_SIZE <
+	    n_entries) {
+		return false;
+	}
+	book->entries = data + CITRUS_BOOK_HEADER_SIZE;
+	book->n_entries = n_entries;
+	book->n_next = Citrus_read_le(data + 6, 2);
+	return true;
+}
+
+// binary search the sorted entries for a key
+bool CitrusBook_lookup(const CitrusBook *book, uint64_t key,
+		       CitrusBookEntry *entry)
+{
+	uint32_t low = 0;
+	uint32_t high = book->n_entries;
+	while (low < high) {
+		uint32_t middle = low + (high - low) / 2;
+		const uint8_t *data = book->entries +
+		    (size_t)middle * CITRUS_BOOK_ENTRY_SIZE;
+		uint64_t middle_key = Citrus_read_le(data, 8);
+		if (middle_key < key) {
+			low = middle + 1;
+		} else if (middle_key > key) {
+			high = middle;
+		} else {
+			entry->key = key;
+			uint32_t value = Citrus_read_le(data + 8, 4);
+			entry->value = (int32_t) value;
+			entry->x = (int8_t) data[12];
+			entry->y = (int8_t) data[13];
+			entry->rotation = data[14];
+			entry->hold = data[15] != 0;
+			return true;
+		}
+	}
+	return false;
+}
+
+// write a book from entries sorted by key, returning its size or 0
+size_t CitrusBook_write(uint8_t *data, size_t capacity,
+			const CitrusBookEntry *entries, uint32_t n_entries,
+			int n_next)
+{
+	size_t size = CITRUS_BOOK_HEADER_SIZE +
+	    (size_t)n_entries * CITRUS_BOOK_ENTRY_SIZE;
+	if (size > capacity) {
+		return 0;
+	}
+	const char *magic = "CTOB";
+	for (int i = 0; i < 4; i++) {
+		data[i] = magic[i];
+	}
+	Citrus_write_le(data + 4, 1, 2);
+	Citrus_write_le(data + 6, n_next, 2);
+	Citrus_write_le(data + 8, n_entries, 4);
+	Citrus_write_le(data + 12, 0, 4);
+	for (uint32_t i = 0; i < n_entries; i++) {
+		const CitrusBookEntry *entry = &entries[i];
+		// lookups need strictly increasing keys
+		if (i > 0 && entry->key <= entries[i - 1].key) {
+			return 0;
+		}
+		uint8_t *out = data + CITRUS_BOOK_HEADER_SIZE +
+		    (size_t)i * CITRUS_BOOK_ENTRY_SIZE;
+		Citrus_write_le(out, entry->key, 8);
+		Citrus_write_le(out + 8, (uint32_t) entry->value, 4);
+		out[12] = (uint8_t) entry->x;
+		out[13] = (uint8_t) entry->y;
+		out[14] = entry->rotation;
+		out[15] = entry->hold;
+	}
+	return size;
+}
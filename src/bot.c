@@ -0,0 +1,920 @@
+/* Copyright (C) 2026 RZ781
+ *
+ * This file is part of libcitrus.
+ *
+ * libcitrus is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 2.1 of the License, or (at your option)
+ * any later version.
+ *
+ * libcitrus is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "citrus.h"
+
+// el-tetris weights scaled to integers, with a bonus for tetrises
+const CitrusBotWeights citrus_bot_default_weights = {
+	.height = 51,
+	.holes = 36,
+	.bumpiness = 18,
+	.clears = {0, 76, 152, 228, 800},
+};
+
+// initialise a bot and work out the rows of each piece
+void CitrusBot_init(CitrusBot *bot, int beam_width, int max_depth)
+{
+	bot->weights = citrus_bot_default_weights;
+	bot->beam_width = beam_width;
+	bot->max_depth = max_depth;
+	bot->table = NULL;
+	bot->book = NULL;
+	bot->split_index = 0;
+	bot->split_count = 1;
+	for (int p = 0; p < 7; p++) {
+		const CitrusPiece *piece = &citrus_pieces[p];
+		int width = piece->width;
+		int height = piece->height;
+		for (int r = 0; r < 4; r++) {
+			bot->left[p][r] = width;
+			bot->right[p][r] = -1;
+			bot->bottom[p][r] = height;
+			bot->top[p][r] = -1;
+			for (int dy = 0; dy < 4; dy++) {
+				bot->masks[p][r][dy] = 0;
+			}
+			if (r >= piece->n_rotation_states) {
+				continue;
+			}
+			for (int dy = 0; dy < height; dy++) {
+				for (int dx = 0; dx < width; dx++) {
+					int i = (r * height + dy) * width + dx;
+					if (piece->piece_data[i].type !=
+					    CITRUS_CELL_FULL) {
+						continue;
+					}
+					bot->masks[p][r][dy] |=
+					    (uint64_t) 1 << dx;
+					if (dx < bot->left[p][r])
+						bot->left[p][r] = dx;
+					if (dx > bot->right[p][r])
+						bot->right[p][r] = dx;
+					if (dy < bot->bottom[p][r])
+						bot->bottom[p][r] = dy;
+					if (dy > bot->top[p][r])
+						bot->top[p][r] = dy;
+				}
+			}
+		}
+	}
+}
+
+// share a transposition table with other searches
+void CitrusBot_set_table(CitrusBot *bot, CitrusTranspositionTable *table)
+{
+	bot->table = table;
+}
+
+// only search the first moves in one share of count
+void CitrusBot_set_split(CitrusBot *bot, int index, int count)
+{
+	bot->split_index = index;
+	bot->split_count = count;
+}
+
+// play placements from an opening book when the state is in it
+void CitrusBot_set_book(CitrusBot *bot, const CitrusBook *book)
+{
+	bot->book = book;
+}
+
+// mix a value into a hash
+uint64_t CitrusBot_mix(uint64_t hash, uint64_t value)
+{
+	hash ^= value;
+	hash *= 0xff51afd7ed558ccd;
+	return hash ^ hash >> 33;
+}
+
+// hash a board along with the pieces left to place and the held piece
+uint64_t CitrusBot_hash(CitrusBot *bot, const CitrusBitboard *board, int next,
+			int hold)
+{
+	uint64_t hash = CitrusBot_mix(0x9e3779b97f4a7c15, hold + 1);
+	for (int i = next; i < bot->n_pieces; i++) {
+		hash = CitrusBot_mix(hash, bot->pieces[i]);
+	}
+	for (int i = 0; i < board->n_blocks; i++) {
+		const uint64_t *block = board->blocks[i];
+		// empty blocks are always shared, so equal boards hash equally
+		if (block == citrus_bitboard_empty_block) {
+			hash = CitrusBot_mix(hash, i);
+			continue;
+		}
+		for (int j = 0; j < CITRUS_BITBOARD_BLOCK_ROWS; j++) {
+			hash = CitrusBot_mix(hash, block[j]);
+		}
+	}
+	return hash;
+}
+
+// hash the state a search began from for looking up in an opening book
+uint64_t CitrusBot_book_key(CitrusBot *bot, int n_next)
+{
+	uint64_t hash = CitrusBot_mix(0x9e3779b97f4a7c15, bot->width);
+	hash = CitrusBot_mix(hash, bot->full_height);
+	hash = CitrusBot_mix(hash, bot->start_hold + 1);
+	hash = CitrusBot_mix(hash, bot->can_hold);
+	for (int i = 0; i <= n_next && i < bot->n_pieces; i++) {
+		hash = CitrusBot_mix(hash, bot->pieces[i]);
+	}
+	for (int y = 0; y < bot->full_height; y++) {
+		hash = CitrusBot_mix(hash, bot->board[y]);
+	}
+	return hash;
+}
+
+// count the full cells in a row
+int CitrusBot_popcount(uint64_t row)
+{
+	row = row - (row >> 1 & 0x5555555555555555);
+	row = (row & 0x3333333333333333) + (row >> 2 & 0x3333333333333333);
+	row = (row + (row >> 4)) & 0x0f0f0f0f0f0f0f0f;
+	return row * 0x0101010101010101 >> 56;
+}
+
+// cells of a row of a piece moved to column x
+uint64_t CitrusBot_piece_row(CitrusBot *bot, int piece, int rotation, int dy,
+			     int x)
+{
+	uint64_t mask = bot->masks[piece][rotation][dy];
+	return x >= 0 ? mask << x : mask >> -x;
+}
+
+// check if a piece collides with the rows or the edges of the board
+bool CitrusBot_collides(CitrusBot *bot, const uint64_t *rows, int piece, int x,
+			int y, int rotation)
+{
+	int bottom = bot->bottom[piece][rotation];
+	int top = bot->top[piece][rotation];
+	if (x + bot->left[piece][rotation] < 0
+	    || x + bot->right[piece][rotation] >= bot->width
+	    || y + bottom < 0 || y + top >= bot->full_height) {
+		return true;
+	}
+	for (int dy = bottom; dy <= top; dy++) {
+		if (rows[y + dy] & CitrusBot_piece_row(bot, piece, rotation, dy,
+						       x)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+// check if a piece would collide with a board where it spawns
+bool CitrusBot_spawn_collides(CitrusBot *bot, const CitrusBitboard *board,
+			      int piece)
+{
+	int x = (bot->width - citrus_pieces[piece].width) / 2;
+	int y = citrus_pieces[piece].spawn_y + bot->height;
+	int bottom = bot->bottom[piece][0];
+	int top = bot->top[piece][0];
+	if (x + bot->left[piece][0] < 0
+	    || x + bot->right[piece][0] >= bot->width || y + bottom < 0 || y + top >= bot->full_height) {
+		return true;
+	}
+	for (int dy = bottom; dy <= top; dy++) {
+		if (CitrusBitboard_get_row(board, y + dy) &
+		    CitrusBot_piece_row(bot, piece, 0, dy, x)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+// rotate a state n*90 degrees clockwise using the same srs kicks as the game
+bool CitrusBot_rotate(CitrusBot *bot, const uint64_t *rows, int piece,
+		      CitrusBotState *state, int n)
+{
+	int n_rotations = citrus_pieces[piece].n_rotation_states;
+	int rotation = (state->rotation + n + n_rotations) % n_rotations;
+	int row = n > 0 ? state->rotation : rotation;
+	const CitrusVector *kick_table = piece == CITRUS_COLOR_I ?
+	    citrus_i_kick_table[row] : citrus_kick_table[row];
+	int sign = n < 0 ? -1 : 1;
+	for (int i = 0; i < 5; i++) {
+		int x = state->x + sign * kick_table[i].x;
+		int y = state->y + sign * kick_table[i].y;
+		if (!CitrusBot_collides(bot, rows, piece, x, y, rotation)) {
+			state->x = x;
+			state->y = y;
+			state->rotation = rotation;
+			return true;
+		}
+	}
+	return false;
+}
+
+// find everywhere a piece can lock from a starting state, returning how many
+// places there are, each with the state it was hard dropped from as parent
+int CitrusBot_find_placements(CitrusBot *bot, const uint64_t *rows, int piece,
+			      int x, int y, int rotation)
+{
+	int stride = bot->full_height + 8;
+	for (int i = 0; i < 4 * stride; i++) {
+		bot->visited[i] = 0;
+		bot->landed[i] = 0;
+	}
+	if (CitrusBot_collides(bot, rows, piece, x, y, rotation)) {
+		return 0;
+	}
+	CitrusKey keys[6] = {
+		CITRUS_KEY_LEFT, CITRUS_KEY_RIGHT, CITRUS_KEY_CLOCKWISE,
+		CITRUS_KEY_ANTICLOCKWISE, CITRUS_KEY_180, CITRUS_KEY_SOFT_DROP
+	};
+	CitrusBotState start = { x, y, rotation, CITRUS_KEY_HARD_DROP, -1 };
+	bot->states[0] = start;
+	bot->visited[rotation * stride + y + 4] |= (uint64_t) 1 << (x + 4);
+	int n_states = 1;
+	int n_placements = 0;
+	// breadth first, so each state is reached with as few keys as possible
+	for (int i = 0; i < n_states; i++) {
+		CitrusBotState state = bot->states[i];
+		int landing = state.y;
+		while (!CitrusBot_collides(bot, rows, piece, state.x,
+					   landing - 1, state.rotation)) {
+			landing--;
+		}
+		uint64_t *landed =
+		    &bot->landed[state.rotation * stride + landing + 4];
+		if (!(*landed & (uint64_t) 1 << (state.x + 4))) {
+			*landed |= (uint64_t) 1 << (state.x + 4);
+			CitrusBotState placement = state;
+			placement.y = landing;
+			placement.key = CITRUS_KEY_HARD_DROP;
+			placement.parent = i;
+			bot->placements[n_placements++] = placement;
+		}
+		for (int k = 0; k < 6; k++) {
+			CitrusBotState next = state;
+			bool moved = false;
+			switch (keys[k]) {
+			case CITRUS_KEY_LEFT:
+			case CITRUS_KEY_RIGHT:
+				next.x += keys[k] == CITRUS_KEY_LEFT ? -1 : 1;
+				moved = !CitrusBot_collides(bot, rows, piece,
+							    next.x, next.y,
+							    next.rotation);
+				break;
+			case CITRUS_KEY_CLOCKWISE:
+				moved = CitrusBot_rotate(bot, rows, piece,
+							 &next, 1);
+				break;
+			case CITRUS_KEY_ANTICLOCKWISE:
+				moved = CitrusBot_rotate(bot, rows, piece,
+							 &next, -1);
+				break;
+			case CITRUS_KEY_180:
+				moved = CitrusBot_rotate(bot, rows, piece,
+							 &next, 2);
+				break;
+			default:
+				next.y = landing;
+				moved = landing != state.y;
+				break;
+			}
+			if (!moved) {
+				continue;
+			}
+			uint64_t *visited =
+			    &bot->visited[next.rotation * stride + next.y + 4];
+			if (*visited & (uint64_t) 1 << (next.x + 4)) {
+				continue;
+			}
+			*visited |= (uint64_t) 1 << (next.x + 4);
+			next.key = keys[k];
+			next.parent = i;
+			bot->states[n_states++] = next;
+		}
+	}
+	return n_placements;
+}
+
+// lock a piece into a board and clear full lines, returning the number
+// cleared or -1 if the arena is full
+int CitrusBot_place(CitrusBot *bot, CitrusBitboard *board, CitrusArena *arena,
+		    int piece, int x, int y, int rotation)
+{
+	bool full = false;
+	for (int dy = bot->bottom[piece][rotation];
+	     dy <= bot->top[piece][rotation]; dy++) {
+		uint64_t row = CitrusBitboard_get_row(board, y + dy) |
+		    CitrusBot_piece_row(bot, piece, rotation, dy, x);
+		if (!CitrusBitboard_set_row(board, arena, y + dy, row)) {
+			return -1;
+		}
+		full = full || row == bot->full_row;
+	}
+	if (!full) {
+		return 0;
+	}
+	return CitrusBitboard_clear_lines(board, arena, bot->full_row);
+}
+
+// score a board using the bot's weights, higher is better
+int CitrusBot_evaluate(CitrusBot *bot, const CitrusBitboard *board)
+{
+	int heights[64];
+	for (int x = 0; x < bot->width; x++) {
+		heights[x] = 0;
+	}
+	uint64_t covered = 0;
+	int holes = 0;
+	for (int i = board->n_blocks - 1; i >= 0; i--) {
+		const uint64_t *block = board->blocks[i];
+		// empty blocks are either above the stack or all holes
+		if (block == citrus_bitboard_empty_block) {
+			holes += CITRUS_BITBOARD_BLOCK_ROWS *
+			    CitrusBot_popcount(covered);
+			continue;
+		}
+		for (int j = CITRUS_BITBOARD_BLOCK_ROWS - 1; j >= 0; j--) {
+			uint64_t row = block[j];
+			holes += CitrusBot_popcount(covered & ~row);
+			uint64_t top = row & ~covered;
+			for (int x = 0; top != 0; x++, top >>= 1) {
+				if (top & 1) {
+					heights[x] =
+					    i * CITRUS_BITBOARD_BLOCK_ROWS + j +
+					    1;
+				}
+			}
+			covered |= row;
+		}
+	}
+	int height = 0;
+	int bumpiness = 0;
+	for (int x = 0; x < bot->width; x++) {
+		height += heights[x];
+		if (x > 0) {
+			int step = heights[x] - heights[x - 1];
+			bumpiness += step < 0 ? -step : step;
+		}
+	}
+	return -(bot->weights.height * height + bot->weights.holes * holes +
+		 bot->weights.bumpiness * bumpiness);
+}
+
+// add a candidate to the min-heap of the best ones found at this depth
+void CitrusBot_add_candidate(CitrusBot *bot,
+			     const CitrusBotCandidate *candidate)
+{
+	CitrusBotCandidate *heap = bot->candidates;
+	int n = bot->n_candidates;
+	int i;
+	if (n < bot->beam_width) {
+		i = bot->n_candidates++;
+		while (i > 0 && heap[(i - 1) / 2].value > candidate->value) {
+			heap[i] = heap[(i - 1) / 2];
+			i = (i - 1) / 2;
+		}
+		heap[i] = *candidate;
+		return;
+	}
+	if (candidate->value <= heap[0].value) {
+		return;
+	}
+	// replace the worst candidate
+	i = 0;
+	for (;;) {
+		int child = 2 * i + 1;
+		if (child >= n) {
+			break;
+		}
+		if (child + 1 < n
+		    && heap[child + 1].value < heap[child].value) {
+			child++;
+		}
+		if (heap[child].value >= candidate->value) {
+			break;
+		}
+		heap[i] = heap[child];
+		i = child;
+	}
+	heap[i] = *candidate;
+}
+
+// fill in a move with the keys to reach a placement from the last search
+// for placements, returning false if there are too many keys
+bool CitrusBot_path(CitrusBot *bot, int piece, bool hold,
+		    const CitrusBotState *placement, CitrusBotMove *move)
+{
+	int n_keys = 0;
+	for (int i = placement->parent; bot->states[i].parent != -1;
+	     i = bot->states[i].parent) {
+		n_keys++;
+	}
+	if (n_keys + 1 > CITRUS_BOT_MAX_KEYS) {
+		return false;
+	}
+	int i = placement->parent;
+	for (int k = n_keys - 1; k >= 0; k--) {
+		move->keys[k] = bot->states[i].key;
+		i = bot->states[i].parent;
+	}
+	move->keys[n_keys] = CITRUS_KEY_HARD_DROP;
+	move->n_keys = n_keys + 1;
+	move->piece = piece;
+	move->hold = hold;
+	move->position = (CitrusVector) {
+	placement->x, placement->y};
+	move->rotation = placement->rotation;
+	return true;
+}
+
+// record the keys to reach a placement found from the start of the search
+bool CitrusBot_add_move(CitrusBot *bot, int piece, bool hold,
+			const CitrusBotState *placement)
+{
+	if (bot->n_moves == CITRUS_BOT_MAX_MOVES
+	    || !CitrusBot_path(bot, piece, hold, placement,
+			       &bot->moves[bot->n_moves])) {
+		return false;
+	}
+	bot->n_moves++;
+	return true;
+}
+
+// try every placement of a piece on a node, adding them as candidates
+void CitrusBot_expand_piece(CitrusBot *bot, int parent, int piece, bool hold,
+			    int next, int hold_piece)
+{
+	CitrusBotNode *node = &bot->nodes[parent];
+	int x = (bot->width - citrus_pieces[piece].width) / 2;
+	int y = citrus_pieces[piece].spawn_y + bot->height;
+	int rotation = 0;
+	if (bot->depth == 0 && !hold) {
+		x = bot->start.x;
+		y = bot->start.y;
+		rotation = bot->start_rotation;
+	}
+	// placements are found on a flat copy of the board, and each one is
+	// scored on a copy sharing the node's blocks
+	for (int row = 0; row < bot->full_height; row++) {
+		bot->rows[row] = CitrusBitboard_get_row(&node->board, row);
+	}
+	int n = CitrusBot_find_placements(bot, bot->rows, piece, x, y,
+					  rotation);
+	for (int i = 0; i < n; i++) {
+		CitrusBotState *placement = &bot->placements[i];
+		CitrusArena_reset(&bot->scratch_arena);
+		CitrusBitboard_copy(&bot->scratch, &node->board);
+		int cleared = CitrusBot_place(bot, &bot->scratch,
+					      &bot->scratch_arena, piece,
+					      placement->x, placement->y,
+					      placement->rotation);
+		// the next piece spawning into the stack tops out
+		if (cleared < 0 || (next < bot->n_pieces
+				    && CitrusBot_spawn_collides(bot,
+								&bot->scratch,
+								bot->pieces
+								[next]))) {
+			continue;
+		}
+		CitrusBotCandidate candidate;
+		candidate.parent = parent;
+		candidate.move = node->move;
+		candidate.next = next;
+		candidate.hold = hold_piece;
+		candidate.piece = piece;
+		candidate.position = (CitrusVector) {
+		placement->x, placement->y};
+		candidate.rotation = placement->rotation;
+		candidate.reward = node->reward +
+		    bot->weights.clears[cleared > 4 ? 4 : cleared];
+		candidate.value = candidate.reward +
+		    CitrusBot_evaluate(bot, &bot->scratch);
+		if (bot->depth == 0) {
+			if (!CitrusBot_add_move(bot, piece, hold, placement)) {
+				continue;
+			}
+			candidate.move = bot->n_moves - 1;
+			if (candidate.move % bot->split_count !=
+			    bot->split_index) {
+				continue;
+			}
+		}
+		if (bot->table != NULL) {
+			// the same board with the same pieces left has been
+			// reached before, so only keep the better path to it
+			uint64_t key = CitrusBot_hash(bot, &bot->scratch, next,
+						      hold_piece);
+			int depth = bot->max_depth - bot->depth;
+			int value;
+			int stored_depth;
+			if (CitrusTranspositionTable_probe(bot->table, key,
+							   &value,
+							   &stored_depth)
+			    && stored_depth == depth
+			    && value >= candidate.value) {
+				continue;
+			}
+			CitrusTranspositionTable_store(bot->table, key,
+						       candidate.value, depth);
+		}
+		CitrusBot_add_candidate(bot, &candidate);
+	}
+}
+
+// do the next part of expanding the current node, which is placing its next
+// piece and then holding to place the other piece, returning true if it
+// searched for placements
+bool CitrusBot_expand(CitrusBot *bot)
+{
+	int parent = bot->expanding;
+	CitrusBotNode node = bot->nodes[parent];
+	int stage = bot->stage;
+	bot->stage++;
+	if (bot->stage == 2) {
+		bot->stage = 0;
+		bot->expanding++;
+	}
+	if (node.next >= bot->n_pieces) {
+		return false;
+	}
+	int current = bot->pieces[node.next];
+	if (stage == 0) {
+		CitrusBot_expand_piece(bot, parent, current, false,
+				       node.next + 1, node.hold);
+		return true;
+	}
+	if (bot->depth == 0 && !bot->can_hold) {
+		return false;
+	}
+	if (node.hold != -1) {
+		// after the first piece, swapping equal pieces changes nothing
+		if (node.hold == current && bot->depth > 0) {
+			return false;
+		}
+		CitrusBot_expand_piece(bot, parent, node.hold, true,
+				       node.next + 1, current);
+		return true;
+	} else if (node.next + 1 < bot->n_pieces) {
+		CitrusBot_expand_piece(bot, parent, bot->pieces[node.next + 1],
+				       true, node.next + 2, current);
+		return true;
+	}
+	return false;
+}
+
+// turn the best candidates into the nodes of the next depth
+bool CitrusBot_next_depth(CitrusBot *bot, CitrusArena *arena)
+{
+	int n = bot->n_candidates;
+	CitrusBotNode *nodes = CitrusArena_alloc(arena, n * sizeof(*nodes));
+	if (nodes == NULL) {
+		return false;
+	}
+	for (int i = 0; i < n; i++) {
+		CitrusBotCandidate *candidate = &bot->candidates[i];
+		const CitrusBitboard *parent =
+		    &bot->nodes[candidate->parent].board;
+		const uint64_t **blocks = CitrusArena_alloc(arena,
+							    parent->n_blocks *
+							    sizeof(*blocks));
+		if (blocks == NULL) {
+			return false;
+		}
+		// the child only gets its own copies of the blocks it changes
+		CitrusBitboard_init(&nodes[i].board, blocks, parent->n_blocks);
+		CitrusBitboard_copy(&nodes[i].board, parent);
+		if (CitrusBot_place(bot, &nodes[i].board, arena,
+				    candidate->piece, candidate->position.x,
+				    candidate->position.y,
+				    candidate->rotation) < 0) {
+			return false;
+		}
+		nodes[i].move = candidate->move;
+		nodes[i].next = candidate->next;
+		nodes[i].hold = candidate->hold;
+		nodes[i].reward = candidate->reward;
+		nodes[i].value = candidate->value;
+	}
+	bot->nodes = nodes;
+	bot->n_nodes = n;
+	bot->n_candidates = 0;
+	bot->depth++;
+	bot->expanding = 0;
+	bot->stage = 0;
+	return true;
+}
+
+// read the locked cells of a game's board into rows
+void CitrusBot_read_board(CitrusBot *bot, CitrusGame *game, uint64_t *rows)
+{
+	int current = bot->pieces[0];
+	for (int y = 0; y < bot->full_height; y++) {
+		rows[y] = 0;
+		for (int x = 0; x < bot->width; x++) {
+			CitrusCell cell = game->board[y * bot->width + x];
+			if (cell.type == CITRUS_CELL_FULL) {
+				rows[y] |= (uint64_t) 1 << x;
+			}
+		}
+	}
+	// the current piece is drawn on the board
+	for (int dy = bot->bottom[current][game->rotation];
+	     dy <= bot->top[current][game->rotation]; dy++) {
+		rows[game->position.y + dy] &=
+		    ~CitrusBot_piece_row(bot, current, game->rotation, dy,
+					 game->position.x);
+	}
+}
+
+// make the opening book's placement for the start of the search the best
+// move, returning false if there isn't one
+bool CitrusBot_book_move(CitrusBot *bot)
+{
+	int n_next = bot->book->n_next;
+	CitrusBookEntry entry;
+	if (n_next >= bot->n_pieces
+	    || !CitrusBook_lookup(bot->book, CitrusBot_book_key(bot, n_next),
+				  &entry)) {
+		return false;
+	}
+	int piece = bot->pieces[0];
+	int x = bot->start.x;
+	int y = bot->start.y;
+	int rotation = bot->start_rotation;
+	if (entry.hold) {
+		int hold = bot->start_hold;
+		if (!bot->can_hold || (hold == -1 && bot->n_pieces < 2)) {
+			return false;
+		}
+		piece = hold != -1 ? hold : bot->pieces[1];
+		x = (bot->width - citrus_pieces[piece].width) / 2;
+		y = citrus_pieces[piece].spawn_y + bot->height;
+		rotation = 0;
+	}
+	int n = CitrusBot_find_placements(bot, bot->board, piece, x, y,
+					  rotation);
+	for (int i = 0; i < n; i++) {
+		CitrusBotState *placement = &bot->placements[i];
+		if (placement->x == entry.x && placement->y == entry.y
+		    && placement->rotation == entry.rotation) {
+			if (!CitrusBot_add_move(bot, piece, entry.hold,
+						placement)) {
+				return false;
+			}
+			bot->moves[0].value = entry.value;
+			bot->best = 0;
+			return true;
+		}
+	}
+	return false;
+}
+
+// start a search from a game's current state
+bool CitrusBot_begin(CitrusBot *bot, CitrusGame *game, CitrusArena *arena)
+{
+	CitrusArena_reset(arena);
+	bot->arena = arena;
+	bot->done = true;
+	bot->best = -1;
+	bot->n_moves = 0;
+	bot->n_candidates = 0;
+	int width = game->config->width;
+	int full_height = game->config->full_height;
+	if (!game->alive || game->line_clear_delay > 0 || width < 1
+	    || width > 60 || full_height > 119 || bot->beam_width < 1) {
+		return false;
+	}
+	int current = Citrus_piece_index(game->current_piece);
+	if (current == 7) {
+		return false;
+	}
+	bot->width = width;
+	bot->height = game->config->height;
+	bot->full_height = full_height;
+	bot->full_row = ((uint64_t) 1 << width) - 1;
+	bot->pieces[0] = current;
+	bot->n_pieces = 1;
+	for (int i = 0; i < game->config->next_piece_queue_size
+	     && bot->n_pieces < CITRUS_BOT_MAX_PIECES; i++) {
+		int piece = Citrus_piece_index(game->next_piece_queue[i]);
+		if (piece == 7) {
+			break;
+		}
+		bot->pieces[bot->n_pieces++] = piece;
+	}
+	int hold = -1;
+	bot->can_hold = !game->held;
+	if (game->hold_piece != NULL) {
+		hold = Citrus_piece_index(game->hold_piece);
+		if (hold == 7) {
+			hold = -1;
+			bot->can_hold = false;
+		}
+	}
+	bot->start = game->position;
+	bot->start_rotation = game->rotation;
+	bot->start_hold = hold;
+	int stride = full_height + 8;
+	int n_states = 4 * stride * (width + 4);
+	bot->states = CitrusArena_alloc(arena, n_states *
+					sizeof(CitrusBotState));
+	bot->placements = CitrusArena_alloc(arena, n_states *
+					    sizeof(CitrusBotState));
+	bot->visited = CitrusArena_alloc(arena, 4 * stride * sizeof(uint64_t));
+	bot->landed = CitrusArena_alloc(arena, 4 * stride * sizeof(uint64_t));
+	bot->rows = CitrusArena_alloc(arena, full_height * sizeof(uint64_t));
+	bot->board = CitrusArena_alloc(arena, full_height * sizeof(uint64_t));
+	bot->moves = CitrusArena_alloc(arena, CITRUS_BOT_MAX_MOVES *
+				       sizeof(CitrusBotMove));
+	bot->candidates = CitrusArena_alloc(arena, bot->beam_width *
+					    sizeof(CitrusBotCandidate));
+	bot->nodes = CitrusArena_alloc(arena, sizeof(CitrusBotNode));
+	int n_blocks = (full_height + CITRUS_BITBOARD_BLOCK_ROWS - 1) /
+	    CITRUS_BITBOARD_BLOCK_ROWS;
+	const uint64_t **blocks = CitrusArena_alloc(arena, 2 * n_blocks *
+						    sizeof(*blocks));
+	// enough for the scratch board to copy every block
+	size_t scratch_size = n_blocks * (CITRUS_BITBOARD_BLOCK_ROWS *
+					  sizeof(uint64_t) + 16);
+	void *scratch = CitrusArena_alloc(arena, scratch_size);
+	if (bot->states == NULL || bot->placements == NULL
+	    || bot->visited == NULL || bot->landed == NULL || bot->rows == NULL
+	    || bot->board == NULL || bot->moves == NULL
+	    || bot->candidates == NULL || bot->nodes == NULL || blocks == NULL
+	    || scratch == NULL) {
+		return false;
+	}
+	CitrusBitboard_init(&bot->scratch, blocks + n_blocks, n_blocks);
+	CitrusArena_init(&bot->scratch_arena, scratch, scratch_size);
+	CitrusBot_read_board(bot, game, bot->board);
+	CitrusBitboard *root = &bot->nodes[0].board;
+	CitrusBitboard_init(root, blocks, n_blocks);
+	for (int y = 0; y < full_height; y++) {
+		if (!CitrusBitboard_set_row(root, arena, y, bot->board[y])) {
+			return false;
+		}
+	}
+	bot->nodes[0].move = -1;
+	bot->nodes[0].next = 0;
+	bot->nodes[0].hold = hold;
+	bot->nodes[0].reward = 0;
+	bot->nodes[0].value = 0;
+	bot->n_nodes = 1;
+	bot->depth = 0;
+	bot->expanding = 0;
+	bot->stage = 0;
+	bot->done = false;
+	// states in the opening book need no search
+	if (bot->book != NULL && CitrusBot_book_move(bot)) {
+		bot->done = true;
+	}
+	return true;
+}
+
+// index of the root move of the best candidate at the current depth
+int CitrusBot_best_candidate(CitrusBot *bot)
+{
+	int best = -1;
+	int best_value = 0;
+	for (int i = 0; i < bot->n_candidates; i++) {
+		if (best == -1 || bot->candidates[i].value > best_value) {
+			best_value = bot->candidates[i].value;
+			best = bot->candidates[i].move;
+		}
+	}
+	if (best != -1) {
+		bot->moves[best].value = best_value;
+	}
+	return best;
+}
+
+// continue a search for up to budget placement searches
+bool CitrusBot_step(CitrusBot *bot, int budget)
+{
+	while (!bot->done && budget > 0) {
+		if (bot->expanding < bot->n_nodes) {
+			if (CitrusBot_expand(bot)) {
+				budget--;
+			}
+			continue;
+		}
+		// every node at this depth has been expanded
+		if (bot->n_candidates == 0) {
+			bot->done = true;
+			break;
+		}
+		bot->best = CitrusBot_best_candidate(bot);
+		if (bot->depth + 1 >= bot->max_depth
+		    || !CitrusBot_next_depth(bot, bot->arena)) {
+			bot->done = true;
+		}
+	}
+	return bot->done;
+}
+
+// get the best move found by the deepest finished depth of the search
+bool CitrusBot_best_so_far(CitrusBot *bot, CitrusBotMove *move)
+{
+	int best = bot->best;
+	// before the first depth finishes, use the best first move so far
+	if (best == -1 && bot->depth == 0) {
+		best = CitrusBot_best_candidate(bot);
+	}
+	if (best == -1) {
+		return false;
+	}
+	*move = bot->moves[best];
+	return true;
+}
+
+// play the best move found so far, finding a new path if the piece moved
+bool CitrusBot_commit(CitrusBot *bot, CitrusGame *game, CitrusBotMove *move)
+{
+	CitrusBotMove best;
+	if (!CitrusBot_best_so_far(bot, &best)) {
+		return false;
+	}
+	// the game must still be on the piece the search began from
+	if (!game->alive || game->line_clear_delay > 0
+	    || (int)Citrus_piece_index(game->current_piece) != bot->pieces[0]
+	    || game->held == bot->can_hold) {
+		return false;
+	}
+	CitrusBot_read_board(bot, game, bot->rows);
+	for (int y = 0; y < bot->full_height; y++) {
+		if (bot->rows[y] != bot->board[y]) {
+			return false;
+		}
+	}
+	// holding always respawns the piece, so only moves without hold can
+	// be affected by the piece falling or moving since the search began
+	if (!best.hold && (game->position.x != bot->start.x
+			   || game->position.y != bot->start.y
+			   || game->rotation != bot->start_rotation)) {
+		int n = CitrusBot_find_placements(bot, bot->board, best.piece,
+						  game->position.x,
+						  game->position.y,
+						  game->rotation);
+		int i = 0;
+		while (i < n && (bot->placements[i].x != best.position.x
+				 || bot->placements[i].y != best.position.y
+				 || bot->placements[i].rotation !=
+				 best.rotation)) {
+			i++;
+		}
+		if (i == n || !CitrusBot_path(bot, best.piece, false,
+					      &bot->placements[i], &best)) {
+			return false;
+		}
+	}
+	bot->done = true;
+	CitrusBotMove_apply(&best, game);
+	if (move != NULL) {
+		*move = best;
+	}
+	return true;
+}
+
+// search for the best move without a budget
+bool CitrusBot_plan(CitrusBot *bot, CitrusGame *game, CitrusArena *arena,
+		    CitrusBotMove *move)
+{
+	if (!CitrusBot_begin(bot, game, arena)) {
+		return false;
+	}
+	while (!CitrusBot_step(bot, 1 << 30)) ;
+	return CitrusBot_best_so_far(bot, move);
+}
+
+// tap each key of a move
+void CitrusBotMove_apply(const CitrusBotMove *move, CitrusGame *game)
+{
+	CitrusInput inputs[2 * (CITRUS_BOT_MAX_KEYS + 1)];
+	int n = 0;
+	for (int i = -1; i < move->n_keys; i++) {
+		if (i == -1 && !move->hold) {
+			continue;
+		}
+		CitrusKey key = i == -1 ? CITRUS_KEY_HOLD : move->keys[i];
+		inputs[n].key = key;
+		inputs[n].down = true;
+		inputs[n].offset = 0;
+		inputs[n + 1] = inputs[n];
+		inputs[n + 1].down = false;
+		n += 2;
+	}
+	CitrusGame_apply_inputs(game, inputs, n);
+}
@@ -20,15 +20,18 @@
 #include <stddef.h>
 #include "citrus.h"
 
+// tallest piece checked against the occupancy a row at a time
+#define CITRUS_PIECE_MAX_ROWS 8
+
 // SRS kicks for all pieces besides I
-const CitrusVector KICK_TABLE[4][5] = {
+const CitrusVector citrus_kick_table[4][5] = {
 	{{0, 0}, {-1, 0}, {-1, 1}, {0, -2}, {-1, -2}},
 	{{0, 0}, {1, 0}, {1, -1}, {0, 2}, {1, 2}},
 	{{0, 0}, {1, 0}, {1, 1}, {0, -2}, {1, -2}},
 	{{0, 0}, {-1, 0}, {-1, -1}, {0, 2}, {-1, 2}},
 };
 
-const CitrusVector I_KICK_TABLE[4][5] = {
+const CitrusVector citrus_i_kick_table[4][5] = {
 	{{0, 0}, {-2, 0}, {1, 0}, {-2, -1}, {1, 2}},
 	{{0, 0}, {-1, 0}, {2, 0}, {-1, 2}, {2, -1}},
 	{{0, 0}, {2, 0}, {-1, 0}, {2, 1}, {-1, -2}},
@@ -54,6 +57,7 @@ const CitrusGameConfig citrus_preset_modern = {
 	.action_text = NULL,
 	.das = 10,
 	.arr = 3,
+	.subticks = 4,
 };
 
 // preset config for delayless modern games
@@ -75,6 +79,7 @@ const CitrusGameConfig citrus_preset_delayless = {
 	.action_text = NULL,
 	.das = 10,
 	.arr = 2,
+	.subticks = 4,
 };
 
 // preset config for classic games, currently missing some features like no
@@ -96,7 +101,8 @@ const CitrusGameConfig citrus_preset_classic = {
 	.shadow = false,
 	.action_text = NULL,
 	.das = 16,
-	.arr = 6
+	.arr = 6,
+	.subticks = 4
 };
 
 CitrusVector CitrusVector_add(CitrusVector a, CitrusVector b)
@@ -131,13 +137,78 @@ void CitrusPiece_init(CitrusPiece *piece, const CitrusCell *piece_data,
 // check if a vector is within the board
 bool CitrusGame_in_board(CitrusGame *game, CitrusVector position)
 {
-	return position.x >= 0 && position.x < game->config.width
-	    && position.y >= 0 && position.y < game->config.full_height;
+	return position.x >= 0 && position.x < game->config->width
+	    && position.y >= 0 && position.y < game->config->full_height;
+}
+
+// get bits of the full cells in each row of the current piece, return false
+// if the piece is too big
+bool CitrusGame_piece_rows(CitrusGame *game, uint64_t *rows)
+{
+	const CitrusPiece *piece = game->current_piece;
+	if (piece->height > CITRUS_PIECE_MAX_ROWS || piece->width > 64) {
+		return false;
+	}
+	const CitrusCell *data = piece->piece_data +
+	    game->rotation * piece->height * piece->width;
+	for (int dy = 0; dy < piece->height; dy++) {
+		rows[dy] = 0;
+		for (int dx = 0; dx < piece->width; dx++) {
+			if (data[dy * piece->width + dx].type ==
+			    CITRUS_CELL_FULL) {
+				rows[dy] |= (uint64_t) 1 << dx;
+			}
+		}
+	}
+	return true;
+}
+
+// check if piece rows at a position overlap full cells or leave the board
+bool CitrusGame_rows_collide(CitrusGame *game, const uint64_t *rows,
+			     CitrusVector position)
+{
+	int width = game->config->width;
+	int words = CITRUS_ROW_WORDS(width);
+	for (int dy = 0; dy < game->current_piece->height; dy++) {
+		uint64_t row = rows[dy];
+		if (row == 0) {
+			continue;
+		}
+		int x = position.x;
+		int y = position.y + dy;
+		if (y < 0 || y >= game->config->full_height) {
+			return true;
+		}
+		if (x < 0) {
+			if (x <= -64 || row & (((uint64_t) 1 << -x) - 1)) {
+				return true;
+			}
+			row >>= -x;
+			x = 0;
+		}
+		if (x >= width || (width - x < 64 && row >> (width - x) != 0)) {
+			return true;
+		}
+		const uint64_t *word = game->occupancy + y * words + x / 64;
+		int shift = x % 64;
+		if (word[0] & row << shift) {
+			return true;
+		}
+		if (shift != 0 && x / 64 + 1 < words
+		    && word[1] & row >> (64 - shift)) {
+			return true;
+		}
+	}
+	return false;
 }
 
 // check if the current piece is colliding with the board
 bool CitrusGame_collided(CitrusGame *game)
 {
+	uint64_t rows[CITRUS_PIECE_MAX_ROWS];
+	if (game->occupancy != NULL && CitrusGame_piece_rows(game, rows)) {
+		return CitrusGame_rows_collide(game, rows, game->position);
+	}
 	int width = game->current_piece->width;
 	int height = game->current_piece->height;
 	int rotation = game->rotation;
@@ -153,7 +224,7 @@ bool CitrusGame_collided(CitrusGame *game)
 						 y + game->position.y}
 			    )
 			    || game->board[(y + game->position.y) *
-					   game->config.width + x +
+					   game->config->width + x +
 					   game->position.x].type ==
 			    CITRUS_CELL_FULL) {
 				return true;
@@ -163,12 +234,72 @@ bool CitrusGame_collided(CitrusGame *game)
 	return false;
 }
 
+// bit of a dirty row mask covering row y
+uint64_t Citrus_row_bit(int y)
+{
+	return (uint64_t) 1 << (y < 63 ? y : 63);
+}
+
+// how far the current piece can fall, the piece must not be on the board
+int CitrusGame_drop_distance(CitrusGame *game)
+{
+	int distance = 0;
+	uint64_t rows[CITRUS_PIECE_MAX_ROWS];
+	if (game->occupancy != NULL && CitrusGame_piece_rows(game, rows)) {
+		CitrusVector position = game->position;
+		position.y--;
+		while (!CitrusGame_rows_collide(game, rows, position)) {
+			position.y--;
+			distance++;
+		}
+		return distance;
+	}
+	int y = game->position.y;
+	game->position.y--;
+	while (!CitrusGame_collided(game)) {
+		game->position.y--;
+		distance++;
+	}
+	game->position.y = y;
+	return distance;
+}
+
+// whether the piece on the board is resting on something, found without
+// erasing it by skipping the cells it covers itself
+bool CitrusGame_on_ground(CitrusGame *game)
+{
+	int width = game->current_piece->width;
+	int height = game->current_piece->height;
+	const CitrusCell *cells = game->current_piece->piece_data +
+	    game->rotation * width * height;
+	for (int dy = 0; dy < height; dy++) {
+		for (int dx = 0; dx < width; dx++) {
+			if (cells[dy * width + dx].type != CITRUS_CELL_FULL
+			    || (dy > 0 && cells[(dy - 1) * width + dx].type ==
+				CITRUS_CELL_FULL)) {
+				continue;
+			}
+			int x = game->position.x + dx;
+			int y = game->position.y + dy - 1;
+			if (!CitrusGame_in_board(game, (CitrusVector) {
+						 x, y}
+			    )
+			    || game->board[y * game->config->width + x].type ==
+			    CITRUS_CELL_FULL) {
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
 // draw piece onto the board without shadow
 void CitrusGame_draw_piece_inner(CitrusGame *game, CitrusCellType type)
 {
 	int width = game->current_piece->width;
 	int height = game->current_piece->height;
 	int rotation = game->rotation;
+	int words = CITRUS_ROW_WORDS(game->config->width);
 	for (int dy = 0; dy < height; dy++) {
 		for (int dx = 0; dx < width; dx++) {
 			// index of current cell in piece_data
@@ -185,7 +316,15 @@ void CitrusGame_draw_piece_inner(CitrusGame *game, CitrusCellType type)
 			    )) {
 				continue;
 			}
-			game->board[y * game->config.width + x] = cell;
+			game->board[y * game->config->width + x] = cell;
+			game->dirty_rows |= Citrus_row_bit(y);
+			if (game->occupancy != NULL) {
+				uint64_t *word = game->occupancy + y * words +
+				    x / 64;
+				uint64_t bit = (uint64_t) 1 << x % 64;
+				*word = type == CITRUS_CELL_FULL ?
+				    *word | bit : *word & ~bit;
+			}
 		}
 	}
 }
@@ -196,12 +335,9 @@ void CitrusGame_draw_piece(CitrusGame *game, bool clear)
 	if (clear) {
 		CitrusGame_draw_piece_inner(game, CITRUS_CELL_EMPTY);
 	}
-	if (game->config.shadow) {
+	if (game->config->shadow) {
 		int y = game->position.y;
-		while (!CitrusGame_collided(game)) {
-			game->position.y--;
-		}
-		game->position.y++;
+		game->position.y -= CitrusGame_drop_distance(game);
 		CitrusGame_draw_piece_inner(game,
 					    clear ? CITRUS_CELL_EMPTY :
 					    CITRUS_CELL_SHADOW);
@@ -216,12 +352,12 @@ void CitrusGame_draw_piece(CitrusGame *game, bool clear)
 void CitrusGame_reset_piece(CitrusGame *game)
 {
 	game->position.x =
-	    (game->config.width - game->current_piece->width) / 2;
-	game->position.y = game->current_piece->spawn_y + game->config.height;
+	    (game->config->width - game->current_piece->width) / 2;
+	game->position.y = game->current_piece->spawn_y + game->config->height;
 	game->fall_amount = 0;
 	game->held = false;
 	game->rotation = 0;
-	game->lock_delay = game->config.lock_delay;
+	game->lock_delay = game->config->lock_delay;
 	game->move_reset_count = 0;
 	game->lowest_y = game->position.y;
 	game->last_kick = -1;
@@ -230,7 +366,7 @@ void CitrusGame_reset_piece(CitrusGame *game)
 // initialise a citrus game
 void CitrusGame_init(CitrusGame *game, CitrusCell *board,
 		     const CitrusPiece **next_piece_queue,
-		     CitrusGameConfig config, void *randomizer_data,
+		     const CitrusGameConfig *config, void *randomizer_data,
 		     void *action_text_data)
 {
 	game->config = config;
@@ -238,7 +374,7 @@ void CitrusGame_init(CitrusGame *game, CitrusCell *board,
 	game->action_text_data = action_text_data;
 	game->board = board;
 	game->next_piece_queue = next_piece_queue;
-	game->current_piece = config.randomizer(randomizer_data);
+	game->current_piece = config->randomizer(randomizer_data);
 	game->hold_piece = NULL;
 	game->alive = true;
 	game->score = 0;
@@ -250,20 +386,23 @@ void CitrusGame_init(CitrusGame *game, CitrusCell *board,
 	game->move_direction = 0;
 	game->move_frames = 0;
 	game->soft_drop = false;
+	game->tracer = NULL;
+	game->trace_id = 0;
+	game->dirty_rows = ~(uint64_t) 0;
+	game->occupancy = NULL;
 	CitrusGame_reset_piece(game);
-	for (int i = 0; i < config.width * config.full_height; i++) {
+	for (int i = 0; i < config->width * config->full_height; i++) {
 		board[i].type = CITRUS_CELL_EMPTY;
 	}
-	for (int i = 0; i < config.next_piece_queue_size; i++) {
-		next_piece_queue[i] = config.randomizer(randomizer_data);
+	for (int i = 0; i < config->next_piece_queue_size; i++) {
+		next_piece_queue[i] = config->randomizer(randomizer_data);
 	}
 	CitrusGame_draw_piece(game, false);
 }
 
-// attempt to move current piece by (dx, dy), return true if successful
-bool CitrusGame_move_piece(CitrusGame *game, int dx, int dy)
+// move a piece which has been erased from the board
+bool CitrusGame_move_piece_inner(CitrusGame *game, int dx, int dy)
 {
-	CitrusGame_draw_piece(game, true);
 	CitrusVector prev_position = game->position;
 	game->position = CitrusVector_add(game->position, (CitrusVector) {
 					  dx, dy});
@@ -276,30 +415,120 @@ bool CitrusGame_move_piece(CitrusGame *game, int dx, int dy)
 	if (game->position.y < game->lowest_y) {
 		game->lowest_y = game->position.y;
 		game->move_reset_count = 0;
-		game->lock_delay = game->config.lock_delay;
+		game->lock_delay = game->config->lock_delay;
 	}
-	CitrusGame_draw_piece(game, false);
 	return !collided;
 }
 
+// attempt to move current piece by (dx, dy), return true if successful
+bool CitrusGame_move_piece(CitrusGame *game, int dx, int dy)
+{
+	uint64_t dirty_rows = game->dirty_rows;
+	CitrusGame_draw_piece(game, true);
+	bool moved = CitrusGame_move_piece_inner(game, dx, dy);
+	CitrusGame_draw_piece(game, false);
+	// a blocked piece is redrawn where it was
+	if (!moved) {
+		game->dirty_rows = dirty_rows;
+	}
+	return moved;
+}
+
 // return the next piece in the queue and generate the next one
 const CitrusPiece *CitrusGame_next_piece(CitrusGame *game)
 {
-	if (game->config.next_piece_queue_size == 0) {
-		return game->config.randomizer(game->randomizer_data);
+	if (game->config->next_piece_queue_size == 0) {
+		return game->config->randomizer(game->randomizer_data);
 	}
 	const CitrusPiece *piece = game->next_piece_queue[0];
-	for (int i = 0; i < game->config.next_piece_queue_size - 1; i++) {
+	for (int i = 0; i < game->config->next_piece_queue_size - 1; i++) {
 		game->next_piece_queue[i] = game->next_piece_queue[i + 1];
 	}
-	game->next_piece_queue[game->config.next_piece_queue_size - 1] =
-	    game->config.randomizer(game->randomizer_data);
+	game->next_piece_queue[game->config->next_piece_queue_size - 1] =
+	    game->config->randomizer(game->randomizer_data);
 	return piece;
 }
 
+// check if every cell in a row is full
+bool CitrusGame_row_full(CitrusGame *game, int y)
+{
+	int width = game->config->width;
+	if (game->occupancy != NULL) {
+		const uint64_t *row = game->occupancy +
+		    y * CITRUS_ROW_WORDS(width);
+		for (int i = 0; i < width / 64; i++) {
+			if (row[i] != ~(uint64_t) 0) {
+				return false;
+			}
+		}
+		uint64_t last = ((uint64_t) 1 << width % 64) - 1;
+		return width % 64 == 0 || row[width / 64] == last;
+	}
+	for (int x = 0; x < width; x++) {
+		if (game->board[y * width + x].type != CITRUS_CELL_FULL) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// copy a row of the board over another
+void CitrusGame_move_row(CitrusGame *game, int from, int to)
+{
+	int width = game->config->width;
+	for (int x = 0; x < width; x++) {
+		game->board[to * width + x] = game->board[from * width + x];
+	}
+	if (game->occupancy != NULL) {
+		int words = CITRUS_ROW_WORDS(width);
+		for (int i = 0; i < words; i++) {
+			game->occupancy[to * words + i] =
+			    game->occupancy[from * words + i];
+		}
+	}
+}
+
+// empty every cell in a row
+void CitrusGame_empty_row(CitrusGame *game, int y)
+{
+	int width = game->config->width;
+	for (int x = 0; x < width; x++) {
+		game->board[y * width + x].type = CITRUS_CELL_EMPTY;
+	}
+	if (game->occupancy != NULL) {
+		int words = CITRUS_ROW_WORDS(width);
+		for (int i = 0; i < words; i++) {
+			game->occupancy[y * words + i] = 0;
+		}
+	}
+}
+
+// check if there are no full cells on the board
+bool CitrusGame_board_empty(CitrusGame *game)
+{
+	int full_height = game->config->full_height;
+	if (game->occupancy != NULL) {
+		uint64_t any = 0;
+		int size = CITRUS_ROW_WORDS(game->config->width) * full_height;
+		for (int i = 0; i < size; i++) {
+			any |= game->occupancy[i];
+		}
+		return any == 0;
+	}
+	int size = game->config->width * full_height;
+	for (int i = 0; i < size; i++) {
+		if (game->board[i].type == CITRUS_CELL_FULL) {
+			return false;
+		}
+	}
+	return true;
+}
+
 // locks the current piece, clearing lines and getting next piece
 void CitrusGame_lock_piece(CitrusGame *game)
 {
+	CitrusTracer_record(game->tracer, CITRUS_TRACE_LOCK, CITRUS_TRACE_BEGIN,
+			    game->trace_id, 0);
 	// check t spins
 	bool spin = false;
 	bool mini_spin = false;
@@ -335,56 +564,44 @@ void CitrusGame_lock_piece(CitrusGame *game)
 			}
 		}
 	}
+	// the piece's cells stay on the board but are no longer the current
+	// piece, which snapshots draw differently
+	for (int dy = 0; dy < game->current_piece->height; dy++) {
+		if (game->position.y + dy >= 0) {
+			game->dirty_rows |= Citrus_row_bit(game->position.y +
+							   dy);
+		}
+	}
 	game->current_piece = CitrusGame_next_piece(game);
 	CitrusGame_reset_piece(game);
-	// clear lines
+	// clear lines, moving each remaining row down once
+	int full_height = game->config->full_height;
 	int cleared_lines = 0;
-	for (int y = 0; y < game->config.full_height; y++) {
-		int full = 1;
-		for (int x = 0; x < game->config.width; x++) {
-			if (game->board[y * game->config.width + x].type !=
-			    CITRUS_CELL_FULL) {
-				full = 0;
-				break;
-			}
-		}
-		if (full) {
+	for (int y = 0; y < full_height; y++) {
+		if (CitrusGame_row_full(game, y)) {
+			// every row from here up moves down
+			game->dirty_rows |= ~(Citrus_row_bit(y) - 1);
 			cleared_lines++;
-			int n_cells =
-			    game->config.width *
-			    (game->config.full_height - y - 1);
-			for (int i = 0; i < n_cells; i++) {
-				game->board[i + y * game->config.width] =
-				    game->board[i +
-						(y + 1) * game->config.width];
-			}
-			for (int x = 0; x < game->config.width; x++) {
-				game->board[(game->config.full_height - 1) *
-					    game->config.width + x].type =
-				    CITRUS_CELL_EMPTY;
-			}
-			y--;
+		} else if (cleared_lines > 0) {
+			CitrusGame_move_row(game, y, y - cleared_lines);
 		}
 	}
-	// check for all clears
-	bool all_clear = true;
-	for (int i = 0; i < game->config.width * game->config.full_height; i++) {
-		if (game->board[i].type == CITRUS_CELL_FULL) {
-			all_clear = false;
-			break;
-		}
+	for (int y = full_height - cleared_lines; y < full_height; y++) {
+		CitrusGame_empty_row(game, y);
 	}
+	// check for all clears
+	bool all_clear = CitrusGame_board_empty(game);
 	// calculate score
 	if (cleared_lines > 4) {
 		cleared_lines = 4;
 	}
 	int score;
 	if (spin) {
-		score = game->config.t_spin_scores[cleared_lines];
+		score = game->config->t_spin_scores[cleared_lines];
 	} else if (mini_spin) {
-		score = game->config.mini_t_spin_scores[cleared_lines];
+		score = game->config->mini_t_spin_scores[cleared_lines];
 	} else {
-		score = game->config.clear_scores[cleared_lines];
+		score = game->config->clear_scores[cleared_lines];
 	}
 	bool b2b = (spin || mini_spin || cleared_lines == 4)
 	    && cleared_lines > 0;
@@ -395,13 +612,13 @@ void CitrusGame_lock_piece(CitrusGame *game)
 		if (game->b2b && b2b) {
 			score += 3200;
 		} else {
-			score += game->config.all_clear_scores[cleared_lines];
+			score += game->config->all_clear_scores[cleared_lines];
 		}
 	}
 	score += 50 * game->combo;
 	game->score += score * game->level;
-	if (game->config.action_text) {
-		game->config.action_text(game->action_text_data, cleared_lines,
+	if (game->config->action_text) {
+		game->config->action_text(game->action_text_data, cleared_lines,
 					 game->combo, game->b2b
 					 && b2b, all_clear, spin, mini_spin);
 	}
@@ -416,21 +633,29 @@ void CitrusGame_lock_piece(CitrusGame *game)
 	if (game->level > 20) {
 		game->level = 20;
 	}
+	if (cleared_lines > 0) {
+		CitrusTracer_record(game->tracer, CITRUS_TRACE_LINE_CLEAR,
+				    CITRUS_TRACE_INSTANT, game->trace_id,
+				    cleared_lines);
+	}
 	if (CitrusGame_collided(game)) {
 		game->alive = false;
+		CitrusTracer_record(game->tracer, CITRUS_TRACE_TOP_OUT,
+				    CITRUS_TRACE_INSTANT, game->trace_id, 0);
 	} else {
-		if (cleared_lines > 0 && game->config.line_clear_delay > 0) {
-			game->line_clear_delay = game->config.line_clear_delay;
+		if (cleared_lines > 0 && game->config->line_clear_delay > 0) {
+			game->line_clear_delay = game->config->line_clear_delay;
 		} else {
 			CitrusGame_draw_piece(game, false);
 		}
 	}
+	CitrusTracer_record(game->tracer, CITRUS_TRACE_LOCK, CITRUS_TRACE_END,
+			    game->trace_id, cleared_lines);
 }
 
-// rotate a piece n*90 degrees clockwise using srs kicks
-bool CitrusGame_rotate_piece(CitrusGame *game, int n)
+// rotate a piece which has been erased from the board
+bool CitrusGame_rotate_piece_inner(CitrusGame *game, int n)
 {
-	CitrusGame_draw_piece(game, true);
 	int prev_rotation = game->rotation;
 	CitrusVector prev_position = game->position;
 	game->rotation += n + game->current_piece->n_rotation_states;
@@ -440,7 +665,7 @@ bool CitrusGame_rotate_piece(CitrusGame *game, int n)
 	int row = n > 0 ? prev_rotation : game->rotation;
 	bool i_piece = game->current_piece == &citrus_pieces[CITRUS_COLOR_I];
 	const CitrusVector *kick_table =
-	    i_piece ? I_KICK_TABLE[row] : KICK_TABLE[row];
+	    i_piece ? citrus_i_kick_table[row] : citrus_kick_table[row];
 	for (int i = 0; i < 5; i++) {
 		CitrusVector offset = kick_table[i];
 		if (n < 0) {
@@ -457,53 +682,79 @@ bool CitrusGame_rotate_piece(CitrusGame *game, int n)
 		game->rotation = prev_rotation;
 		game->position = prev_position;
 	}
-	CitrusGame_draw_piece(game, false);
 	return success;
 }
 
-// key is pressed
-void CitrusGame_key_down(CitrusGame *game, CitrusKey key)
+// rotate a piece n*90 degrees clockwise using srs kicks
+bool CitrusGame_rotate_piece(CitrusGame *game, int n)
+{
+	uint64_t dirty_rows = game->dirty_rows;
+	CitrusGame_draw_piece(game, true);
+	bool rotated = CitrusGame_rotate_piece_inner(game, n);
+	CitrusGame_draw_piece(game, false);
+	// a blocked piece is redrawn where it was
+	if (!rotated) {
+		game->dirty_rows = dirty_rows;
+	}
+	return rotated;
+}
+
+// check if the current piece is drawn on the board
+bool CitrusGame_piece_shown(CitrusGame *game)
+{
+	return game->alive && game->line_clear_delay == 0;
+}
+
+// handle a key press while the current piece is erased from the board
+void CitrusGame_key_down_inner(CitrusGame *game, CitrusKey key, int offset)
 {
-	if (!game->alive)
-		return;
-	if (game->line_clear_delay > 0)
-		return;
 	bool moved = false;
+	int distance;
 	switch (key) {
 	case CITRUS_KEY_LEFT:
 		game->move_direction = -1;
-		game->move_frames = 0;
-		moved = CitrusGame_move_piece(game, -1, 0);
+		game->move_frames = -offset;
+		moved = CitrusGame_move_piece_inner(game, -1, 0);
 		break;
 	case CITRUS_KEY_RIGHT:
 		game->move_direction = 1;
-		game->move_frames = 0;
-		moved = CitrusGame_move_piece(game, 1, 0);
+		game->move_frames = -offset;
+		moved = CitrusGame_move_piece_inner(game, 1, 0);
 		break;
 	case CITRUS_KEY_HARD_DROP:
-		while (CitrusGame_move_piece(game, 0, -1))
-			game->score += 2;
+		distance = CitrusGame_drop_distance(game);
+		if (distance > 0) {
+			CitrusGame_move_piece_inner(game, 0, -distance);
+			game->score += 2 * distance;
+		}
+		// locking needs the piece on the board to clear lines
+		CitrusGame_draw_piece(game, false);
 		CitrusGame_lock_piece(game);
+		if (CitrusGame_piece_shown(game)) {
+			CitrusGame_draw_piece(game, true);
+		}
 		break;
 	case CITRUS_KEY_SOFT_DROP:
 		game->soft_drop = true;
-		while (CitrusGame_move_piece(game, 0, -1))
-			game->score++;
+		distance = CitrusGame_drop_distance(game);
+		if (distance > 0) {
+			CitrusGame_move_piece_inner(game, 0, -distance);
+			game->score += distance;
+		}
 		break;
 	case CITRUS_KEY_CLOCKWISE:
-		moved = CitrusGame_rotate_piece(game, 1);
+		moved = CitrusGame_rotate_piece_inner(game, 1);
 		break;
 	case CITRUS_KEY_ANTICLOCKWISE:
-		moved = CitrusGame_rotate_piece(game, -1);
+		moved = CitrusGame_rotate_piece_inner(game, -1);
 		break;
 	case CITRUS_KEY_180:
-		moved = CitrusGame_rotate_piece(game, 2);
+		moved = CitrusGame_rotate_piece_inner(game, 2);
 		break;
 	case CITRUS_KEY_HOLD:
 		if (game->held) {
 			break;
 		}
-		CitrusGame_draw_piece(game, true);
 		const CitrusPiece *piece = game->hold_piece;
 		game->hold_piece = game->current_piece;
 		if (piece == NULL) {
@@ -512,16 +763,88 @@ void CitrusGame_key_down(CitrusGame *game, CitrusKey key)
 			game->current_piece = piece;
 		}
 		CitrusGame_reset_piece(game);
-		CitrusGame_draw_piece(game, false);
 		game->held = true;
+		// holding into the stack tops out like spawning into it
+		if (CitrusGame_collided(game)) {
+			game->alive = false;
+			CitrusTracer_record(game->tracer, CITRUS_TRACE_TOP_OUT,
+					    CITRUS_TRACE_INSTANT,
+					    game->trace_id, 0);
+		}
 		break;
 	}
-	if (moved && game->move_reset_count < game->config.max_move_reset) {
-		game->lock_delay = game->config.lock_delay;
+	if (moved && game->move_reset_count < game->config->max_move_reset) {
+		game->lock_delay = game->config->lock_delay;
 		game->move_reset_count++;
 	}
 }
 
+// apply a list of key presses and releases, drawing the piece once
+void CitrusGame_apply_inputs(CitrusGame *game, const CitrusInput *inputs,
+			     int n)
+{
+	bool erased = false;
+	for (int i = 0; i < n; i++) {
+		if (!inputs[i].down) {
+			CitrusGame_key_up(game, inputs[i].key);
+			continue;
+		}
+		// presses are ignored while there's no piece in play
+		if (!CitrusGame_piece_shown(game)) {
+			continue;
+		}
+		if (!erased) {
+			CitrusGame_draw_piece(game, true);
+			erased = true;
+		}
+		CitrusGame_key_down_inner(game, inputs[i].key,
+					  inputs[i].offset);
+	}
+	if (erased && CitrusGame_piece_shown(game)) {
+		CitrusGame_draw_piece(game, false);
+	}
+}
+
+// apply masks of keys pressed and released, pressing keys first
+void CitrusGame_apply_masks(CitrusGame *game, unsigned down, unsigned up)
+{
+	CitrusInput inputs[16];
+	int n = 0;
+	for (int key = 0; key < 8; key++) {
+		if (down & 1 << key) {
+			inputs[n].key = key;
+			inputs[n].down = true;
+			inputs[n].offset = 0;
+			n++;
+		}
+	}
+	for (int key = 0; key < 8; key++) {
+		if (up & 1 << key) {
+			inputs[n].key = key;
+			inputs[n].down = false;
+			inputs[n].offset = 0;
+			n++;
+		}
+	}
+	CitrusGame_apply_inputs(game, inputs, n);
+}
+
+// key is pressed
+void CitrusGame_key_down(CitrusGame *game, CitrusKey key)
+{
+	CitrusGame_key_down_at(game, key, 0);
+}
+
+// key is pressed some subticks after the last tick
+void CitrusGame_key_down_at(CitrusGame *game, CitrusKey key, int offset)
+{
+	CitrusInput input;
+	input.key = key;
+	input.down = true;
+	input.offset = offset;
+	CitrusGame_apply_inputs(game, &input, 1);
+}
+
 // key is released
 void CitrusGame_key_up(CitrusGame *game, CitrusKey key)
 {
@@ -546,32 +869,35 @@ void CitrusGame_tick(CitrusGame *game)
 		return;
 	}
 	if (game->move_direction != 0) {
-		game->move_frames++;
-		if (game->move_frames == game->config.das) {
-			if (game->config.arr == 0) {
-				while (CitrusGame_move_piece
-				       (game, game->move_direction, 0)) ;
-				game->move_frames = game->config.das - 1;
-			} else {
+		// das and arr are counted in subticks so presses between ticks
+		// charge from when they happened
+		int subticks = game->config->subticks > 0 ?
+		    game->config->subticks : 1;
+		int das = game->config->das * subticks;
+		int arr = game->config->arr * subticks;
+		bool charged = game->move_frames >= das;
+		game->move_frames += subticks;
+		if (game->move_frames >= das && game->config->arr == 0) {
+			while (CitrusGame_move_piece
+			       (game, game->move_direction, 0)) ;
+			game->move_frames = das;
+		} else if (game->move_frames >= das) {
+			if (!charged) {
 				CitrusGame_move_piece(game,
 						      game->move_direction, 0);
 			}
-		} else if (game->move_frames ==
-			   game->config.das + game->config.arr) {
-			CitrusGame_move_piece(game, game->move_direction, 0);
-			game->move_frames = game->config.das;
+			while (game->move_frames >= das + arr) {
+				CitrusGame_move_piece(game,
+						      game->move_direction, 0);
+				game->move_frames -= arr;
+			}
 		}
 	}
 	if (game->soft_drop) {
 		while (CitrusGame_move_piece(game, 0, -1))
 			game->score++;
 	}
-	CitrusGame_draw_piece(game, true);
-	game->position.y--;
-	bool on_ground = CitrusGame_collided(game);
-	game->position.y++;
-	CitrusGame_draw_piece(game, false);
-	if (on_ground) {
+	if (CitrusGame_on_ground(game)) {
 		// lock delay
 		game->lock_delay--;
 		if (game->lock_delay == 0) {
@@ -579,7 +905,7 @@ void CitrusGame_tick(CitrusGame *game)
 		}
 	} else {
 		// gravity
-		game->fall_amount += game->config.gravity;
+		game->fall_amount += game->config->gravity;
 		while (game->fall_amount >= 1) {
 			game->fall_amount -= 1;
 			CitrusGame_move_piece(game, 0, -1);
@@ -587,6 +913,95 @@ void CitrusGame_tick(CitrusGame *game)
 	}
 }
 
+// runs n ticks, skipping the board updates of ticks where nothing happens
+void CitrusGame_skip_ticks(CitrusGame *game, int n)
+{
+	while (n > 0) {
+		if (game->line_clear_delay > 0 || game->move_direction != 0
+		    || game->soft_drop || !game->alive) {
+			CitrusGame_tick(game);
+			n--;
+			continue;
+		}
+		// the board can't change until the piece locks, so find where
+		// the piece lands once and replay gravity and lock delay
+		CitrusGame_draw_piece(game, true);
+		int y = game->position.y;
+		int ground_y = y - CitrusGame_drop_distance(game);
+		bool locked = false;
+		while (n > 0 && !locked) {
+			n--;
+			if (y == ground_y) {
+				game->lock_delay--;
+				locked = game->lock_delay == 0;
+				continue;
+			}
+			game->fall_amount += game->config->gravity;
+			while (game->fall_amount >= 1) {
+				game->fall_amount -= 1;
+				if (y == ground_y) {
+					continue;
+				}
+				y--;
+				game->last_kick = -1;
+				if (y < game->lowest_y) {
+					game->lowest_y = y;
+					game->move_reset_count = 0;
+					game->lock_delay = game->config->lock_delay;
+				}
+			}
+		}
+		game->position.y = y;
+		CitrusGame_draw_piece(game, false);
+		if (locked) {
+			CitrusGame_lock_piece(game);
+		}
+	}
+}
+
+// add a value to an fnv-1a hash
+uint32_t Citrus_hash(uint32_t hash, uint32_t value)
+{
+	for (int i = 0; i < 4; i++) {
+		hash ^= value & 0xff;
+		hash *= 16777619;
+		value >>= 8;
+	}
+	return hash;
+}
+
+// index of a piece in citrus_pieces, or 7 for other pieces
+uint32_t Citrus_piece_index(const CitrusPiece *piece)
+{
+	for (int i = 0; i < 7; i++) {
+		if (piece == citrus_pieces + i) {
+			return i;
+		}
+	}
+	return 7;
+}
+
+// hash the state of a game
+uint32_t CitrusGame_checksum(CitrusGame *game)
+{
+	uint32_t hash = 2166136261;
+	for (int i = 0; i < game->config->width * game->config->full_height; i++) {
+		CitrusCell cell = game->board[i];
+		hash = Citrus_hash(hash, cell.type == CITRUS_CELL_FULL ?
+				   cell.color + 1 : 0);
+	}
+	hash = Citrus_hash(hash, Citrus_piece_index(game->current_piece));
+	hash = Citrus_hash(hash, game->hold_piece == NULL ? 8 :
+			   Citrus_piece_index(game->hold_piece));
+	hash = Citrus_hash(hash, game->position.x);
+	hash = Citrus_hash(hash, game->position.y);
+	hash = Citrus_hash(hash, game->rotation);
+	hash = Citrus_hash(hash, game->score);
+	hash = Citrus_hash(hash, game->lines);
+	hash = Citrus_hash(hash, game->alive);
+	return hash;
+}
+
 // gets a cell at a location
 CitrusCell CitrusGame_get_cell(CitrusGame *game, CitrusVector position)
 {
@@ -594,7 +1009,7 @@ CitrusCell CitrusGame_get_cell(CitrusGame *game, CitrusVector position)
 		return (CitrusCell) {
 		.type = CITRUS_CELL_WALL};
 	}
-	return game->board[position.y * game->config.width + position.x];
+	return game->board[position.y * game->config->width + position.x];
 }
 
 // gets a piece in the queue
@@ -609,6 +1024,47 @@ bool CitrusGame_is_alive(CitrusGame *game)
 	return game->alive;
 }
 
+// get the rows changed since the mask was last cleared
+uint64_t CitrusGame_get_dirty_rows(CitrusGame *game)
+{
+	return game->dirty_rows;
+}
+
+// mark every row as unchanged
+void CitrusGame_clear_dirty_rows(CitrusGame *game)
+{
+	game->dirty_rows = 0;
+}
+
+// keep a bitboard of the full cells to speed up collisions on wide boards
+void CitrusGame_set_occupancy(CitrusGame *game, uint64_t *occupancy)
+{
+	int width = game->config->width;
+	int words = CITRUS_ROW_WORDS(width);
+	game->occupancy = occupancy;
+	if (occupancy == NULL) {
+		return;
+	}
+	for (int y = 0; y < game->config->full_height; y++) {
+		for (int i = 0; i < words; i++) {
+			occupancy[y * words + i] = 0;
+		}
+		for (int x = 0; x < width; x++) {
+			if (game->board[y * width + x].type ==
+			    CITRUS_CELL_FULL) {
+				occupancy[y * words + x / 64] |=
+				    (uint64_t) 1 << x % 64;
+			}
+		}
+	}
+}
+
+// check if a row is in a dirty row mask
+bool Citrus_row_dirty(uint64_t rows, int y)
+{
+	return (rows & Citrus_row_bit(y)) != 0;
+}
+
 // initialise a bag with a fixed seed
 void CitrusBagRandomizer_init(CitrusBagRandomizer *bag, int seed)
 {
@@ -640,6 +1096,34 @@ const CitrusPiece *CitrusBagRandomizer_randomizer(void *data)
 	return citrus_pieces + (piece % 7);
 }
 
+// skip the next n pieces from a bag
+void CitrusBagRandomizer_skip(CitrusBagRandomizer *bag, uint64_t n)
+{
+	// each piece uses exactly one random number, and pieces from later
+	// bags don't depend on earlier ones, so whole bags can be skipped by
+	// jumping the generator ahead
+	uint64_t remaining = 7 - bag->count;
+	if (n > remaining) {
+		uint64_t bags = (n - remaining) / 7;
+		Citrus_random_skip(&bag->state, remaining + bags * 7);
+		bag->count = 7;
+		n -= remaining + bags * 7;
+	}
+	for (uint64_t i = 0; i < n; i++) {
+		CitrusBagRandomizer_randomizer(bag);
+	}
+}
+
+// get the next n pieces from a bag without changing it
+void CitrusBagRandomizer_peek(const CitrusBagRandomizer *bag,
+			      const CitrusPiece **pieces, int n)
+{
+	CitrusBagRandomizer copy = *bag;
+	for (int i = 0; i < n; i++) {
+		pieces[i] = CitrusBagRandomizer_randomizer(&copy);
+	}
+}
+
 // initialise a classic randomiser with a fixed seed
 void CitrusClassicRandomizer_init(CitrusClassicRandomizer *randomizer, int seed)
 {
@@ -659,6 +1143,38 @@ const CitrusPiece *CitrusClassicRandomizer_randomizer(void *data)
 	return citrus_pieces + piece;
 }
 
+// get the next n pieces from a classic randomiser without changing it
+void CitrusClassicRandomizer_peek(const CitrusClassicRandomizer *randomizer,
+				  const CitrusPiece **pieces, int n)
+{
+	CitrusClassicRandomizer copy = *randomizer;
+	for (int i = 0; i < n; i++) {
+		pieces[i] = CitrusClassicRandomizer_randomizer(&copy);
+	}
+}
+
+// advance the random number generator by k steps in O(log k) time
+void Citrus_random_skip(uint64_t *state, uint64_t k)
+{
+	// each step is the affine map x -> a * x + c, and composing the map
+	// with itself gives the map for twice as many steps
+	uint64_t multiplier = 6364136223846793005ULL;
+	uint64_t increment = 1;
+	uint64_t total_multiplier = 1;
+	uint64_t total_increment = 0;
+	while (k > 0) {
+		if (k & 1) {
+			total_multiplier *= multiplier;
+			total_increment = total_increment * multiplier +
+			    increment;
+		}
+		increment *= multiplier + 1;
+		multiplier *= multiplier;
+		k >>= 1;
+	}
+	*state = *state * total_multiplier + total_increment;
+}
+
 // generate a random number betweem 0 and 2^32 - 1
 uint32_t Citrus_random(uint64_t *state)
 {
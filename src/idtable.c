@@ -0,0 +1,112 @@
+/* Copyright (C) 2026 RZ781
+ *
+ * This file is part of libcitrus.
+ *
+ * libcitrus is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 2.1 of the License, or (at your option)
+ * any later version.
+ *
+ * libcitrus is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include "citrus.h"
+
+// initialise an empty table, returning false unless capacity is a power of
+// two, which probing relies on to wrap around
+bool CitrusIdTable_init(CitrusIdTable *table, CitrusIdEntry *entries,
+			int capacity)
+{
+	if (capacity < 1 || (capacity & (capacity - 1)) != 0) {
+		return false;
+	}
+	table->entries = entries;
+	table->capacity = capacity;
+	table->count = 0;
+	for (int i = 0; i < capacity; i++) {
+		entries[i].key = -1;
+	}
+	return true;
+}
+
+// index an id hashes to, using fibonacci hashing to spread sequential ids
+int CitrusIdTable_home(CitrusIdTable *table, int key)
+{
+	uint32_t hash = (uint32_t) key * 2654435769u;
+	return (hash ^ hash >> 16) & (table->capacity - 1);
+}
+
+// find the index of a key, or the empty entry where it would be inserted
+int CitrusIdTable_find(CitrusIdTable *table, int key)
+{
+	int mask = table->capacity - 1;
+	int i = CitrusIdTable_home(table, key);
+	while (table->entries[i].key != -1 && table->entries[i].key != key) {
+		i = (i + 1) & mask;
+	}
+	return i;
+}
+
+// add a key, returning false if it already exists or the table is full
+bool CitrusIdTable_insert(CitrusIdTable *table, int key, int value)
+{
+	// keep one entry empty so lookups always terminate
+	if (key < 0 || table->count >= table->capacity - 1) {
+		return false;
+	}
+	int i = CitrusIdTable_find(table, key);
+	if (table->entries[i].key == key) {
+		return false;
+	}
+	table->entries[i].key = key;
+	table->entries[i].value = value;
+	table->count++;
+	return true;
+}
+
+// get the value of a key, or -1 if it isn't in the table
+int CitrusIdTable_get(CitrusIdTable *table, int key)
+{
+	if (key < 0) {
+		return -1;
+	}
+	int i = CitrusIdTable_find(table, key);
+	return table->entries[i].key == key ? table->entries[i].value : -1;
+}
+
+// remove a key, shifting later entries back instead of leaving tombstones
+bool CitrusIdTable_remove(CitrusIdTable *table, int key)
+{
+	if (key < 0) {
+		return false;
+	}
+	int mask = table->capacity - 1;
+	int i = CitrusIdTable_find(table, key);
+	if (table->entries[i].key != key) {
+		return false;
+	}
+	int j = i;
+	while (true) {
+		j = (j + 1) & mask;
+		if (table->entries[j].key == -1) {
+			break;
+		}
+		// move the entry into the gap unless its home lies cyclically
+		// between the gap and its current position
+		int home = CitrusIdTable_home(table, table->entries[j].key);
+		if (((j - home) & mask) >= ((j - i) & mask)) {
+			table->entries[i] = table->entries[j];
+			i = j;
+		}
+	}
+	table->entries[i].key = -1;
+	table->count--;
+	return true;
+}
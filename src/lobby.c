@@ -16,126 +16,751 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <stddef.h>
 #include <stdint.h>
 #include "citrus.h"
 
-typedef enum {
-	CITRUS_EVENT_CONNECT,
-	CITRUS_EVENT_DISCONNECT
-} CitrusEventType;
-
 typedef struct {
 	CitrusEventType type;
 	int client_id;
-	int data;
+	const uint8_t *data;	// event specific data following the client id
+	int length;
 } CitrusEvent;
 
-void CitrusParser_init(CitrusParser *parser)
+// decode an event from a frame, returning false if it's malformed
+bool CitrusEvent_decode(CitrusEvent *event, CitrusFrame frame)
 {
-	parser->read_pointer = 0;
-	parser->write_pointer = 0;
+	if (frame.length < 1) {
+		return false;
+	}
+	event->type = frame.data[0];
+	uint64_t client_id;
+	int n = Citrus_read_varint(frame.data + 1, frame.length - 1,
+				   &client_id);
+	if (n <= 0 || client_id > INT32_MAX) {
+		return false;
+	}
+	event->client_id = client_id;
+	event->data = frame.data + 1 + n;
+	event->length = frame.length - 1 - n;
+	return true;
 }
 
-bool CitrusParser_send(CitrusParser *parser, int n, uint8_t *data)
+void CitrusLobby_init(CitrusLobby *lobby, CitrusLobbySlot *slots,
+		      int *active_slots, int capacity)
 {
-	for (int i = 0; i < n; i++) {
-		parser->buffer[parser->write_pointer++] = data[i];
-		parser->write_pointer %= CITRUS_PARSER_BUFFER_SIZE;
-		if (parser->write_pointer == parser->read_pointer) {
-			return false;
+	lobby->slots = slots;
+	lobby->active_slots = active_slots;
+	lobby->n_active_slots = 0;
+	lobby->active_slots_sorted = true;
+	lobby->capacity = capacity;
+	lobby->max_input_tick = INT32_MAX;
+	lobby->tracer = NULL;
+	for (int i = 0; i < capacity; i++) {
+		slots[i].validator = NULL;
+		slots[i].connection_id = i;
+		slots[i].connected = false;
+		slots[i].in_game = false;
+		slots[i].active_index = i;
+		slots[i].input_tick = 0;
+		slots[i].checksum_pending = false;
+		slots[i].game_tick = 0;
+		slots[i].pending_start = 0;
+		slots[i].n_pending = 0;
+		slots[i].applied_tick = 0;
+		slots[i].acked_tick = 0;
+		slots[i].output_length = 0;
+		slots[i].spectating = -1;
+		slots[i].first_spectator = -1;
+		slots[i].next_spectator = -1;
+		slots[i].previous_spectator = -1;
+		slots[i].keyframe_needed = false;
+		active_slots[i] = i;
+	}
+}
+
+// swap two entries in the active slot list
+void CitrusLobby_swap_active(CitrusLobby *lobby, int a, int b)
+{
+	int slot_a = lobby->active_slots[a];
+	int slot_b = lobby->active_slots[b];
+	lobby->active_slots[a] = slot_b;
+	lobby->active_slots[b] = slot_a;
+	lobby->slots[slot_a].active_index = b;
+	lobby->slots[slot_b].active_index = a;
+	lobby->active_slots_sorted = false;
+}
+
+// sort connected slots so they are visited in memory order
+void CitrusLobby_sort_active(CitrusLobby *lobby)
+{
+	if (lobby->active_slots_sorted) {
+		return;
+	}
+	// the list is usually nearly sorted, so use an insertion sort
+	for (int i = 1; i < lobby->n_active_slots; i++) {
+		int slot = lobby->active_slots[i];
+		int j = i;
+		while (j > 0 && lobby->active_slots[j - 1] > slot) {
+			lobby->active_slots[j] = lobby->active_slots[j - 1];
+			lobby->slots[lobby->active_slots[j]].active_index = j;
+			j--;
 		}
+		lobby->active_slots[j] = slot;
+		lobby->slots[slot].active_index = j;
 	}
-	return true;
+	lobby->active_slots_sorted = true;
 }
 
-bool CitrusParser_get_event(CitrusParser *parser, CitrusEvent *event)
+// remove a client from the spectators of the client it is spectating
+void CitrusLobby_stop_spectating(CitrusLobby *lobby, int id)
 {
-	int length = parser->write_pointer - parser->read_pointer;
-	if (length < 0) {
-		length += CITRUS_PARSER_BUFFER_SIZE;
+	CitrusLobbySlot *slot = &lobby->slots[id];
+	if (slot->spectating == -1) {
+		return;
 	}
-	if (length < 4) {
-		return false;
+	if (slot->previous_spectator == -1) {
+		lobby->slots[slot->spectating].first_spectator =
+		    slot->next_spectator;
+	} else {
+		lobby->slots[slot->previous_spectator].next_spectator =
+		    slot->next_spectator;
 	}
-	event->type = parser->buffer[parser->read_pointer++];
-	parser->read_pointer %= CITRUS_PARSER_BUFFER_SIZE;
-	event->client_id = parser->buffer[parser->read_pointer++];
-	parser->read_pointer %= CITRUS_PARSER_BUFFER_SIZE;
-	event->data = parser->buffer[parser->read_pointer++] << 8;
-	parser->read_pointer %= CITRUS_PARSER_BUFFER_SIZE;
-	event->data |= parser->buffer[parser->read_pointer++];
-	parser->read_pointer %= CITRUS_PARSER_BUFFER_SIZE;
-	return true;
+	if (slot->next_spectator != -1) {
+		lobby->slots[slot->next_spectator].previous_spectator =
+		    slot->previous_spectator;
+	}
+	slot->spectating = -1;
+	slot->next_spectator = -1;
+	slot->previous_spectator = -1;
 }
 
-void CitrusLobby_init(CitrusLobby *lobby)
+// add a client to the spectators of another client
+void CitrusLobby_spectate(CitrusLobby *lobby, int id, int target)
 {
-	for (int i = 0; i < 256; i++) {
-		lobby->in_game_clients[i] = false;
-		lobby->connected_clients[i] = false;
+	CitrusLobby_stop_spectating(lobby, id);
+	if (target < 0 || target >= lobby->capacity || target == id
+	    || !lobby->slots[target].connected) {
+		return;
+	}
+	CitrusLobbySlot *slot = &lobby->slots[id];
+	CitrusLobbySlot *target_slot = &lobby->slots[target];
+	slot->spectating = target;
+	slot->next_spectator = target_slot->first_spectator;
+	if (target_slot->first_spectator != -1) {
+		lobby->slots[target_slot->first_spectator].previous_spectator =
+		    id;
 	}
+	target_slot->first_spectator = id;
+	// new spectators need the full board
+	target_slot->keyframe_needed = true;
+}
+
+void CitrusLobby_connect(CitrusLobby *lobby, int id)
+{
+	if (id < 0 || id >= lobby->capacity || lobby->slots[id].connected) {
+		return;
+	}
+	lobby->slots[id].validator = NULL;
+	lobby->slots[id].connected = true;
+	lobby->slots[id].in_game = false;
+	lobby->slots[id].input_tick = 0;
+	lobby->slots[id].checksum_pending = false;
+	lobby->slots[id].game_tick = 0;
+	lobby->slots[id].n_pending = 0;
+	lobby->slots[id].applied_tick = 0;
+	lobby->slots[id].acked_tick = 0;
+	lobby->slots[id].output_length = 0;
+	CitrusLobby_swap_active(lobby, lobby->slots[id].active_index,
+				lobby->n_active_slots);
+	lobby->n_active_slots++;
+}
+
+void CitrusLobby_disconnect(CitrusLobby *lobby, int id)
+{
+	if (id < 0 || id >= lobby->capacity || !lobby->slots[id].connected) {
+		return;
+	}
+	lobby->slots[id].connected = false;
+	lobby->slots[id].in_game = false;
+	CitrusLobby_stop_spectating(lobby, id);
+	while (lobby->slots[id].first_spectator != -1) {
+		CitrusLobby_stop_spectating(lobby,
+					    lobby->slots[id].first_spectator);
+	}
+	lobby->n_active_slots--;
+	CitrusLobby_swap_active(lobby, lobby->slots[id].active_index,
+				lobby->n_active_slots);
+}
+
+// apply the oldest input waiting for a slot's game
+void CitrusLobby_apply_pending(CitrusLobbySlot *slot)
+{
+	CitrusLobbyInput *input = &slot->pending[slot->pending_start];
+	CitrusGame_apply_masks(&slot->game, input->down, input->up);
+	slot->applied_tick = input->tick;
+	slot->pending_start = (slot->pending_start + 1) %
+	    CITRUS_LOBBY_PENDING_INPUTS;
+	slot->n_pending--;
+}
+
+// queue a batch of inputs for a client's game, disconnecting the client if
+// the batch is malformed or runs too far ahead
+void CitrusLobby_input(CitrusLobby *lobby, CitrusEvent event)
+{
+	int id = event.client_id;
+	if (id < 0 || id >= lobby->capacity || !lobby->slots[id].connected) {
+		return;
+	}
+	CitrusLobbySlot *slot = &lobby->slots[id];
+	const uint8_t *data = event.data;
+	int length = event.length;
+	while (length > 0) {
+		uint64_t delta, keys;
+		int n = Citrus_read_varint(data, length, &delta);
+		int m = n <= 0 ? 0 : Citrus_read_varint(data + n, length - n,
+							 &keys);
+		// the tick is bounded before it's added to, so a huge delta
+		// can't wrap it or make the validator replay billions of ticks
+		if (m <= 0 || slot->input_tick > lobby->max_input_tick
+		    || delta > (uint64_t) (lobby->max_input_tick -
+					   slot->input_tick)) {
+			CitrusLobby_disconnect(lobby, id);
+			return;
+		}
+		data += n + m;
+		length -= n + m;
+		slot->input_tick += delta;
+		if (slot->validator != NULL && slot->checksum_pending
+		    && slot->input_tick > slot->checksum_tick) {
+			CitrusValidator_check(slot->validator,
+					      slot->checksum_tick,
+					      slot->checksum);
+			slot->checksum_pending = false;
+		}
+		if (slot->validator != NULL) {
+			CitrusValidator_input(slot->validator, slot->input_tick,
+					      keys & 0xff, keys >> 8 & 0xff);
+		}
+		if (!slot->in_game) {
+			slot->applied_tick = slot->input_tick;
+			continue;
+		}
+		// inputs are applied when the game reaches their tick, and
+		// a client too far ahead has its oldest input applied early
+		if (slot->n_pending == CITRUS_LOBBY_PENDING_INPUTS) {
+			CitrusLobby_apply_pending(slot);
+		}
+		int i = (slot->pending_start + slot->n_pending) %
+		    CITRUS_LOBBY_PENDING_INPUTS;
+		slot->pending[i].tick = slot->input_tick;
+		slot->pending[i].down = keys & 0xff;
+		slot->pending[i].up = keys >> 8 & 0xff;
+		slot->n_pending++;
+	}
+}
+
+// check a client's checksum against its validator
+void CitrusLobby_checksum(CitrusLobby *lobby, CitrusEvent event)
+{
+	int id = event.client_id;
+	if (id < 0 || id >= lobby->capacity
+	    || lobby->slots[id].validator == NULL) {
+		return;
+	}
+	uint64_t tick, checksum;
+	int n = Citrus_read_varint(event.data, event.length, &tick);
+	if (n <= 0 || tick > (uint64_t) lobby->max_input_tick
+	    || Citrus_read_varint(event.data + n, event.length - n,
+				  &checksum) <= 0) {
+		CitrusLobby_disconnect(lobby, id);
+		return;
+	}
+	// inputs up to the checksum's tick may still be on their way, so the
+	// comparison waits for an input past it
+	CitrusLobbySlot *slot = &lobby->slots[id];
+	if ((int)tick > slot->input_tick) {
+		slot->checksum_pending = true;
+		slot->checksum_tick = tick;
+		slot->checksum = checksum;
+		return;
+	}
+	CitrusValidator_check(slot->validator, tick, checksum);
 }
 
 void CitrusLobby_event(CitrusLobby *lobby, CitrusEvent event)
 {
 	switch (event.type) {
+	case CITRUS_EVENT_CONNECT:
+		CitrusLobby_connect(lobby, event.client_id);
+		break;
+	case CITRUS_EVENT_DISCONNECT:
+		CitrusLobby_disconnect(lobby, event.client_id);
+		break;
+	case CITRUS_EVENT_INPUT:
+		CitrusLobby_input(lobby, event);
+		break;
+	case CITRUS_EVENT_SPECTATE:{
+			// ids are offset by one so 0 means stop spectating
+			uint64_t target;
+			if (Citrus_read_varint(event.data, event.length,
+					       &target) > 0
+			    && target <= INT32_MAX) {
+				CitrusLobby_spectate(lobby, event.client_id,
+						     (int)target - 1);
+			}
+			break;
+		}
+	case CITRUS_EVENT_CHECKSUM:
+		CitrusLobby_checksum(lobby, event);
+		break;
 	default:
 		break;
 	}
 }
 
-void CitrusClientLobby_init(CitrusClientLobby *lobby,
+// decode the next event from a parser
+CitrusParserStatus CitrusLobby_next_event(CitrusParser *parser,
+					  CitrusEvent *event)
+{
+	CitrusFrame frame;
+	CitrusParserStatus status;
+	while ((status = CitrusParser_next(parser, &frame)) ==
+	       CITRUS_PARSER_FRAME) {
+		if (CitrusEvent_decode(event, frame)) {
+			break;
+		}
+	}
+	return status;
+}
+
+void CitrusClientLobby_init(CitrusClientLobby *lobby, CitrusLobbySlot *slots,
+			    int *active_slots, int capacity,
+			    uint8_t *parser_buffer, int parser_buffer_size,
+			    uint8_t *input_buffer, int input_buffer_size,
 			    void (*send)(void *send_data, int n, uint8_t *data),
 			    void *send_data)
 {
-	CitrusParser_init(&lobby->parser);
-	CitrusLobby_init(&lobby->lobby);
+	CitrusParser_init(&lobby->parser, parser_buffer, parser_buffer_size);
+	// the server fills in the client id
+	CitrusInputEncoder_init(&lobby->input_encoder, input_buffer,
+				input_buffer_size, 0);
+	lobby->acked_tick = 0;
+	lobby->spectate_id = -1;
+	lobby->spectate_frame = NULL;
+	lobby->spectate_width = 0;
+	lobby->spectate_height = 0;
+	lobby->spectate_tick = 0;
+	CitrusLobby_init(&lobby->lobby, slots, active_slots, capacity);
 	lobby->send = send;
 	lobby->send_data = send_data;
 }
 
-void CitrusClientLobby_recv(CitrusClientLobby *lobby, int n, uint8_t *data)
+// update the spectated board from a board event
+void CitrusClientLobby_board(CitrusClientLobby *lobby, CitrusEvent event)
 {
-	CitrusParser_send(&lobby->parser, n, data);
+	if (event.client_id != lobby->spectate_id) {
+		return;
+	}
+	uint64_t tick, keyframe;
+	int n = Citrus_read_varint(event.data, event.length, &tick);
+	if (n <= 0) {
+		return;
+	}
+	int m = Citrus_read_varint(event.data + n, event.length - n, &keyframe);
+	if (m <= 0) {
+		return;
+	}
+	if (Citrus_read_board_diff(lobby->spectate_frame,
+				   lobby->spectate_width,
+				   lobby->spectate_height, event.data + n + m,
+				   event.length - n - m, keyframe)) {
+		lobby->spectate_tick = tick;
+	}
+}
+
+bool CitrusClientLobby_recv(CitrusClientLobby *lobby, int n, uint8_t *data)
+{
+	CitrusParser_feed(&lobby->parser, n, data);
 	CitrusEvent event;
-	while (CitrusParser_get_event(&lobby->parser, &event)) {
-		CitrusLobby_event(&lobby->lobby, event);
+	CitrusParserStatus status;
+	while ((status = CitrusLobby_next_event(&lobby->parser, &event)) ==
+	       CITRUS_PARSER_FRAME) {
+		if (event.type == CITRUS_EVENT_ACK) {
+			uint64_t tick;
+			if (Citrus_read_varint(event.data, event.length,
+					       &tick) > 0) {
+				lobby->acked_tick = tick;
+			}
+		} else if (event.type == CITRUS_EVENT_BOARD) {
+			CitrusClientLobby_board(lobby, event);
+		} else {
+			CitrusLobby_event(&lobby->lobby, event);
+		}
 	}
+	return status == CITRUS_PARSER_EMPTY;
+}
+
+void CitrusClientLobby_input(CitrusClientLobby *lobby, int tick,
+			     unsigned down, unsigned up)
+{
+	if (!CitrusInputEncoder_add(&lobby->input_encoder, tick, down, up)) {
+		CitrusClientLobby_flush(lobby);
+		CitrusInputEncoder_add(&lobby->input_encoder, tick, down, up);
+	}
+}
+
+void CitrusClientLobby_flush(CitrusClientLobby *lobby)
+{
+	uint8_t *data;
+	int n = CitrusInputEncoder_finish(&lobby->input_encoder, &data);
+	if (n > 0) {
+		lobby->send(lobby->send_data, n, data);
+	}
+}
+
+void CitrusClientLobby_checksum(CitrusClientLobby *lobby, int tick,
+				uint32_t checksum)
+{
+	CitrusClientLobby_flush(lobby);
+	uint8_t data[CITRUS_FRAME_HEADER_SIZE * 5];
+	uint64_t values[2] = { tick, checksum };
+	int n = Citrus_write_event(data, CITRUS_EVENT_CHECKSUM, 0, values, 2);
+	lobby->send(lobby->send_data, n, data);
+}
+
+void CitrusClientLobby_spectate(CitrusClientLobby *lobby, int id,
+				uint8_t *frame, int width, int height)
+{
+	lobby->spectate_id = id;
+	lobby->spectate_frame = frame;
+	lobby->spectate_width = width;
+	lobby->spectate_height = height;
+	uint8_t data[CITRUS_FRAME_HEADER_SIZE * 4];
+	uint64_t target = id + 1;
+	int n = Citrus_write_event(data, CITRUS_EVENT_SPECTATE, 0, &target, 1);
+	lobby->send(lobby->send_data, n, data);
 }
 
-void CitrusServerLobby_init(CitrusServerLobby *lobby,
+bool CitrusServerLobby_init(CitrusServerLobby *lobby, CitrusLobbySlot *slots,
+			    int *active_slots, CitrusIdEntry *connections,
+			    int connections_size, CitrusParser *parsers,
+			    uint8_t *parser_buffers, int parser_buffer_size,
+			    uint8_t *output_buffers, int output_buffer_size,
+			    int capacity,
 			    void (*send)(void *send_data, int n, uint8_t *data,
 					 int id), void *send_data)
 {
-	CitrusLobby_init(&lobby->lobby);
+	// the table always needs an empty entry for lookups to stop at
+	if (connections_size <= capacity
+	    || !CitrusIdTable_init(&lobby->connections, connections,
+				   connections_size)) {
+		return false;
+	}
+	CitrusLobby_init(&lobby->lobby, slots, active_slots, capacity);
+	lobby->parsers = parsers;
+	lobby->parser_buffers = parser_buffers;
+	lobby->parser_buffer_size = parser_buffer_size;
+	lobby->output_buffers = output_buffers;
+	lobby->output_buffer_size = output_buffer_size;
+	lobby->spectator_frames = NULL;
+	lobby->spectator_frame_size = 0;
+	lobby->board_buffer = NULL;
+	lobby->board_buffer_size = 0;
+	lobby->keyframe_interval = 0;
+	lobby->tick = 0;
+	lobby->lobby.max_input_tick = CITRUS_MAX_INPUT_LEAD;
 	lobby->send = send;
 	lobby->send_data = send_data;
+	return true;
 }
 
-void CitrusServerLobby_client_connect(CitrusServerLobby *lobby, int id)
+CitrusLobbySlot *CitrusServerLobby_get_slot(CitrusServerLobby *lobby, int id)
 {
-	CitrusEvent event;
-	event.type = CITRUS_EVENT_CONNECT;
-	event.client_id = id;
+	int index = CitrusIdTable_get(&lobby->connections, id);
+	return index == -1 ? NULL : &lobby->lobby.slots[index];
+}
+
+void CitrusServerLobby_start_game(CitrusServerLobby *lobby, int id)
+{
+	int index = CitrusIdTable_get(&lobby->connections, id);
+	if (index == -1) {
+		return;
+	}
+	CitrusLobbySlot *slot = &lobby->lobby.slots[index];
+	// the game keeps the lobby's tracer instead of being given it on
+	// every tick and input
+	CitrusGame_set_tracer(&slot->game, lobby->lobby.tracer, index);
+	slot->in_game = true;
+	slot->game_tick = 0;
+	slot->n_pending = 0;
+	slot->applied_tick = slot->input_tick;
+}
+
+void CitrusServerLobby_init_spectators(CitrusServerLobby *lobby,
+				       uint8_t *frames, int frame_size,
+				       uint8_t *board_buffer,
+				       int board_buffer_size,
+				       int keyframe_interval)
+{
+	lobby->spectator_frames = frames;
+	lobby->spectator_frame_size = frame_size;
+	lobby->board_buffer = board_buffer;
+	lobby->board_buffer_size = board_buffer_size;
+	lobby->keyframe_interval = keyframe_interval;
+}
+
+void CitrusServerLobby_set_validator(CitrusServerLobby *lobby, int id,
+				     CitrusValidator *validator)
+{
+	CitrusLobbySlot *slot = CitrusServerLobby_get_slot(lobby, id);
+	if (slot != NULL) {
+		slot->validator = validator;
+		slot->checksum_pending = false;
+	}
+}
+
+// send everything queued for the client in a slot
+void CitrusServerLobby_flush_slot(CitrusServerLobby *lobby, int index)
+{
+	CitrusLobbySlot *slot = &lobby->lobby.slots[index];
+	if (slot->output_length > 0) {
+		CitrusTracer_record(lobby->lobby.tracer, CITRUS_TRACE_SEND,
+				    CITRUS_TRACE_BEGIN, index,
+				    slot->output_length);
+		lobby->send(lobby->send_data, slot->output_length,
+			    lobby->output_buffers +
+			    index * lobby->output_buffer_size,
+			    slot->connection_id);
+		CitrusTracer_record(lobby->lobby.tracer, CITRUS_TRACE_SEND,
+				    CITRUS_TRACE_END, index, 0);
+		slot->output_length = 0;
+	}
+}
+
+// queue data for the client in a slot
+void CitrusServerLobby_queue(CitrusServerLobby *lobby, int index, int n,
+			     uint8_t *data)
+{
+	CitrusLobbySlot *slot = &lobby->lobby.slots[index];
+	if (slot->output_length + n > lobby->output_buffer_size) {
+		CitrusServerLobby_flush_slot(lobby, index);
+	}
+	if (n > lobby->output_buffer_size) {
+		CitrusTracer_record(lobby->lobby.tracer, CITRUS_TRACE_SEND,
+				    CITRUS_TRACE_BEGIN, index, n);
+		lobby->send(lobby->send_data, n, data, slot->connection_id);
+		CitrusTracer_record(lobby->lobby.tracer, CITRUS_TRACE_SEND,
+				    CITRUS_TRACE_END, index, 0);
+		return;
+	}
+	uint8_t *buffer =
+	    lobby->output_buffers + index * lobby->output_buffer_size;
+	for (int i = 0; i < n; i++) {
+		buffer[slot->output_length + i] = data[i];
+	}
+	slot->output_length += n;
+}
+
+void CitrusServerLobby_flush(CitrusServerLobby *lobby, int id)
+{
+	int index = CitrusIdTable_get(&lobby->connections, id);
+	if (index != -1) {
+		CitrusServerLobby_flush_slot(lobby, index);
+	}
+}
+
+void CitrusServerLobby_send(CitrusServerLobby *lobby, int id, int n,
+			    uint8_t *data)
+{
+	int index = CitrusIdTable_get(&lobby->connections, id);
+	if (index != -1) {
+		CitrusServerLobby_queue(lobby, index, n, data);
+	}
+}
+
+// encode a client's board once and queue it for all of its spectators
+void CitrusServerLobby_send_board(CitrusServerLobby *lobby, int index)
+{
+	CitrusLobbySlot *slot = &lobby->lobby.slots[index];
+	CitrusGame *game = &slot->game;
+	if (game->config->width * game->config->full_height >
+	    lobby->spectator_frame_size) {
+		return;
+	}
+	uint8_t *buffer = lobby->board_buffer;
+	int capacity = lobby->board_buffer_size;
+	// keyframes are staggered between games to spread out the cost
+	bool keyframe = slot->keyframe_needed;
+	if (lobby->keyframe_interval > 0
+	    && (lobby->tick + index) % lobby->keyframe_interval == 0) {
+		keyframe = true;
+	}
+	int length = CITRUS_FRAME_HEADER_SIZE;
+	if (capacity - length < CITRUS_FRAME_HEADER_SIZE * 3) {
+		return;
+	}
+	buffer[length++] = CITRUS_EVENT_BOARD;
+	length += Citrus_write_varint(buffer + length, index);
+	length += Citrus_write_varint(buffer + length, lobby->tick);
+	length += Citrus_write_varint(buffer + length, keyframe);
+	int n = Citrus_write_board_diff(buffer + length, capacity - length,
+					game, lobby->spectator_frames +
+					index * lobby->spectator_frame_size,
+					game->dirty_rows, keyframe);
+	if (n < 0) {
+		// the frame may be partially updated, so resend everything
+		slot->keyframe_needed = true;
+		return;
+	}
+	slot->keyframe_needed = false;
+	if (n == 0 && !keyframe) {
+		return;
+	}
+	uint8_t *data;
+	int size = Citrus_finish_frame(buffer,
+				       length + n - CITRUS_FRAME_HEADER_SIZE,
+				       &data);
+	for (int spectator = slot->first_spectator; spectator != -1;
+	     spectator = lobby->lobby.slots[spectator].next_spectator) {
+		CitrusServerLobby_queue(lobby, spectator, size, data);
+	}
+}
+
+void CitrusServerLobby_tick(CitrusServerLobby *lobby)
+{
+	CitrusTracer *tracer = lobby->lobby.tracer;
+	CitrusTracer_record(tracer, CITRUS_TRACE_TICK, CITRUS_TRACE_BEGIN, -1,
+			    0);
+	CitrusLobby_sort_active(&lobby->lobby);
+	int n_active_slots = lobby->lobby.n_active_slots;
+	for (int i = 0; i < n_active_slots; i++) {
+		int index = lobby->lobby.active_slots[i];
+		CitrusLobbySlot *slot = &lobby->lobby.slots[index];
+		if (slot->in_game) {
+			while (slot->n_pending > 0
+			       && slot->pending[slot->pending_start].tick <=
+			       slot->game_tick) {
+				CitrusLobby_apply_pending(slot);
+			}
+			CitrusGame_tick(&slot->game);
+			slot->game_tick++;
+		}
+		if (slot->acked_tick != slot->applied_tick) {
+			uint8_t data[CITRUS_FRAME_HEADER_SIZE * 4];
+			uint64_t tick = slot->applied_tick;
+			int n = Citrus_write_event(data, CITRUS_EVENT_ACK,
+						   index, &tick, 1);
+			CitrusServerLobby_queue(lobby, index, n, data);
+			slot->acked_tick = slot->applied_tick;
+		}
+	}
+	if (lobby->spectator_frames != NULL) {
+		for (int i = 0; i < n_active_slots; i++) {
+			int index = lobby->lobby.active_slots[i];
+			CitrusLobbySlot *slot = &lobby->lobby.slots[index];
+			if (slot->in_game && slot->first_spectator != -1) {
+				CitrusServerLobby_send_board(lobby, index);
+			}
+			// new spectators start with a keyframe, so rows
+			// changed while unwatched don't need to be kept
+			if (slot->in_game) {
+				CitrusGame_clear_dirty_rows(&slot->game);
+			}
+		}
+	}
+	// flush once every game has been updated so that all data sent to a
+	// client during the tick is coalesced into one send call
+	for (int i = 0; i < n_active_slots; i++) {
+		CitrusServerLobby_flush_slot(lobby,
+					     lobby->lobby.active_slots[i]);
+	}
+	lobby->tick++;
+	lobby->lobby.max_input_tick = lobby->tick + CITRUS_MAX_INPUT_LEAD;
+	CitrusTracer_record(tracer, CITRUS_TRACE_TICK, CITRUS_TRACE_END, -1,
+			    n_active_slots);
+}
+
+void CitrusServerLobby_set_tracer(CitrusServerLobby *lobby,
+				  CitrusTracer *tracer)
+{
+	lobby->lobby.tracer = tracer;
+	for (int i = 0; i < lobby->lobby.capacity; i++) {
+		CitrusLobbySlot *slot = &lobby->lobby.slots[i];
+		if (slot->in_game) {
+			CitrusGame_set_tracer(&slot->game, tracer, i);
+		}
+	}
+}
+
+bool CitrusServerLobby_client_connect(CitrusServerLobby *lobby, int id)
+{
+	if (lobby->lobby.n_active_slots == lobby->lobby.capacity) {
+		return false;
+	}
+	// the first slot after the connected slots is always free
+	int index = lobby->lobby.active_slots[lobby->lobby.n_active_slots];
+	if (!CitrusIdTable_insert(&lobby->connections, id, index)) {
+		return false;
+	}
+	CitrusParser_init(&lobby->parsers[index],
+			  lobby->parser_buffers +
+			  index * lobby->parser_buffer_size,
+			  lobby->parser_buffer_size);
+	CitrusEvent event = {.type = CITRUS_EVENT_CONNECT,.client_id = index };
 	CitrusLobby_event(&lobby->lobby, event);
+	lobby->lobby.slots[index].connection_id = id;
+	return true;
 }
 
 void CitrusServerLobby_client_disconnect(CitrusServerLobby *lobby, int id)
 {
-	CitrusEvent event;
-	event.type = CITRUS_EVENT_DISCONNECT;
-	event.client_id = id;
+	int index = CitrusIdTable_get(&lobby->connections, id);
+	if (index == -1) {
+		return;
+	}
+	CitrusIdTable_remove(&lobby->connections, id);
+	CitrusEvent event = {.type = CITRUS_EVENT_DISCONNECT };
+	event.client_id = index;
 	CitrusLobby_event(&lobby->lobby, event);
 }
 
-void CitrusServerLobby_recv(CitrusServerLobby *lobby, int n, uint8_t *data,
+bool CitrusServerLobby_recv(CitrusServerLobby *lobby, int n, uint8_t *data,
 			    int id)
 {
-	if (lobby->lobby.connected_clients[id]) {
-		CitrusParser_send(&lobby->parsers[id], n, data);
-		CitrusEvent event;
-		while (CitrusParser_get_event(&lobby->parsers[id], &event)) {
-			CitrusLobby_event(&lobby->lobby, event);
+	int index = CitrusIdTable_get(&lobby->connections, id);
+	if (index == -1) {
+		return true;
+	}
+	CitrusTracer *tracer = lobby->lobby.tracer;
+	CitrusTracer_record(tracer, CITRUS_TRACE_RECV, CITRUS_TRACE_BEGIN, index,
+			    n);
+	CitrusParser *parser = &lobby->parsers[index];
+	CitrusParser_feed(parser, n, data);
+	CitrusEvent event;
+	CitrusParserStatus status;
+	while (true) {
+		CitrusTracer_record(tracer, CITRUS_TRACE_PARSE,
+				    CITRUS_TRACE_BEGIN, index, 0);
+		status = CitrusLobby_next_event(parser, &event);
+		CitrusTracer_record(tracer, CITRUS_TRACE_PARSE,
+				    CITRUS_TRACE_END, index, 0);
+		if (status != CITRUS_PARSER_FRAME) {
+			break;
+		}
+		// clients can only send events on their own behalf
+		event.client_id = index;
+		CitrusLobby_event(&lobby->lobby, event);
+		if (!lobby->lobby.slots[index].connected) {
+			// the rest of the data is ignored once disconnected,
+			// and the lobby only disconnects clients that misbehave
+			CitrusIdTable_remove(&lobby->connections, id);
+			status = event.type == CITRUS_EVENT_DISCONNECT ?
+			    CITRUS_PARSER_EMPTY : CITRUS_PARSER_INVALID;
+			break;
 		}
 	}
+	CitrusTracer_record(tracer, CITRUS_TRACE_RECV, CITRUS_TRACE_END, index,
+			    0);
+	return status == CITRUS_PARSER_EMPTY;
 }
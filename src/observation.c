@@ -0,0 +1,184 @@
+/* Copyright (C) 2026 RZ781
+ *
+ * This file is part of libcitrus.
+ *
+ * libcitrus is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 2.1 of the License, or (at your option)
+ * any later version.
+ *
+ * libcitrus is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "citrus.h"
+
+// work out the offsets of each part of an observation
+void CitrusObservationLayout_init(CitrusObservationLayout *layout, int width,
+				  int full_height, int n_next)
+{
+	int n_cells = width * full_height;
+	layout->width = width;
+	layout->full_height = full_height;
+	layout->n_next = n_next;
+	layout->board = 0;
+	layout->piece = n_cells;
+	layout->current = 2 * n_cells;
+	layout->hold = layout->current + 7;
+	layout->queue = layout->hold + 8;
+	layout->scalars = layout->queue + 7 * n_next;
+	layout->size = layout->scalars + CITRUS_OBSERVATION_N_SCALARS;
+}
+
+// clamp a scalar to fit in a byte
+uint8_t Citrus_observation_scalar(int value)
+{
+	return value < 0 ? 0 : value > 255 ? 255 : value;
+}
+
+// write an observation of a game
+void CitrusGame_observe(CitrusGame *game,
+			const CitrusObservationLayout *layout,
+			uint8_t *observation)
+{
+	int n_cells = layout->width * layout->full_height;
+	uint8_t *board = observation + layout->board;
+	uint8_t *piece = observation + layout->piece;
+	for (int i = 0; i < n_cells; i++) {
+		board[i] = game->board[i].type == CITRUS_CELL_FULL;
+		piece[i] = 0;
+	}
+	// the current piece is drawn on the board, so move it to its plane
+	const CitrusPiece *current = game->current_piece;
+	if (game->alive && game->line_clear_delay == 0) {
+		int size = current->width * current->height;
+		for (int dy = 0; dy < current->height; dy++) {
+			for (int dx = 0; dx < current->width; dx++) {
+				int j = game->rotation * size +
+				    dy * current->width + dx;
+				if (current->piece_data[j].type !=
+				    CITRUS_CELL_FULL) {
+					continue;
+				}
+				int x = game->position.x + dx;
+				int y = game->position.y + dy;
+				if (x < 0 || x >= layout->width || y < 0
+				    || y >= layout->full_height) {
+					continue;
+				}
+				board[y * layout->width + x] = 0;
+				piece[y * layout->width + x] = 1;
+			}
+		}
+	}
+	uint8_t *one_hot = observation + layout->current;
+	for (int i = layout->current; i < layout->scalars; i++) {
+		observation[i] = 0;
+	}
+	uint32_t index = Citrus_piece_index(current);
+	if (index < 7) {
+		one_hot[index] = 1;
+	}
+	one_hot = observation + layout->hold;
+	one_hot[game->hold_piece == NULL ? 7 :
+		Citrus_piece_index(game->hold_piece) % 8] = 1;
+	for (int i = 0; i < layout->n_next; i++) {
+		one_hot = observation + layout->queue + 7 * i;
+		index = Citrus_piece_index(game->next_piece_queue[i]);
+		if (index < 7) {
+			one_hot[index] = 1;
+		}
+	}
+	uint8_t *scalars = observation + layout->scalars;
+	scalars[CITRUS_OBSERVATION_ALIVE] = game->alive;
+	scalars[CITRUS_OBSERVATION_HELD] = game->held;
+	scalars[CITRUS_OBSERVATION_B2B] = game->b2b;
+	scalars[CITRUS_OBSERVATION_COMBO] =
+	    Citrus_observation_scalar(game->combo);
+	scalars[CITRUS_OBSERVATION_LEVEL] =
+	    Citrus_observation_scalar(game->level);
+	scalars[CITRUS_OBSERVATION_LOCK_DELAY] =
+	    Citrus_observation_scalar(game->lock_delay);
+	scalars[CITRUS_OBSERVATION_MOVE_RESETS] =
+	    Citrus_observation_scalar(game->move_reset_count);
+	scalars[CITRUS_OBSERVATION_LINE_CLEAR_DELAY] =
+	    Citrus_observation_scalar(game->line_clear_delay);
+}
+
+// write observations of a batch of games one after another
+void Citrus_observe_batch(CitrusGame *const *games, int n,
+			  const CitrusObservationLayout *layout,
+			  uint8_t *tensor)
+{
+	for (int i = 0; i < n; i++) {
+		CitrusGame_observe(games[i], layout, tensor + i * layout->size);
+	}
+}
+
+// initialise a record writer, buffering the stream header, returning false
+// if the buffer can't hold the header and a record
+bool CitrusRecordWriter_init(CitrusRecordWriter *writer,
+			     const CitrusObservationLayout *layout,
+			     uint8_t *buffer, int capacity,
+			     bool (*write)(void *data, const uint8_t *bytes,
+					   int n), void *data)
+{
+	if (capacity < CITRUS_RECORD_HEADER_SIZE + layout->size + 8) {
+		return false;
+	}
+	writer->layout = layout;
+	writer->buffer = buffer;
+	writer->capacity = capacity;
+	writer->write = write;
+	writer->data = data;
+	const char *magic = "CTRC";
+	for (int i = 0; i < 4; i++) {
+		buffer[i] = magic[i];
+	}
+	Citrus_write_le(buffer + 4, 1, 2);
+	Citrus_write_le(buffer + 6, layout->width, 2);
+	Citrus_write_le(buffer + 8, layout->full_height, 2);
+	Citrus_write_le(buffer + 10, layout->n_next, 2);
+	Citrus_write_le(buffer + 12, layout->size + 8, 4);
+	writer->length = CITRUS_RECORD_HEADER_SIZE;
+	return true;
+}
+
+// write out every buffered record
+bool CitrusRecordWriter_flush(CitrusRecordWriter *writer)
+{
+	if (writer->length == 0) {
+		return true;
+	}
+	if (!writer->write(writer->data, writer->buffer, writer->length)) {
+		return false;
+	}
+	writer->length = 0;
+	return true;
+}
+
+// add a record, flushing first if the buffer is full
+bool CitrusRecordWriter_add(CitrusRecordWriter *writer, CitrusGame *game,
+			    int32_t action, int32_t reward)
+{
+	int size = writer->layout->size + 8;
+	if (writer->length + size > writer->capacity
+	    && !CitrusRecordWriter_flush(writer)) {
+		return false;
+	}
+	uint8_t *record = writer->buffer + writer->length;
+	CitrusGame_observe(game, writer->layout, record);
+	Citrus_write_le(record + writer->layout->size, (uint32_t) action, 4);
+	Citrus_write_le(record + writer->layout->size + 4, (uint32_t) reward,
+			4);
+	writer->length += size;
+	return true;
+}
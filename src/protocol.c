@@ -0,0 +1,405 @@
+/* Copyright (C) 2026 RZ781
+ *
+ * This file is part of libcitrus.
+ *
+ * libcitrus is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 2.1 of the License, or (at your option)
+ * any later version.
+ *
+ * libcitrus is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include "citrus.h"
+
+// write a varint, 7 bits per byte with the top bit marking continuation
+int Citrus_write_varint(uint8_t *data, uint64_t value)
+{
+	int n = 0;
+	while (value >= 0x80) {
+		data[n++] = (value & 0x7f) | 0x80;
+		value >>= 7;
+	}
+	data[n++] = value;
+	return n;
+}
+
+// read a varint, returning 0 if incomplete and -1 if too long
+int Citrus_read_varint(const uint8_t *data, int n, uint64_t *value)
+{
+	uint64_t result = 0;
+	for (int i = 0; i < n && i < CITRUS_FRAME_HEADER_SIZE; i++) {
+		result |= (uint64_t) (data[i] & 0x7f) << (7 * i);
+		if (!(data[i] & 0x80)) {
+			*value = result;
+			return i + 1;
+		}
+	}
+	return n >= CITRUS_FRAME_HEADER_SIZE ? -1 : 0;
+}
+
+// write a fixed size little endian integer
+void Citrus_write_le(uint8_t *data, uint64_t value, int n)
+{
+	for (int i = 0; i < n; i++) {
+		data[i] = value >> 8 * i;
+	}
+}
+
+// read a fixed size little endian integer
+uint64_t Citrus_read_le(const uint8_t *data, int n)
+{
+	uint64_t value = 0;
+	for (int i = 0; i < n; i++) {
+		value |= (uint64_t) data[i] << 8 * i;
+	}
+	return value;
+}
+
+// initialise a parser with a staging buffer for split frames
+void CitrusParser_init(CitrusParser *parser, uint8_t *buffer, int capacity)
+{
+	parser->buffer = buffer;
+	parser->capacity = capacity;
+	parser->length = 0;
+	parser->frame_length = 0;
+	parser->input = NULL;
+	parser->input_length = 0;
+}
+
+// give the parser data to decode, this isn't copied unless a frame is split
+void CitrusParser_feed(CitrusParser *parser, int n, const uint8_t *data)
+{
+	parser->input = data;
+	parser->input_length = n;
+}
+
+// move n bytes of input into the staging buffer
+void CitrusParser_stage(CitrusParser *parser, int n)
+{
+	for (int i = 0; i < n; i++) {
+		parser->buffer[parser->length + i] = parser->input[i];
+	}
+	parser->length += n;
+	parser->input += n;
+	parser->input_length -= n;
+}
+
+// continue assembling a frame in the staging buffer
+CitrusParserStatus CitrusParser_next_staged(CitrusParser *parser,
+					    CitrusFrame *frame)
+{
+	// the header was split, so copy it byte by byte until it's complete
+	while (parser->frame_length == 0) {
+		if (parser->input_length == 0) {
+			return CITRUS_PARSER_EMPTY;
+		}
+		CitrusParser_stage(parser, 1);
+		uint64_t payload_length;
+		int header_length = Citrus_read_varint(parser->buffer,
+						       parser->length,
+						       &payload_length);
+		if (header_length < 0) {
+			return CITRUS_PARSER_INVALID;
+		}
+		if (header_length > 0) {
+			if (payload_length >
+			    (uint64_t) (parser->capacity - header_length)) {
+				return CITRUS_PARSER_OVERFLOW;
+			}
+			parser->frame_length = header_length + payload_length;
+		}
+	}
+	int needed = parser->frame_length - parser->length;
+	if (needed > parser->input_length) {
+		needed = parser->input_length;
+	}
+	CitrusParser_stage(parser, needed);
+	if (parser->length < parser->frame_length) {
+		return CITRUS_PARSER_EMPTY;
+	}
+	uint64_t payload_length;
+	int header_length = Citrus_read_varint(parser->buffer, parser->length,
+					       &payload_length);
+	frame->data = parser->buffer + header_length;
+	frame->length = payload_length;
+	parser->length = 0;
+	parser->frame_length = 0;
+	return CITRUS_PARSER_FRAME;
+}
+
+// decode the next frame, in place if possible
+CitrusParserStatus CitrusParser_next(CitrusParser *parser, CitrusFrame *frame)
+{
+	if (parser->length > 0) {
+		return CitrusParser_next_staged(parser, frame);
+	}
+	if (parser->input_length == 0) {
+		return CITRUS_PARSER_EMPTY;
+	}
+	uint64_t payload_length;
+	int header_length = Citrus_read_varint(parser->input,
+					       parser->input_length,
+					       &payload_length);
+	if (header_length < 0) {
+		return CITRUS_PARSER_INVALID;
+	}
+	if (header_length == 0) {
+		// header is split, which always fits in the buffer
+		CitrusParser_stage(parser, parser->input_length);
+		return CITRUS_PARSER_EMPTY;
+	}
+	int available = parser->input_length - header_length;
+	if (payload_length <= (uint64_t) available) {
+		frame->data = parser->input + header_length;
+		frame->length = payload_length;
+		parser->input += header_length + payload_length;
+		parser->input_length -= header_length + payload_length;
+		return CITRUS_PARSER_FRAME;
+	}
+	if (payload_length > (uint64_t) (parser->capacity - header_length)) {
+		return CITRUS_PARSER_OVERFLOW;
+	}
+	parser->frame_length = header_length + payload_length;
+	CitrusParser_stage(parser, parser->input_length);
+	return CITRUS_PARSER_EMPTY;
+}
+
+// largest encoding of a single tick in an input batch
+#define CITRUS_INPUT_ENTRY_SIZE 8
+
+// initialise an encoder for batching inputs into frames
+void CitrusInputEncoder_init(CitrusInputEncoder *encoder, uint8_t *buffer,
+			     int capacity, int client_id)
+{
+	encoder->buffer = buffer;
+	encoder->capacity = capacity;
+	encoder->length = 0;
+	encoder->client_id = client_id;
+	encoder->tick = 0;
+}
+
+// add a tick's key transitions to the batch, return false if it's full
+bool CitrusInputEncoder_add(CitrusInputEncoder *encoder, int tick,
+			    unsigned down, unsigned up)
+{
+	if (encoder->length == 0) {
+		// leave space before the payload for the frame header
+		encoder->length = CITRUS_FRAME_HEADER_SIZE;
+		encoder->buffer[encoder->length++] = CITRUS_EVENT_INPUT;
+		encoder->length +=
+		    Citrus_write_varint(encoder->buffer + encoder->length,
+					encoder->client_id);
+	}
+	if (encoder->capacity - encoder->length < CITRUS_INPUT_ENTRY_SIZE) {
+		return false;
+	}
+	int delta = tick - encoder->tick;
+	if (delta < 0) {
+		delta = 0;
+	}
+	uint8_t *data = encoder->buffer + encoder->length;
+	int n = Citrus_write_varint(data, delta);
+	n += Citrus_write_varint(data + n, (down & 0xff) | (up & 0xff) << 8);
+	encoder->length += n;
+	encoder->tick += delta;
+	return true;
+}
+
+// write a frame header in front of a payload that follows reserved space
+int Citrus_finish_frame(uint8_t *buffer, int length, uint8_t **frame)
+{
+	uint8_t header[CITRUS_FRAME_HEADER_SIZE];
+	int header_length = Citrus_write_varint(header, length);
+	int start = CITRUS_FRAME_HEADER_SIZE - header_length;
+	for (int i = 0; i < header_length; i++) {
+		buffer[start + i] = header[i];
+	}
+	*frame = buffer + start;
+	return header_length + length;
+}
+
+// finish the batch and return the frame
+int CitrusInputEncoder_finish(CitrusInputEncoder *encoder, uint8_t **data)
+{
+	if (encoder->length == 0) {
+		return 0;
+	}
+	int n = Citrus_finish_frame(encoder->buffer, encoder->length -
+				    CITRUS_FRAME_HEADER_SIZE, data);
+	encoder->length = 0;
+	return n;
+}
+
+// encode an event made up of varints
+int Citrus_write_event(uint8_t *data, CitrusEventType type, int client_id,
+		       const uint64_t *values, int n)
+{
+	// write the payload after space for the largest header, then move it
+	// next to the actual header
+	uint8_t *payload = data + CITRUS_FRAME_HEADER_SIZE;
+	int length = 0;
+	payload[length++] = type;
+	length += Citrus_write_varint(payload + length, client_id);
+	for (int i = 0; i < n; i++) {
+		length += Citrus_write_varint(payload + length, values[i]);
+	}
+	int header_length = Citrus_write_varint(data, length);
+	for (int i = 0; i < length; i++) {
+		data[header_length + i] = payload[i];
+	}
+	return header_length + length;
+}
+
+// value of a cell in a spectator frame, 0 if empty or the color plus one
+uint8_t Citrus_frame_cell(CitrusCell cell)
+{
+	return cell.type == CITRUS_CELL_FULL ? cell.color + 1 : 0;
+}
+
+// encode the rows of a game's board which differ from the previous frame
+int Citrus_write_board_diff(uint8_t *data, int capacity, CitrusGame *game,
+			    uint8_t *previous, uint64_t rows, bool keyframe)
+{
+	int width = game->config->width;
+	int length = 0;
+	int last_y = -1;
+	for (int y = 0; y < game->config->full_height; y++) {
+		if (!keyframe && !Citrus_row_dirty(rows, y)) {
+			continue;
+		}
+		const CitrusCell *row = game->board + y * width;
+		uint8_t *previous_row = previous + y * width;
+		bool changed = false;
+		bool empty = true;
+		for (int x = 0; x < width; x++) {
+			uint8_t cell = Citrus_frame_cell(row[x]);
+			// keyframes are applied to an empty board
+			uint8_t old = keyframe ? 0 : previous_row[x];
+			changed |= cell != old;
+			empty &= cell == 0;
+		}
+		if (!changed) {
+			if (keyframe && empty) {
+				for (int x = 0; x < width; x++) {
+					previous_row[x] = 0;
+				}
+			}
+			continue;
+		}
+		// row skip, one mask per 64 columns and up to one run per cell
+		int worst_case = (2 + width / 64 + width) *
+		    CITRUS_FRAME_HEADER_SIZE;
+		if (capacity - length < worst_case) {
+			return -1;
+		}
+		length += Citrus_write_varint(data + length, y - last_y - 1);
+		last_y = y;
+		for (int start = 0; start < width; start += 64) {
+			uint64_t mask = 0;
+			for (int x = start; x < width && x < start + 64; x++) {
+				uint8_t old = keyframe ? 0 : previous_row[x];
+				bool full = row[x].type == CITRUS_CELL_FULL;
+				if (full != (old != 0)) {
+					mask |= (uint64_t) 1 << (x - start);
+				}
+			}
+			length += Citrus_write_varint(data + length, mask);
+		}
+		// colors of the filled cells as runs of the same color
+		int run = 0;
+		uint8_t run_cell = 0;
+		for (int x = 0; x < width; x++) {
+			uint8_t cell = Citrus_frame_cell(row[x]);
+			previous_row[x] = cell;
+			if (cell == 0) {
+				continue;
+			}
+			if (run > 0 && cell != run_cell) {
+				length += Citrus_write_varint(data + length,
+							      run << 3 |
+							      (run_cell - 1));
+				run = 0;
+			}
+			run_cell = cell;
+			run++;
+		}
+		if (run > 0) {
+			length += Citrus_write_varint(data + length,
+						      run << 3 | (run_cell - 1));
+		}
+	}
+	return length;
+}
+
+// apply rows encoded by Citrus_write_board_diff to a frame
+bool Citrus_read_board_diff(uint8_t *frame, int width, int height,
+			    const uint8_t *data, int length, bool keyframe)
+{
+	if (keyframe) {
+		for (int i = 0; i < width * height; i++) {
+			frame[i] = 0;
+		}
+	}
+	int y = -1;
+	while (length > 0) {
+		uint64_t skip;
+		int n = Citrus_read_varint(data, length, &skip);
+		if (n <= 0 || skip >= (uint64_t) (height - y - 1)) {
+			return false;
+		}
+		data += n;
+		length -= n;
+		y += skip + 1;
+		uint8_t *row = frame + y * width;
+		for (int start = 0; start < width; start += 64) {
+			uint64_t mask;
+			n = Citrus_read_varint(data, length, &mask);
+			if (n <= 0) {
+				return false;
+			}
+			data += n;
+			length -= n;
+			for (int x = start; x < width && x < start + 64; x++) {
+				if (mask >> (x - start) & 1) {
+					// mark toggled cells, the color is
+					// filled in by the runs below
+					row[x] = row[x] ? 0 : 1;
+				}
+			}
+		}
+		int x = 0;
+		while (x < width) {
+			if (row[x] == 0) {
+				x++;
+				continue;
+			}
+			uint64_t run;
+			n = Citrus_read_varint(data, length, &run);
+			if (n <= 0) {
+				return false;
+			}
+			data += n;
+			length -= n;
+			uint8_t cell = (run & 7) + 1;
+			for (run >>= 3; run > 0; run--) {
+				while (x < width && row[x] == 0) {
+					x++;
+				}
+				if (x == width) {
+					return false;
+				}
+				row[x++] = cell;
+			}
+		}
+	}
+	return true;
+}
@@ -0,0 +1,232 @@
+/* Copyright (C) 2026 RZ781
+ *
+ * This file is part of libcitrus.
+ *
+ * libcitrus is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 2.1 of the License, or (at your option)
+ * any later version.
+ *
+ * libcitrus is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "citrus.h"
+
+// marks a cell whose contents on the terminal are unknown
+#define CITRUS_RENDER_UNKNOWN 0xff
+// frame value of the first shadow cell
+#define CITRUS_RENDER_SHADOW 8
+
+// 256 color palette entries for each piece color
+const uint8_t CITRUS_RENDER_COLORS[7] = { 51, 21, 208, 226, 46, 129, 196 };
+
+// initialise a renderer
+void CitrusRenderer_init(CitrusRenderer *renderer, uint8_t *frames, int width,
+			 int height, int row, int column)
+{
+	renderer->previous = frames;
+	renderer->current = frames + width * height;
+	renderer->width = width;
+	renderer->height = height;
+	renderer->row = row;
+	renderer->column = column;
+	CitrusRenderer_invalidate(renderer);
+}
+
+// forget what is on the terminal so everything is redrawn
+void CitrusRenderer_invalidate(CitrusRenderer *renderer)
+{
+	for (int i = 0; i < renderer->width * renderer->height; i++) {
+		renderer->previous[i] = CITRUS_RENDER_UNKNOWN;
+	}
+	renderer->redraw = true;
+}
+
+// append bytes to the output, return false if they don't fit
+bool CitrusRenderer_write(uint8_t *buffer, int capacity, int *length,
+			  const char *data, int n)
+{
+	if (*length + n > capacity) {
+		return false;
+	}
+	for (int i = 0; i < n; i++) {
+		buffer[*length + i] = data[i];
+	}
+	*length += n;
+	return true;
+}
+
+// write a positive integer in decimal, return the number of characters
+int CitrusRenderer_format_int(char *data, int value)
+{
+	char digits[10];
+	int n = 0;
+	do {
+		digits[n++] = '0' + value % 10;
+		value /= 10;
+	} while (value > 0);
+	for (int i = 0; i < n; i++) {
+		data[i] = digits[n - 1 - i];
+	}
+	return n;
+}
+
+// move the cursor, return false if the output is full
+bool CitrusRenderer_move(CitrusRenderer *renderer, int row, int column,
+			 uint8_t *buffer, int capacity, int *length)
+{
+	if (renderer->cursor_row == row && renderer->cursor_column == column) {
+		return true;
+	}
+	char data[24];
+	int n = 0;
+	data[n++] = '\033';
+	data[n++] = '[';
+	n += CitrusRenderer_format_int(data + n, row);
+	data[n++] = ';';
+	n += CitrusRenderer_format_int(data + n, column);
+	data[n++] = 'H';
+	renderer->cursor_row = row;
+	renderer->cursor_column = column;
+	return CitrusRenderer_write(buffer, capacity, length, data, n);
+}
+
+// draw one cell at the cursor, return false if the output is full
+bool CitrusRenderer_cell(CitrusRenderer *renderer, uint8_t cell,
+			 uint8_t *buffer, int capacity, int *length)
+{
+	char data[24];
+	int n = 0;
+	if (cell != renderer->style) {
+		// empty cells only need the colors reset
+		data[n++] = '\033';
+		data[n++] = '[';
+		data[n++] = '0';
+		if (cell != 0) {
+			bool shadow = cell >= CITRUS_RENDER_SHADOW;
+			int color = shadow ? cell - CITRUS_RENDER_SHADOW :
+			    cell - 1;
+			data[n++] = ';';
+			data[n++] = shadow ? '3' : '4';
+			data[n++] = '8';
+			data[n++] = ';';
+			data[n++] = '5';
+			data[n++] = ';';
+			n += CitrusRenderer_format_int(data + n,
+						       CITRUS_RENDER_COLORS
+						       [color % 7]);
+		}
+		data[n++] = 'm';
+		renderer->style = cell;
+	}
+	bool shadow = cell >= CITRUS_RENDER_SHADOW;
+	data[n++] = shadow ? '[' : ' ';
+	data[n++] = shadow ? ']' : ' ';
+	renderer->cursor_column += 2;
+	return CitrusRenderer_write(buffer, capacity, length, data, n);
+}
+
+// write escape codes for the changed cells in a mask of rows
+int CitrusRenderer_draw_rows(CitrusRenderer *renderer, const uint8_t *frame,
+			     uint64_t rows, uint8_t *buffer, int capacity)
+{
+	int width = renderer->width;
+	int length = 0;
+	renderer->cursor_row = -1;
+	renderer->cursor_column = -1;
+	renderer->style = -1;
+	bool ok = true;
+	for (int y = renderer->height - 1; y >= 0 && ok; y--) {
+		if (!Citrus_row_dirty(rows, y)) {
+			continue;
+		}
+		const uint8_t *row = frame + y * width;
+		uint8_t *previous_row = renderer->previous + y * width;
+		int terminal_row = renderer->row + renderer->height - 1 - y;
+		for (int x = 0; x < width && ok; x++) {
+			if (row[x] == previous_row[x]) {
+				continue;
+			}
+			// redrawing a short run of unchanged cells in the same
+			// style is cheaper than moving the cursor over them
+			int column = renderer->column + x * 2;
+			if (renderer->cursor_row == terminal_row
+			    && renderer->cursor_column < column
+			    && renderer->cursor_column >= column - 4) {
+				int gap_x = (renderer->cursor_column -
+					     renderer->column) / 2;
+				bool same_style = true;
+				for (int i = gap_x; i < x; i++) {
+					same_style &= row[i] == renderer->style;
+				}
+				for (int i = gap_x; i < x && same_style && ok;
+				     i++) {
+					ok = CitrusRenderer_cell(renderer,
+								 row[i], buffer,
+								 capacity,
+								 &length);
+				}
+			}
+			ok = ok && CitrusRenderer_move(renderer, terminal_row,
+						       column, buffer,
+						       capacity, &length);
+			ok = ok && CitrusRenderer_cell(renderer, row[x],
+						       buffer, capacity,
+						       &length);
+			previous_row[x] = row[x];
+		}
+	}
+	if (ok && renderer->style > 0) {
+		ok = CitrusRenderer_write(buffer, capacity, &length, "\033[0m",
+					  4);
+	}
+	if (!ok) {
+		CitrusRenderer_invalidate(renderer);
+		return -1;
+	}
+	return length;
+}
+
+// write escape codes for the cells which changed since the last frame
+int CitrusRenderer_draw_frame(CitrusRenderer *renderer, const uint8_t *frame,
+			      uint8_t *buffer, int capacity)
+{
+	// the game frame no longer matches the terminal
+	renderer->redraw = true;
+	return CitrusRenderer_draw_rows(renderer, frame, ~(uint64_t) 0, buffer,
+					capacity);
+}
+
+// write escape codes to update the terminal to a game's board
+int CitrusRenderer_draw_game(CitrusRenderer *renderer, CitrusGame *game,
+			     uint8_t *buffer, int capacity)
+{
+	uint64_t rows = renderer->redraw ? ~(uint64_t) 0 : game->dirty_rows;
+	renderer->redraw = false;
+	int width = renderer->width;
+	for (int y = 0; y < renderer->height; y++) {
+		if (!Citrus_row_dirty(rows, y)) {
+			continue;
+		}
+		for (int i = y * width; i < (y + 1) * width; i++) {
+			CitrusCell cell = game->board[i];
+			uint8_t value = 0;
+			if (cell.type == CITRUS_CELL_FULL) {
+				value = cell.color + 1;
+			} else if (cell.type == CITRUS_CELL_SHADOW) {
+				value = cell.color + CITRUS_RENDER_SHADOW;
+			}
+			renderer->current[i] = value;
+		}
+	}
+	return CitrusRenderer_draw_rows(renderer, renderer->current, rows,
+					buffer, capacity);
+}
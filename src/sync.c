@@ -0,0 +1,268 @@
+/* Copyright (C) 2026 RZ781
+ *
+ * This file is part of libcitrus.
+ *
+ * libcitrus is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 2.1 of the License, or (at your option)
+ * any later version.
+ *
+ * libcitrus is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "citrus.h"
+
+// set in middle when a snapshot has been published but not read
+#define CITRUS_SNAPSHOT_NEW 4
+
+// initialise an input queue
+void CitrusInputQueue_init(CitrusInputQueue *queue, CitrusTimedInput *inputs,
+			   uint32_t capacity)
+{
+	queue->head = 0;
+	queue->tail = 0;
+	queue->inputs = inputs;
+	queue->capacity = capacity;
+}
+
+// add an input to the queue, return false if it's full
+bool CitrusInputQueue_push(CitrusInputQueue *queue, CitrusKey key, bool down,
+			   uint64_t time)
+{
+	uint32_t head = queue->head;
+	uint32_t tail = __atomic_load_n(&queue->tail, __ATOMIC_ACQUIRE);
+	if (head - tail == queue->capacity) {
+		return false;
+	}
+	CitrusTimedInput *input = &queue->inputs[head & (queue->capacity - 1)];
+	input->time = time;
+	input->key = key;
+	input->down = down;
+	__atomic_store_n(&queue->head, head + 1, __ATOMIC_RELEASE);
+	return true;
+}
+
+// remove the oldest input if it happened by the given time
+bool CitrusInputQueue_pop(CitrusInputQueue *queue, CitrusTimedInput *input,
+			  uint64_t time)
+{
+	uint32_t tail = queue->tail;
+	uint32_t head = __atomic_load_n(&queue->head, __ATOMIC_ACQUIRE);
+	if (head == tail) {
+		return false;
+	}
+	CitrusTimedInput *next = &queue->inputs[tail & (queue->capacity - 1)];
+	if (next->time > time) {
+		return false;
+	}
+	*input = *next;
+	__atomic_store_n(&queue->tail, tail + 1, __ATOMIC_RELEASE);
+	return true;
+}
+
+// apply every input before the end of a tick to a game, with each press
+// keeping the subtick it happened on
+int CitrusInputQueue_apply(CitrusInputQueue *queue, CitrusGame *game,
+			   uint64_t start, uint64_t subtick_length)
+{
+	int subticks = game->config->subticks > 0 ? game->config->subticks : 1;
+	if (subtick_length < 1) {
+		subtick_length = 1;
+	}
+	uint64_t end = start + subticks * subtick_length;
+	// apply inputs in batches so the piece is only redrawn once per batch
+	CitrusInput inputs[16];
+	int n = 0;
+	int total = 0;
+	CitrusTimedInput input;
+	while (CitrusInputQueue_pop(queue, &input, end - 1)) {
+		// inputs that arrived late count as happening at the start
+		uint64_t offset = input.time > start ?
+		    (input.time - start) / subtick_length : 0;
+		inputs[n].key = input.key;
+		inputs[n].down = input.down;
+		inputs[n].offset = offset;
+		n++;
+		if (n == 16) {
+			CitrusGame_apply_inputs(game, inputs, n);
+			total += n;
+			n = 0;
+		}
+	}
+	CitrusGame_apply_inputs(game, inputs, n);
+	return total + n;
+}
+
+// check if a piece fits at a position among a snapshot's locked cells
+bool CitrusSnapshot_fits(CitrusSnapshot *snapshot, CitrusVector position)
+{
+	const CitrusPiece *piece = snapshot->current_piece;
+	int size = piece->width * piece->height;
+	const CitrusCell *data = piece->piece_data + snapshot->rotation * size;
+	for (int dy = 0; dy < piece->height; dy++) {
+		for (int dx = 0; dx < piece->width; dx++) {
+			if (data[dy * piece->width + dx].type !=
+			    CITRUS_CELL_FULL) {
+				continue;
+			}
+			int x = position.x + dx;
+			int y = position.y + dy;
+			if (x < 0 || x >= snapshot->width || y < 0
+			    || y >= snapshot->full_height) {
+				return false;
+			}
+			if (snapshot->cells[y * snapshot->width + x] != 0) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+// copy the state of a game needed to draw it, only copying some rows
+void CitrusGame_snapshot_rows(CitrusGame *game, CitrusSnapshot *snapshot,
+			      uint64_t rows)
+{
+	int width = game->config->width;
+	for (int y = 0; y < game->config->full_height; y++) {
+		if (!Citrus_row_dirty(rows, y)) {
+			continue;
+		}
+		for (int i = y * width; i < (y + 1) * width; i++) {
+			CitrusCell cell = game->board[i];
+			snapshot->cells[i] =
+			    cell.type == CITRUS_CELL_FULL ? cell.color + 1 : 0;
+		}
+	}
+	// the current piece is only on the board while it's in play
+	snapshot->current_piece = NULL;
+	if (game->alive && game->line_clear_delay == 0) {
+		const CitrusPiece *piece = game->current_piece;
+		int piece_size = piece->width * piece->height;
+		const CitrusCell *data =
+		    piece->piece_data + game->rotation * piece_size;
+		for (int dy = 0; dy < piece->height; dy++) {
+			for (int dx = 0; dx < piece->width; dx++) {
+				int x = game->position.x + dx;
+				int y = game->position.y + dy;
+				if (data[dy * piece->width + dx].type !=
+				    CITRUS_CELL_FULL) {
+					continue;
+				}
+				if (x >= 0 && x < snapshot->width && y >= 0
+				    && y < snapshot->full_height) {
+					snapshot->cells[y * snapshot->width +
+							x] = 0;
+				}
+			}
+		}
+		snapshot->current_piece = piece;
+	}
+	snapshot->position = game->position;
+	snapshot->rotation = game->rotation;
+	snapshot->ghost_y = game->position.y;
+	if (snapshot->current_piece != NULL) {
+		CitrusVector position = game->position;
+		while (CitrusSnapshot_fits(snapshot, position)) {
+			position.y--;
+		}
+		snapshot->ghost_y = position.y + 1;
+	}
+	snapshot->hold_piece = game->hold_piece;
+	for (int i = 0; i < snapshot->n_next_pieces; i++) {
+		snapshot->next_pieces[i] = game->next_piece_queue[i];
+	}
+	snapshot->score = game->score;
+	snapshot->lines = game->lines;
+	snapshot->level = game->level;
+	snapshot->alive = game->alive;
+}
+
+// copy the state of a game needed to draw it
+void CitrusGame_snapshot(CitrusGame *game, CitrusSnapshot *snapshot)
+{
+	CitrusGame_snapshot_rows(game, snapshot, ~(uint64_t) 0);
+}
+
+// initialise a triple buffer of snapshots
+void CitrusSnapshotBuffer_init(CitrusSnapshotBuffer *buffer, uint8_t *cells,
+			       const CitrusPiece **next_pieces, int width,
+			       int full_height, int n_next_pieces)
+{
+	for (int i = 0; i < 3; i++) {
+		CitrusSnapshot *snapshot = &buffer->snapshots[i];
+		snapshot->cells = cells + i * width * full_height;
+		snapshot->width = width;
+		snapshot->full_height = full_height;
+		snapshot->current_piece = NULL;
+		snapshot->position = (CitrusVector) { 0, 0 };
+		snapshot->rotation = 0;
+		snapshot->ghost_y = 0;
+		snapshot->hold_piece = NULL;
+		snapshot->next_pieces = next_pieces + i * n_next_pieces;
+		snapshot->n_next_pieces = n_next_pieces;
+		snapshot->score = 0;
+		snapshot->lines = 0;
+		snapshot->level = 1;
+		snapshot->alive = true;
+		for (int j = 0; j < width * full_height; j++) {
+			snapshot->cells[j] = 0;
+		}
+		for (int j = 0; j < n_next_pieces; j++) {
+			snapshot->next_pieces[j] = NULL;
+		}
+	}
+	buffer->back = 0;
+	buffer->middle = 1;
+	buffer->front = 2;
+	for (int i = 0; i < 3; i++) {
+		buffer->stale_rows[i] = ~(uint64_t) 0;
+	}
+}
+
+// snapshot a game into the back snapshot, only copying rows it is missing
+void CitrusSnapshotBuffer_write(CitrusSnapshotBuffer *buffer, CitrusGame *game)
+{
+	for (int i = 0; i < 3; i++) {
+		buffer->stale_rows[i] |= game->dirty_rows;
+	}
+	CitrusGame_snapshot_rows(game, &buffer->snapshots[buffer->back],
+				 buffer->stale_rows[buffer->back]);
+	buffer->stale_rows[buffer->back] = 0;
+}
+
+// get the snapshot for the writer to fill in
+CitrusSnapshot *CitrusSnapshotBuffer_back(CitrusSnapshotBuffer *buffer)
+{
+	return &buffer->snapshots[buffer->back];
+}
+
+// swap the back snapshot with the middle one, marking it as new
+void CitrusSnapshotBuffer_publish(CitrusSnapshotBuffer *buffer)
+{
+	int middle = __atomic_exchange_n(&buffer->middle,
+					 buffer->back | CITRUS_SNAPSHOT_NEW,
+					 __ATOMIC_ACQ_REL);
+	buffer->back = middle & ~CITRUS_SNAPSHOT_NEW;
+}
+
+// swap the front snapshot with the middle one if a new one was published
+const CitrusSnapshot *CitrusSnapshotBuffer_read(CitrusSnapshotBuffer *buffer)
+{
+	if (__atomic_load_n(&buffer->middle, __ATOMIC_ACQUIRE) &
+	    CITRUS_SNAPSHOT_NEW) {
+		int middle = __atomic_exchange_n(&buffer->middle, buffer->front,
+						 __ATOMIC_ACQ_REL);
+		buffer->front = middle & ~CITRUS_SNAPSHOT_NEW;
+	}
+	return &buffer->snapshots[buffer->front];
+}
@@ -0,0 +1,72 @@
+/* Copyright (C) 2026 RZ781
+ *
+ * This file is part of libcitrus.
+ *
+ * libcitrus is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 2.1 of the License, or (at your option)
+ * any later version.
+ *
+ * libcitrus is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include "citrus.h"
+
+// initialise a tracer
+void CitrusTracer_init(CitrusTracer *tracer, CitrusTraceRecord *records,
+		       uint32_t capacity, uint64_t (*clock)(void *clock_data),
+		       void *clock_data)
+{
+	tracer->records = records;
+	tracer->capacity = capacity;
+	tracer->count = 0;
+	tracer->clock = clock;
+	tracer->clock_data = clock_data;
+}
+
+// add a record, overwriting the oldest if the buffer is full
+void CitrusTracer_record(CitrusTracer *tracer, CitrusTraceName name,
+			 CitrusTracePhase phase, int id, int arg)
+{
+	if (tracer == NULL) {
+		return;
+	}
+	CitrusTraceRecord *record =
+	    &tracer->records[tracer->count & (tracer->capacity - 1)];
+	record->time = tracer->clock(tracer->clock_data);
+	record->id = id;
+	record->arg = arg > 0xffff ? 0xffff : arg;
+	record->name = name;
+	record->phase = phase;
+	tracer->count++;
+}
+
+// copy the records still in the buffer, oldest first
+int CitrusTracer_copy(CitrusTracer *tracer, CitrusTraceRecord *records,
+		      int capacity)
+{
+	uint64_t start = 0;
+	if (tracer->count > tracer->capacity) {
+		start = tracer->count - tracer->capacity;
+	}
+	int n = 0;
+	for (uint64_t i = start; i < tracer->count && n < capacity; i++) {
+		records[n++] = tracer->records[i & (tracer->capacity - 1)];
+	}
+	return n;
+}
+
+// set the tracer for a game's events
+void CitrusGame_set_tracer(CitrusGame *game, CitrusTracer *tracer, int id)
+{
+	game->tracer = tracer;
+	game->trace_id = id;
+}
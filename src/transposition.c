@@ -0,0 +1,70 @@
+/* Copyright (C) 2026 RZ781
+ *
+ * This file is part of libcitrus.
+ *
+ * libcitrus is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 2.1 of the License, or (at your option)
+ * any later version.
+ *
+ * libcitrus is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "citrus.h"
+
+// set when an entry has been stored, so empty entries never verify
+#define CITRUS_TABLE_VALID ((uint64_t) 1 << 63)
+
+// initialise an empty table, capacity must be a power of two
+void CitrusTranspositionTable_init(CitrusTranspositionTable *table,
+				   CitrusTableEntry *entries, uint32_t capacity)
+{
+	table->entries = entries;
+	table->capacity = capacity;
+	table->generation = 0;
+	for (uint32_t i = 0; i < capacity; i++) {
+		entries[i].check = 0;
+		entries[i].data = 0;
+	}
+}
+
+// ignore everything stored by earlier searches
+void CitrusTranspositionTable_new_search(CitrusTranspositionTable *table)
+{
+	table->generation = (table->generation + 1) & 0xffff;
+}
+
+// look up a key stored during the current search
+bool CitrusTranspositionTable_probe(CitrusTranspositionTable *table,
+				    uint64_t key, int *value, int *depth)
+{
+	CitrusTableEntry *entry = &table->entries[key & (table->capacity - 1)];
+	uint64_t check = __atomic_load_n(&entry->check, __ATOMIC_RELAXED);
+	uint64_t data = __atomic_load_n(&entry->data, __ATOMIC_RELAXED);
+	if (!(data & CITRUS_TABLE_VALID) || (check ^ data) != key
+	    || (data >> 40 & 0xffff) != table->generation) {
+		return false;
+	}
+	*value = (int32_t) (uint32_t) data;
+	*depth = data >> 32 & 0xff;
+	return true;
+}
+
+// store a key's value and depth, always replacing the old entry
+void CitrusTranspositionTable_store(CitrusTranspositionTable *table,
+				    uint64_t key, int value, int depth)
+{
+	CitrusTableEntry *entry = &table->entries[key & (table->capacity - 1)];
+	uint64_t data = (uint32_t) value | (uint64_t) (depth & 0xff) << 32
+	    | (uint64_t) table->generation << 40 | CITRUS_TABLE_VALID;
+	__atomic_store_n(&entry->check, key ^ data, __ATOMIC_RELAXED);
+	__atomic_store_n(&entry->data, data, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,79 @@
+/* Copyright (C) 2026 RZ781
+ *
+ * This file is part of libcitrus.
+ *
+ * libcitrus is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 2.1 of the License, or (at your option)
+ * any later version.
+ *
+ * libcitrus is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include "citrus.h"
+
+// initialise a validator with the same game setup as the client
+void CitrusValidator_init(CitrusValidator *validator, CitrusCell *board,
+			  const CitrusPiece **next_piece_queue,
+			  const CitrusGameConfig *config, void *randomizer_data)
+{
+	// the client's action text callback mustn't run on the server
+	validator->config = *config;
+	validator->config.action_text = NULL;
+	CitrusGame_init(&validator->game, board, next_piece_queue,
+			&validator->config, randomizer_data, NULL);
+	validator->tick = 0;
+	validator->checked_tick = 0;
+	validator->desynced = false;
+}
+
+// fast forward the game to a tick, returning false if it's too far ahead
+bool CitrusValidator_advance(CitrusValidator *validator, int tick)
+{
+	if (tick - validator->tick > CITRUS_VALIDATOR_MAX_SKIP) {
+		validator->desynced = true;
+		return false;
+	}
+	if (tick > validator->tick) {
+		CitrusGame_skip_ticks(&validator->game, tick - validator->tick);
+		validator->tick = tick;
+	}
+	return true;
+}
+
+// apply key transitions on a tick
+void CitrusValidator_input(CitrusValidator *validator, int tick,
+			   unsigned down, unsigned up)
+{
+	if (CitrusValidator_advance(validator, tick)) {
+		CitrusGame_apply_masks(&validator->game, down, up);
+	}
+}
+
+// compare the client's checksum with the replayed game
+bool CitrusValidator_check(CitrusValidator *validator, int tick,
+			   uint32_t checksum)
+{
+	// the game can't be rewound to an earlier tick, so its checksum is
+	// ignored rather than compared with a later state
+	if (tick < validator->tick) {
+		return true;
+	}
+	if (!CitrusValidator_advance(validator, tick)) {
+		return false;
+	}
+	validator->checked_tick = tick;
+	if (CitrusGame_checksum(&validator->game) != checksum) {
+		validator->desynced = true;
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,75 @@
+/* Copyright (C) 2026 RZ781
+ *
+ * This file is part of libcitrus.
+ *
+ * libcitrus is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 2.1 of the License, or (at your option)
+ * any later version.
+ *
+ * libcitrus is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <assert.h>
+#include <stdint.h>
+#include "citrus.h"
+#include "tests.h"
+
+void bitboard_test(void)
+{
+	uint8_t data[4096];
+	CitrusArena arena;
+	CitrusArena_init(&arena, data, sizeof(data));
+	const uint64_t *parent_blocks[5];
+	const uint64_t *child_blocks[5];
+	CitrusBitboard parent;
+	CitrusBitboard child;
+	CitrusBitboard_init(&parent, parent_blocks, 5);
+	CitrusBitboard_init(&child, child_blocks, 5);
+	for (int y = 0; y < 12; y++) {
+		assert(CitrusBitboard_set_row(&parent, &arena, y, 0x3ff >> 1));
+	}
+	assert(parent.blocks[2] == citrus_bitboard_empty_block);
+
+	// a copy only gets its own block once it writes to it
+	CitrusBitboard_copy(&child, &parent);
+	size_t used = arena.used;
+	assert(CitrusBitboard_set_row(&child, &arena, 3, 0x3ff));
+	assert(arena.used > used);
+	assert(child.blocks[0] != parent.blocks[0]);
+	assert(child.blocks[1] == parent.blocks[1]);
+	assert(CitrusBitboard_get_row(&parent, 3) == 0x3ff >> 1);
+	assert(CitrusBitboard_get_row(&child, 3) == 0x3ff);
+	used = arena.used;
+	assert(CitrusBitboard_set_row(&child, &arena, 5, 0x3ff));
+	assert(arena.used == used);
+
+	// clearing lines moves the rows above down
+	assert(CitrusBitboard_set_row(&child, &arena, 12, 1));
+	assert(CitrusBitboard_clear_lines(&child, &arena, 0x3ff) == 2);
+	for (int y = 0; y < 10; y++) {
+		assert(CitrusBitboard_get_row(&child, y) == 0x3ff >> 1);
+	}
+	assert(CitrusBitboard_get_row(&child, 10) == 1);
+	assert(CitrusBitboard_get_row(&child, 11) == 0);
+	assert(CitrusBitboard_get_row(&parent, 3) == 0x3ff >> 1);
+	assert(CitrusBitboard_get_row(&parent, 12) == 0);
+
+	// blocks that become empty are shared again
+	assert(CitrusBitboard_set_row(&child, &arena, 10, 0));
+	assert(CitrusBitboard_set_row(&child, &arena, 8, 0));
+	assert(CitrusBitboard_set_row(&child, &arena, 9, 0));
+	assert(child.blocks[1] == citrus_bitboard_empty_block);
+
+	// running out of arena fails instead of writing to a shared block
+	CitrusArena_init(&arena, data, 0);
+	CitrusBitboard_copy(&child, &parent);
+	assert(!CitrusBitboard_set_row(&child, &arena, 0, 0));
+	assert(CitrusBitboard_get_row(&parent, 0) == 0x3ff >> 1);
+}
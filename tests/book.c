@@ -0,0 +1,116 @@
+/* Copyright (C) 2026 RZ781
+ *
+ * This file is part of libcitrus.
+ *
+ * libcitrus is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 2.1 of the License, or (at your option)
+ * any later version.
+ *
+ * libcitrus is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <assert.h>
+#include <stdint.h>
+#include "citrus.h"
+#include "tests.h"
+
+#define BOOK_PIECES 8
+
+uint8_t book_arena_data[1 << 20];
+
+void book_test(void)
+{
+	CitrusCell board[10 * 40];
+	const CitrusPiece *queue[5];
+	CitrusGameConfig config = citrus_preset_delayless;
+	config.next_piece_queue_size = 5;
+	CitrusBagRandomizer bag;
+	CitrusGame game;
+	CitrusBot bot;
+	CitrusBot_init(&bot, 8, 2);
+	CitrusArena arena;
+	CitrusArena_init(&arena, book_arena_data, sizeof(book_arena_data));
+
+	// record the placements of a few pieces, sorted by key
+	CitrusBookEntry entries[BOOK_PIECES];
+	CitrusBotMove moves[BOOK_PIECES];
+	CitrusBagRandomizer_init(&bag, 7);
+	CitrusGame_init(&game, board, queue, &config, &bag, NULL);
+	for (int i = 0; i < BOOK_PIECES; i++) {
+		assert(CitrusBot_plan(&bot, &game, &arena, &moves[i]));
+		CitrusBookEntry entry = {
+			.key = CitrusBot_book_key(&bot, 2),
+			.value = moves[i].value,
+			.x = moves[i].position.x,
+			.y = moves[i].position.y,
+			.rotation = moves[i].rotation,
+			.hold = moves[i].hold
+		};
+		int j = i;
+		for (; j > 0 && entries[j - 1].key > entry.key; j--) {
+			entries[j] = entries[j - 1];
+		}
+		assert(j == 0 || entries[j - 1].key != entry.key);
+		entries[j] = entry;
+		CitrusBotMove_apply(&moves[i], &game);
+	}
+
+	// a written book finds every entry and nothing else
+	uint8_t data[CITRUS_BOOK_HEADER_SIZE +
+		     BOOK_PIECES * CITRUS_BOOK_ENTRY_SIZE];
+	assert(CitrusBook_write(data, sizeof(data) - 1, entries, BOOK_PIECES,
+				2) == 0);
+	assert(CitrusBook_write(data, sizeof(data), entries, BOOK_PIECES, 2)
+	       == sizeof(data));
+	CitrusBook book;
+	assert(!CitrusBook_init(&book, data, sizeof(data) - 1));
+	assert(CitrusBook_init(&book, data, sizeof(data)));
+	for (int i = 0; i < BOOK_PIECES; i++) {
+		CitrusBookEntry entry;
+		assert(CitrusBook_lookup(&book, entries[i].key, &entry));
+		assert(entry.value == entries[i].value);
+		assert(entry.x == entries[i].x && entry.y == entries[i].y);
+		assert(entry.rotation == entries[i].rotation);
+		assert(entry.hold == entries[i].hold);
+		CitrusBookEntry missing;
+		assert(!CitrusBook_lookup(&book, entries[i].key + 1, &missing)
+		       || (i + 1 < BOOK_PIECES
+			   && entries[i + 1].key == entries[i].key + 1));
+	}
+
+	// replaying the game with the book finishes every search straight
+	// away with the recorded placement
+	CitrusBot_set_book(&bot, &book);
+	CitrusBagRandomizer_init(&bag, 7);
+	CitrusGame_init(&game, board, queue, &config, &bag, NULL);
+	for (int i = 0; i < BOOK_PIECES; i++) {
+		CitrusBotMove move;
+		assert(CitrusBot_begin(&bot, &game, &arena));
+		assert(CitrusBot_step(&bot, 0));
+		assert(CitrusBot_best_so_far(&bot, &move));
+		assert(move.piece == moves[i].piece);
+		assert(move.hold == moves[i].hold);
+		assert(move.position.x == moves[i].position.x);
+		assert(move.position.y == moves[i].position.y);
+		assert(move.rotation == moves[i].rotation);
+		assert(move.value == moves[i].value);
+		CitrusBotMove_apply(&move, &game);
+	}
+	CitrusBot_set_book(&bot, NULL);
+
+	// unsorted entries and damaged headers are rejected
+	CitrusBookEntry swapped = entries[0];
+	entries[0] = entries[1];
+	entries[1] = swapped;
+	assert(CitrusBook_write(data, sizeof(data), entries, BOOK_PIECES, 2)
+	       == 0);
+	data[0] = 'X';
+	assert(!CitrusBook_init(&book, data, sizeof(data)));
+}
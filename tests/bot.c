@@ -0,0 +1,145 @@
+/* Copyright (C) 2026 RZ781
+ *
+ * This file is part of libcitrus.
+ *
+ * libcitrus is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 2.1 of the License, or (at your option)
+ * any later version.
+ *
+ * libcitrus is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <assert.h>
+#include <stdint.h>
+#include "citrus.h"
+#include "tests.h"
+
+uint8_t bot_arena_data[1 << 20];
+
+void bot_test(void)
+{
+	CitrusCell bot_board[10 * 40];
+	const CitrusPiece *queue[5];
+	CitrusGameConfig config = citrus_preset_delayless;
+	config.next_piece_queue_size = 5;
+	CitrusBagRandomizer bag;
+	CitrusBagRandomizer_init(&bag, 42);
+	CitrusGame game;
+	CitrusGame_init(&game, bot_board, queue, &config, &bag, NULL);
+	CitrusBot bot;
+	CitrusBot_init(&bot, 32, 4);
+	CitrusArena arena;
+	CitrusArena_init(&arena, bot_arena_data, sizeof(bot_arena_data));
+
+	// every planned piece locks where the bot said it would
+	for (int i = 0; i < 200; i++) {
+		CitrusBotMove move;
+		assert(CitrusBot_plan(&bot, &game, &arena, &move));
+		assert(move.n_keys > 0);
+		assert(move.keys[move.n_keys - 1] == CITRUS_KEY_HARD_DROP);
+		int lines = game.lines;
+		CitrusBotMove_apply(&move, &game);
+		assert(game.alive);
+		if (game.lines != lines) {
+			continue;
+		}
+		const CitrusPiece *piece = &citrus_pieces[move.piece];
+		int size = piece->width * piece->height;
+		for (int y = 0; y < piece->height; y++) {
+			for (int x = 0; x < piece->width; x++) {
+				int j = move.rotation * size + y * piece->width
+				    + x;
+				if (piece->piece_data[j].type !=
+				    CITRUS_CELL_FULL) {
+					continue;
+				}
+				CitrusVector position = {
+					move.position.x + x,
+					move.position.y + y
+				};
+				assert(CitrusGame_get_cell(&game, position).type
+				       == CITRUS_CELL_FULL);
+			}
+		}
+	}
+	// 200 pieces fill 80 lines, which the bot should mostly clear
+	assert(game.lines >= 70);
+
+	// stepping a search finds the same move as planning it in one go
+	CitrusBotMove move;
+	CitrusBotMove planned;
+	CitrusBagRandomizer_init(&bag, 5);
+	CitrusGame_init(&game, bot_board, queue, &citrus_preset_modern, &bag,
+			NULL);
+	assert(CitrusBot_plan(&bot, &game, &arena, &planned));
+	assert(CitrusBot_begin(&bot, &game, &arena));
+	assert(!CitrusBot_step(&bot, 1));
+	assert(CitrusBot_best_so_far(&bot, &move));
+	int steps = 1;
+	while (!CitrusBot_step(&bot, 1)) {
+		steps++;
+	}
+	assert(steps > 10);
+	assert(CitrusBot_best_so_far(&bot, &move));
+	assert(move.piece == planned.piece && move.hold == planned.hold);
+	assert(move.position.x == planned.position.x);
+	assert(move.position.y == planned.position.y);
+	assert(move.rotation == planned.rotation);
+
+	// committing after the piece has fallen still reaches the same place
+	assert(CitrusBot_begin(&bot, &game, &arena));
+	CitrusBot_step(&bot, 5);
+	for (int i = 0; i < 120; i++) {
+		CitrusGame_tick(&game);
+	}
+	while (!CitrusBot_step(&bot, 5)) ;
+	assert(CitrusBot_commit(&bot, &game, &move));
+	assert(move.position.x == planned.position.x);
+	assert(move.position.y == planned.position.y);
+	assert(move.rotation == planned.rotation);
+
+	// a search can't be committed once its piece has locked
+	assert(!CitrusBot_commit(&bot, &game, &move));
+
+	// table entries are only found during the search that stored them
+	CitrusTableEntry entries[64];
+	CitrusTranspositionTable table;
+	CitrusTranspositionTable_init(&table, entries, 64);
+	int value;
+	int depth;
+	assert(!CitrusTranspositionTable_probe(&table, 0, &value, &depth));
+	CitrusTranspositionTable_store(&table, 12345, -678, 3);
+	assert(CitrusTranspositionTable_probe(&table, 12345, &value, &depth));
+	assert(value == -678 && depth == 3);
+	assert(!CitrusTranspositionTable_probe(&table, 12345 + 64, &value,
+					       &depth));
+	CitrusTranspositionTable_new_search(&table);
+	assert(!CitrusTranspositionTable_probe(&table, 12345, &value, &depth));
+
+	// bots splitting the first moves between them with a shared table
+	// each find a move, and one of them finds the best
+	CitrusBot_plan(&bot, &game, &arena, &planned);
+	CitrusBot_set_table(&bot, &table);
+	int best = planned.value - 1;
+	for (int i = 0; i < 2; i++) {
+		CitrusBot_set_split(&bot, i, 2);
+		assert(CitrusBot_plan(&bot, &game, &arena, &move));
+		if (move.value > best) {
+			best = move.value;
+		}
+	}
+	assert(best >= planned.value);
+	CitrusBot_set_table(&bot, NULL);
+	CitrusBot_set_split(&bot, 0, 1);
+
+	// searches that don't fit in the arena fail
+	CitrusArena_init(&arena, bot_arena_data, 1024);
+	assert(!CitrusBot_plan(&bot, &game, &arena, &move));
+}
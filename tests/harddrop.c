@@ -26,7 +26,7 @@ void hard_drop_test(void)
 	LoopRandomizer randomizer_data = {.length = 1,.position = 0,.pieces =
 		    (const CitrusPiece *[]) {citrus_pieces + CITRUS_COLOR_O}
 	};
-	CitrusGame_init(&game, board, next_piece_queue, test_config,
+	CitrusGame_init(&game, board, next_piece_queue, &test_config,
 			&randomizer_data, NULL);
 
 	clear_board();
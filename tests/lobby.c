@@ -0,0 +1,383 @@
+/* Copyright (C) 2026 RZ781
+ *
+ * This file is part of libcitrus.
+ *
+ * libcitrus is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 2.1 of the License, or (at your option)
+ * any later version.
+ *
+ * libcitrus is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include "citrus.h"
+#include "tests.h"
+
+#define LOBBY_CAPACITY 1000
+#define PARSER_BUFFER_SIZE 16
+#define OUTPUT_BUFFER_SIZE 64
+#define CONNECTIONS_SIZE 2048
+
+// counts the number of send calls for each client
+void count_send(void *send_data, int n, uint8_t *data, int id)
+{
+	int *sends = send_data;
+	(void)n;
+	(void)data;
+	if (id < LOBBY_CAPACITY) {
+		sends[id]++;
+	}
+}
+
+void lobby_test(void)
+{
+	static CitrusLobbySlot slots[LOBBY_CAPACITY];
+	static int active_slots[LOBBY_CAPACITY];
+	static CitrusIdEntry connections[CONNECTIONS_SIZE];
+	static CitrusParser parsers[LOBBY_CAPACITY];
+	static uint8_t parser_buffers[LOBBY_CAPACITY * PARSER_BUFFER_SIZE];
+	static uint8_t output_buffers[LOBBY_CAPACITY * OUTPUT_BUFFER_SIZE];
+	static int sends[LOBBY_CAPACITY];
+	CitrusServerLobby lobby;
+	// connection tables must be a power of two larger than the lobby
+	assert(!CitrusServerLobby_init(&lobby, slots, active_slots,
+				       connections, CONNECTIONS_SIZE / 4,
+				       parsers, parser_buffers,
+				       PARSER_BUFFER_SIZE, output_buffers,
+				       OUTPUT_BUFFER_SIZE, LOBBY_CAPACITY,
+				       count_send, sends));
+	assert(!CitrusServerLobby_init(&lobby, slots, active_slots,
+				       connections, CONNECTIONS_SIZE - 1,
+				       parsers, parser_buffers,
+				       PARSER_BUFFER_SIZE, output_buffers,
+				       OUTPUT_BUFFER_SIZE, LOBBY_CAPACITY,
+				       count_send, sends));
+	assert(CitrusServerLobby_init(&lobby, slots, active_slots, connections,
+				      CONNECTIONS_SIZE, parsers, parser_buffers,
+				      PARSER_BUFFER_SIZE, output_buffers,
+				      OUTPUT_BUFFER_SIZE, LOBBY_CAPACITY,
+				      count_send, sends));
+	assert(lobby.lobby.n_active_slots == 0);
+
+	// connection ids can be anywhere in the range of an int
+	assert(CitrusServerLobby_client_connect(&lobby, 3));
+	assert(CitrusServerLobby_client_connect(&lobby, 2000000000));
+	assert(CitrusServerLobby_client_connect(&lobby, 500000));
+	assert(!CitrusServerLobby_client_connect(&lobby, 2000000000));
+	assert(!CitrusServerLobby_client_connect(&lobby, -1));
+	assert(lobby.lobby.n_active_slots == 3);
+	CitrusLobbySlot *a = CitrusServerLobby_get_slot(&lobby, 3);
+	CitrusLobbySlot *b = CitrusServerLobby_get_slot(&lobby, 500000);
+	CitrusLobbySlot *c = CitrusServerLobby_get_slot(&lobby, 2000000000);
+	assert(a != NULL && b != NULL && c != NULL);
+	assert(a->connected && b->connected && c->connected);
+	assert(a->connection_id == 3 && b->connection_id == 500000);
+	assert(CitrusServerLobby_get_slot(&lobby, 4) == NULL);
+
+	CitrusServerLobby_client_disconnect(&lobby, 2000000000);
+	assert(lobby.lobby.n_active_slots == 2);
+	assert(!c->connected);
+	assert(CitrusServerLobby_get_slot(&lobby, 2000000000) == NULL);
+	for (int i = 0; i < lobby.lobby.n_active_slots; i++) {
+		CitrusLobbySlot *slot = &slots[active_slots[i]];
+		assert(slot == a || slot == b);
+		assert(slot->active_index == i);
+	}
+
+	// a disconnect event sent by a client only affects that client
+	uint8_t disconnect[] = { 3, CITRUS_EVENT_DISCONNECT, 244, 3 };
+	assert(CitrusServerLobby_recv(&lobby, sizeof(disconnect), disconnect,
+				      3));
+	assert(!a->connected);
+	assert(CitrusServerLobby_get_slot(&lobby, 3) == NULL);
+	assert(b->connected);
+	assert(lobby.lobby.n_active_slots == 1);
+	assert(&slots[active_slots[0]] == b);
+
+	// frames split between reads are reassembled
+	for (int i = 0; i < (int)sizeof(disconnect); i++) {
+		assert(b->connected);
+		assert(CitrusServerLobby_recv(&lobby, 1, disconnect + i,
+					      500000));
+	}
+	assert(!b->connected);
+
+	// the lobby fills up and slots are reused after disconnecting
+	for (int i = 0; i < LOBBY_CAPACITY; i++) {
+		assert(CitrusServerLobby_client_connect(&lobby, i * 7919));
+	}
+	assert(!CitrusServerLobby_client_connect(&lobby, 1));
+	for (int i = 0; i < LOBBY_CAPACITY; i += 2) {
+		CitrusServerLobby_client_disconnect(&lobby, i * 7919);
+	}
+	for (int i = 0; i < LOBBY_CAPACITY; i++) {
+		CitrusLobbySlot *slot =
+		    CitrusServerLobby_get_slot(&lobby, i * 7919);
+		assert((slot == NULL) == (i % 2 == 0));
+		assert(slot == NULL || slot->connection_id == i * 7919);
+	}
+	for (int i = 1; i < LOBBY_CAPACITY; i += 2) {
+		CitrusServerLobby_client_disconnect(&lobby, i * 7919);
+	}
+	assert(lobby.lobby.n_active_slots == 0);
+	assert(lobby.connections.count == 0);
+
+	// split frames larger than the parser buffer are reported
+	CitrusServerLobby_client_connect(&lobby, 7);
+	uint8_t large[] = { 100, 0 };
+	assert(!CitrusServerLobby_recv(&lobby, sizeof(large), large, 7));
+
+	// batched inputs are applied when the server's game reaches their tick
+	CitrusServerLobby_client_connect(&lobby, 8);
+	CitrusLobbySlot *slot = CitrusServerLobby_get_slot(&lobby, 8);
+	LoopRandomizer randomizer_data = {.length = 1,.position = 0,.pieces =
+		    (const CitrusPiece *[]) {citrus_pieces + CITRUS_COLOR_O}
+	};
+	CitrusGame_init(&slot->game, board, next_piece_queue, &test_config,
+			&randomizer_data, NULL);
+	CitrusServerLobby_start_game(&lobby, 8);
+	uint8_t input_buffer[64];
+	CitrusInputEncoder encoder;
+	CitrusInputEncoder_init(&encoder, input_buffer, sizeof(input_buffer),
+				8);
+	const unsigned left = 1 << CITRUS_KEY_LEFT;
+	const unsigned right = 1 << CITRUS_KEY_RIGHT;
+	for (int tick = 0; tick < 4; tick++) {
+		assert(CitrusInputEncoder_add(&encoder, tick * 10, left, left));
+	}
+	// a hold and release in the same batch is still a hold
+	assert(CitrusInputEncoder_add(&encoder, 50, right, 0));
+	assert(CitrusInputEncoder_add(&encoder, 80, 0, right));
+	uint8_t *data;
+	int n = CitrusInputEncoder_finish(&encoder, &data);
+	assert(CitrusServerLobby_recv(&lobby, n, data, 8));
+	assert(slot->input_tick == 80);
+	int x = slot->game.position.x;
+	int y = slot->game.position.y;
+	for (int tick = 0; tick <= 80; tick++) {
+		// an input on tick n takes effect on the n + 1th server tick
+		CitrusServerLobby_tick(&lobby);
+		// only inputs the game has applied are acknowledged
+		assert(slot->acked_tick == (tick < 40 ? tick / 10 * 10 :
+					    tick < 50 ? 30 : tick < 80 ? 50 :
+					    80));
+		if (tick < 40) {
+			assert(slot->game.position.x == x - 1 - tick / 10);
+		} else if (tick < 50) {
+			assert(slot->game.position.x == x - 4);
+		}
+	}
+	assert(slot->game.move_direction == 0);
+	assert(slot->game.position.x == 10 - 2);
+
+	// ticking steps games and sends an acknowledgement each time a later
+	// input is applied
+	for (int i = 81; i < 120; i++) {
+		CitrusServerLobby_tick(&lobby);
+	}
+	assert(slot->game.position.y == y - 2);
+	assert(sends[8] == 5);
+	assert(slot->acked_tick == 80);
+
+	// queued data is coalesced into a single send per tick
+	uint8_t message[20] = { 0 };
+	for (int i = 0; i < 3; i++) {
+		CitrusServerLobby_send(&lobby, 7, sizeof(message), message);
+	}
+	assert(sends[7] == 0);
+	CitrusServerLobby_tick(&lobby);
+	assert(sends[7] == 1);
+	for (int i = 0; i < 4; i++) {
+		CitrusServerLobby_send(&lobby, 7, sizeof(message), message);
+	}
+	assert(sends[7] == 2);
+	CitrusServerLobby_tick(&lobby);
+	assert(sends[7] == 3);
+	assert(lobby.tick == 122);
+
+	// inputs too far ahead of the lobby disconnect the client before
+	// they reach its game
+	uint8_t far[] = { 13, CITRUS_EVENT_INPUT, 0, 255, 255, 255, 255, 255,
+		255, 255, 255, 255, 1, 1
+	};
+	assert(!CitrusServerLobby_recv(&lobby, sizeof(far), far, 8));
+	assert(CitrusServerLobby_get_slot(&lobby, 8) == NULL);
+	CitrusServerLobby_client_connect(&lobby, 8);
+	uint8_t ahead[] = { 5, CITRUS_EVENT_INPUT, 0, 0x80 | 62, 2, 1 };
+	assert(CitrusServerLobby_recv(&lobby, sizeof(ahead), ahead, 8));
+	ahead[4] = 3;
+	assert(!CitrusServerLobby_recv(&lobby, sizeof(ahead), ahead, 8));
+	for (int i = 1; i < lobby.lobby.n_active_slots; i++) {
+		assert(active_slots[i - 1] < active_slots[i]);
+	}
+
+	// a checksum sent ahead of its inputs is compared once they arrive
+	static CitrusCell validator_board[10 * 40];
+	const CitrusPiece *validator_queue[3];
+	CitrusBagRandomizer validator_bag;
+	CitrusBagRandomizer_init(&validator_bag, 1234);
+	CitrusValidator validator;
+	CitrusValidator_init(&validator, validator_board, validator_queue,
+			     &citrus_preset_modern, &validator_bag);
+	CitrusServerLobby_client_connect(&lobby, 9);
+	CitrusServerLobby_set_validator(&lobby, 9, &validator);
+	uint8_t checksum[CITRUS_FRAME_HEADER_SIZE * 5];
+	uint64_t values[2] = { 20, 0 };
+	n = Citrus_write_event(checksum, CITRUS_EVENT_CHECKSUM, 0, values, 2);
+	assert(CitrusServerLobby_recv(&lobby, n, checksum, 9));
+	assert(validator.tick == 0 && !validator.desynced);
+	uint8_t late[] = { 4, CITRUS_EVENT_INPUT, 0, 10, 1 };
+	assert(CitrusServerLobby_recv(&lobby, sizeof(late), late, 9));
+	assert(validator.tick == 10 && !validator.desynced);
+	late[3] = 11;
+	assert(CitrusServerLobby_recv(&lobby, sizeof(late), late, 9));
+	assert(validator.checked_tick == 20 && validator.desynced);
+}
+
+void parser_test(void)
+{
+	uint8_t buffer[PARSER_BUFFER_SIZE];
+	CitrusParser parser;
+	CitrusParser_init(&parser, buffer, sizeof(buffer));
+	CitrusFrame frame;
+
+	// contiguous frames are decoded in place
+	uint8_t data[] = { 2, 'h', 'i', 0, 1, 'x', 130, 1 };
+	CitrusParser_feed(&parser, sizeof(data), data);
+	assert(CitrusParser_next(&parser, &frame) == CITRUS_PARSER_FRAME);
+	assert(frame.data == data + 1 && frame.length == 2);
+	assert(CitrusParser_next(&parser, &frame) == CITRUS_PARSER_FRAME);
+	assert(frame.length == 0);
+	assert(CitrusParser_next(&parser, &frame) == CITRUS_PARSER_FRAME);
+	assert(frame.data == data + 5 && frame.length == 1);
+	// a frame of 130 bytes doesn't fit in the staging buffer
+	assert(CitrusParser_next(&parser, &frame) == CITRUS_PARSER_OVERFLOW);
+
+	// a split header is completed from the next read
+	CitrusParser_init(&parser, buffer, sizeof(buffer));
+	uint8_t first[] = { 130 };
+	uint8_t second[] = { 0, 'a', 'b', 3 };
+	CitrusParser_feed(&parser, sizeof(first), first);
+	assert(CitrusParser_next(&parser, &frame) == CITRUS_PARSER_EMPTY);
+	CitrusParser_feed(&parser, sizeof(second), second);
+	assert(CitrusParser_next(&parser, &frame) == CITRUS_PARSER_FRAME);
+	assert(frame.length == 2 && frame.data[0] == 'a');
+	assert(CitrusParser_next(&parser, &frame) == CITRUS_PARSER_EMPTY);
+	uint8_t third[] = { 'c', 'd', 'e' };
+	CitrusParser_feed(&parser, sizeof(third), third);
+	assert(CitrusParser_next(&parser, &frame) == CITRUS_PARSER_FRAME);
+	assert(frame.data == buffer + 1 && frame.length == 3);
+	assert(frame.data[2] == 'e');
+
+	uint8_t varint[CITRUS_FRAME_HEADER_SIZE];
+	uint64_t value;
+	int n = Citrus_write_varint(varint, 300);
+	assert(n == 2);
+	assert(Citrus_read_varint(varint, n, &value) == 2 && value == 300);
+	assert(Citrus_read_varint(varint, 1, &value) == 0);
+	n = Citrus_write_varint(varint, UINT64_MAX);
+	assert(n == CITRUS_FRAME_HEADER_SIZE);
+	assert(Citrus_read_varint(varint, n, &value) == n
+	       && value == UINT64_MAX);
+}
+
+typedef struct {
+	CitrusServerLobby server;
+	CitrusClientLobby client;
+	int bytes_sent;
+} SpectatorTest;
+
+// server sends to client 1 are received by the spectating client
+void spectator_server_send(void *send_data, int n, uint8_t *data, int id)
+{
+	SpectatorTest *test = send_data;
+	if (id == 1) {
+		test->bytes_sent += n;
+		assert(CitrusClientLobby_recv(&test->client, n, data));
+	}
+}
+
+void spectator_client_send(void *send_data, int n, uint8_t *data)
+{
+	SpectatorTest *test = send_data;
+	assert(CitrusServerLobby_recv(&test->server, n, data, 1));
+}
+
+void spectator_test(void)
+{
+	static SpectatorTest test;
+	CitrusLobbySlot slots[2];
+	int active_slots[2];
+	CitrusIdEntry connections[4];
+	CitrusParser parsers[2];
+	uint8_t parser_buffers[2 * PARSER_BUFFER_SIZE];
+	uint8_t output_buffers[2 * 1024];
+	uint8_t frames[2 * 10 * 40];
+	uint8_t board_buffer[1024];
+	assert(CitrusServerLobby_init(&test.server, slots, active_slots,
+				      connections, 4, parsers, parser_buffers,
+				      PARSER_BUFFER_SIZE, output_buffers, 1024,
+				      2, spectator_server_send, &test));
+	CitrusServerLobby_init_spectators(&test.server, frames, 10 * 40,
+					  board_buffer, sizeof(board_buffer),
+					  600);
+
+	CitrusLobbySlot client_slots[2];
+	int client_active_slots[2];
+	uint8_t client_parser_buffer[1024];
+	uint8_t input_buffer[32];
+	uint8_t spectated_board[10 * 40];
+	CitrusClientLobby_init(&test.client, client_slots, client_active_slots,
+			       2, client_parser_buffer,
+			       sizeof(client_parser_buffer), input_buffer,
+			       sizeof(input_buffer), spectator_client_send,
+			       &test);
+
+	CitrusServerLobby_client_connect(&test.server, 0);
+	CitrusServerLobby_client_connect(&test.server, 1);
+	LoopRandomizer randomizer_data = {.length = 3,.position = 0,.pieces =
+		    (const CitrusPiece *[]) {
+				       citrus_pieces + CITRUS_COLOR_I,
+				       citrus_pieces + CITRUS_COLOR_T,
+				       citrus_pieces + CITRUS_COLOR_O}
+	};
+	CitrusGame *game = &slots[0].game;
+	CitrusGame_init(game, board, next_piece_queue, &test_config,
+			&randomizer_data, NULL);
+	CitrusServerLobby_start_game(&test.server, 0);
+	CitrusClientLobby_spectate(&test.client, 0, spectated_board, 10, 40);
+	assert(slots[1].spectating == 0 && slots[0].first_spectator == 1);
+
+	const CitrusKey keys[] = {
+		CITRUS_KEY_LEFT, CITRUS_KEY_CLOCKWISE, CITRUS_KEY_HARD_DROP,
+		CITRUS_KEY_RIGHT, CITRUS_KEY_HARD_DROP, CITRUS_KEY_HOLD,
+		CITRUS_KEY_RIGHT, CITRUS_KEY_RIGHT, CITRUS_KEY_HARD_DROP
+	};
+	for (int tick = 0; tick < 400; tick++) {
+		if (tick % 20 == 0) {
+			CitrusGame_key_down(game, keys[tick / 20 % 9]);
+		}
+		CitrusServerLobby_tick(&test.server);
+		for (int i = 0; i < 10 * 40; i++) {
+			CitrusCell cell = board[i];
+			int expected = cell.type == CITRUS_CELL_FULL ?
+			    cell.color + 1 : 0;
+			assert(spectated_board[i] == expected);
+		}
+	}
+	// only changed rows are sent, so this is much less than a full board
+	// every tick
+	assert(test.bytes_sent > 0 && test.bytes_sent < 400 * 40);
+
+	CitrusServerLobby_client_disconnect(&test.server, 0);
+	assert(slots[1].spectating == -1);
+}
@@ -93,4 +93,17 @@ int main(void)
 	hard_drop_test();
 	rotation_test();
 	movement_test();
+	lobby_test();
+	parser_test();
+	spectator_test();
+	validator_test();
+	sync_test();
+	render_test();
+	trace_test();
+	random_test();
+	bot_test();
+	bitboard_test();
+	observation_test();
+	occupancy_test();
+	book_test();
 }
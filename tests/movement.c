@@ -30,7 +30,7 @@ void movement_test(void)
 	LoopRandomizer randomizer_data = {.length = 1,.position = 0,.pieces =
 		    (const CitrusPiece *[]) {citrus_pieces + CITRUS_COLOR_O}
 	};
-	CitrusGame_init(&game, board, next_piece_queue, test_config,
+	CitrusGame_init(&game, board, next_piece_queue, &test_config,
 			&randomizer_data, NULL);
 	int x = 4;
 	for (int i = 0; i < 4; i++) {
@@ -55,4 +55,54 @@ void movement_test(void)
 	clear_board();
 	set_o_piece(x, 21, CITRUS_CELL_FULL);
 	assert_expected();
+	CitrusGame_key_up(&game, CITRUS_KEY_RIGHT);
+
+	// a batch of inputs gives the same board as pressing them one by one
+	CitrusGame_init(&game, board, next_piece_queue, &test_config,
+			&randomizer_data, NULL);
+	CitrusInput inputs[] = {
+		{CITRUS_KEY_LEFT, true, 0},
+		{CITRUS_KEY_LEFT, true, 0},
+		{CITRUS_KEY_LEFT, false, 0},
+		{CITRUS_KEY_RIGHT, true, 0},
+	};
+	CitrusGame_apply_inputs(&game, inputs, 4);
+	clear_board();
+	set_o_piece(3, 21, CITRUS_CELL_FULL);
+	assert_expected();
+	assert(game.move_direction == 1);
+	CitrusGame_key_up(&game, CITRUS_KEY_RIGHT);
+
+	// a press late in a tick charges das from when it happened
+	CitrusGame_init(&game, board, next_piece_queue, &test_config,
+			&randomizer_data, NULL);
+	CitrusGame_key_down_at(&game, CITRUS_KEY_LEFT,
+			       test_config.subticks - 1);
+	assert(game.position.x == 3);
+	for (int i = 0; i < test_config.das; i++) {
+		CitrusGame_tick(&game);
+	}
+	assert(game.position.x == 3);
+	CitrusGame_tick(&game);
+	assert(game.position.x == 2);
+	for (int i = 0; i < test_config.arr; i++) {
+		CitrusGame_tick(&game);
+	}
+	assert(game.position.x == 1);
+
+	// holding into a blocked spawn tops out like spawning into it
+	CitrusGame_init(&game, board, next_piece_queue, &test_config,
+			&randomizer_data, NULL);
+	CitrusGame_key_down(&game, CITRUS_KEY_LEFT);
+	CitrusGame_key_up(&game, CITRUS_KEY_LEFT);
+	CitrusGame_key_down(&game, CITRUS_KEY_LEFT);
+	CitrusGame_key_up(&game, CITRUS_KEY_LEFT);
+	for (int y = 21; y < 23; y++) {
+		for (int x = 4; x < 6; x++) {
+			board[y * 10 + x].type = CITRUS_CELL_FULL;
+		}
+	}
+	assert(game.alive);
+	CitrusGame_key_down(&game, CITRUS_KEY_HOLD);
+	assert(!game.alive && game.held);
 }
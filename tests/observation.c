@@ -0,0 +1,129 @@
+/* Copyright (C) 2026 RZ781
+ *
+ * This file is part of libcitrus.
+ *
+ * libcitrus is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 2.1 of the License, or (at your option)
+ * any later version.
+ *
+ * libcitrus is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "citrus.h"
+#include "tests.h"
+
+uint8_t observation_stream[8192];
+int observation_stream_length;
+
+bool observation_write(void *data, const uint8_t *bytes, int n)
+{
+	(void)data;
+	for (int i = 0; i < n; i++) {
+		observation_stream[observation_stream_length++] = bytes[i];
+	}
+	return true;
+}
+
+// sum of n bytes
+int observation_sum(const uint8_t *bytes, int n)
+{
+	int sum = 0;
+	for (int i = 0; i < n; i++) {
+		sum += bytes[i];
+	}
+	return sum;
+}
+
+void observation_test(void)
+{
+	CitrusCell boards[2][10 * 40];
+	const CitrusPiece *queues[2][3];
+	CitrusBagRandomizer bags[2];
+	CitrusGame games[2];
+	for (int i = 0; i < 2; i++) {
+		CitrusBagRandomizer_init(&bags[i], 3 + i);
+		CitrusGame_init(&games[i], boards[i], queues[i],
+				&citrus_preset_modern, &bags[i], NULL);
+	}
+	CitrusObservationLayout layout;
+	CitrusObservationLayout_init(&layout, 10, 40, 3);
+	assert(layout.size == 800 + 7 + 8 + 21 + CITRUS_OBSERVATION_N_SCALARS);
+
+	// the current piece has its own plane, and pieces are one-hot
+	uint8_t observation[1000];
+	CitrusGame *game = &games[0];
+	CitrusGame_observe(game, &layout, observation);
+	assert(observation_sum(observation + layout.board, 400) == 0);
+	assert(observation_sum(observation + layout.piece, 400) == 4);
+	assert(observation_sum(observation + layout.current, 7) == 1);
+	assert(observation[layout.current +
+			   Citrus_piece_index(game->current_piece)] == 1);
+	assert(observation[layout.hold + 7] == 1);
+	for (int i = 0; i < 3; i++) {
+		uint8_t *one_hot = observation + layout.queue + 7 * i;
+		assert(observation_sum(one_hot, 7) == 1);
+		assert(one_hot[Citrus_piece_index(queues[0][i])] == 1);
+	}
+	uint8_t *scalars = observation + layout.scalars;
+	assert(scalars[CITRUS_OBSERVATION_ALIVE] == 1);
+	assert(scalars[CITRUS_OBSERVATION_LEVEL] == 1);
+	assert(scalars[CITRUS_OBSERVATION_LOCK_DELAY] == 30);
+
+	const CitrusPiece *held = game->current_piece;
+	CitrusGame_key_down(game, CITRUS_KEY_HOLD);
+	CitrusGame_key_down(game, CITRUS_KEY_HARD_DROP);
+	CitrusGame_observe(game, &layout, observation);
+	assert(observation_sum(observation + layout.board, 400) == 4);
+	assert(observation_sum(observation + layout.piece, 400) == 4);
+	assert(observation[layout.hold + Citrus_piece_index(held)] == 1);
+	for (int i = 0; i < 400; i++) {
+		assert(observation[layout.board + i] ==
+		       (boards[0][i].type == CITRUS_CELL_FULL
+			&& !observation[layout.piece + i]));
+	}
+
+	// a batch is the observations of each game one after another
+	uint8_t tensor[2000];
+	CitrusGame *batch[2] = { &games[1], &games[0] };
+	Citrus_observe_batch(batch, 2, &layout, tensor);
+	for (int i = 0; i < layout.size; i++) {
+		assert(tensor[layout.size + i] == observation[i]);
+	}
+
+	// records are buffered and written after the header
+	uint8_t buffer[1000];
+	CitrusRecordWriter writer;
+	int record_size = layout.size + 8;
+	assert(!CitrusRecordWriter_init(&writer, &layout, buffer,
+					CITRUS_RECORD_HEADER_SIZE + record_size
+					- 1, observation_write, NULL));
+	assert(CitrusRecordWriter_init(&writer, &layout, buffer,
+				       sizeof(buffer), observation_write,
+				       NULL));
+	for (int i = 0; i < 3; i++) {
+		assert(CitrusRecordWriter_add(&writer, game, i, -100 * i));
+	}
+	assert(CitrusRecordWriter_flush(&writer));
+	assert(observation_stream_length ==
+	       CITRUS_RECORD_HEADER_SIZE + 3 * record_size);
+	assert(observation_stream[0] == 'C' && observation_stream[3] == 'C');
+	assert(observation_stream[12] == (record_size & 0xff));
+	assert(observation_stream[13] == record_size >> 8);
+	uint8_t *last = observation_stream + CITRUS_RECORD_HEADER_SIZE +
+	    2 * record_size;
+	for (int i = 0; i < layout.size; i++) {
+		assert(last[i] == observation[i]);
+	}
+	assert(last[layout.size] == 2 && last[layout.size + 4] == 0x38);
+	assert(last[layout.size + 7] == 0xff);
+}
@@ -0,0 +1,102 @@
+/* Copyright (C) 2026 RZ781
+ *
+ * This file is part of libcitrus.
+ *
+ * libcitrus is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 2.1 of the License, or (at your option)
+ * any later version.
+ *
+ * libcitrus is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <assert.h>
+#include <stdint.h>
+#include "citrus.h"
+#include "tests.h"
+
+// check that a game's occupancy matches its full cells
+void occupancy_check(CitrusGame *game)
+{
+	int width = game->config->width;
+	int words = CITRUS_ROW_WORDS(width);
+	for (int y = 0; y < game->config->full_height; y++) {
+		for (int x = 0; x < width; x++) {
+			bool full = game->board[y * width + x].type ==
+			    CITRUS_CELL_FULL;
+			uint64_t word = game->occupancy[y * words + x / 64];
+			assert(full == ((word >> x % 64 & 1) != 0));
+		}
+	}
+}
+
+void occupancy_test(void)
+{
+	static CitrusCell boards[2][100 * 40];
+	static uint64_t occupancy[2 * 40];
+	const CitrusPiece *queues[2][3];
+	CitrusGame games[2];
+	CitrusBagRandomizer bags[2];
+
+	// games with and without occupancy play the same, including across
+	// word boundaries
+	int widths[] = { 10, 64, 100 };
+	for (int i = 0; i < 3; i++) {
+		CitrusGameConfig config = citrus_preset_modern;
+		config.width = widths[i];
+		for (int j = 0; j < 2; j++) {
+			CitrusBagRandomizer_init(&bags[j], 99);
+			CitrusGame_init(&games[j], boards[j], queues[j],
+					&config, &bags[j], NULL);
+		}
+		CitrusGame_set_occupancy(&games[1], occupancy);
+		uint64_t state = widths[i];
+		for (int tick = 0; tick < 5000 && games[0].alive; tick++) {
+			unsigned down = 0;
+			if (Citrus_random(&state) % 6 == 0) {
+				down = 1 << Citrus_random(&state) % 8;
+			}
+			for (int j = 0; j < 2; j++) {
+				CitrusGame_apply_masks(&games[j], down, down);
+				CitrusGame_tick(&games[j]);
+			}
+			assert(CitrusGame_checksum(&games[0]) ==
+			       CitrusGame_checksum(&games[1]));
+		}
+		occupancy_check(&games[1]);
+	}
+
+	// lines are cleared on wide boards
+	CitrusGameConfig config = citrus_preset_modern;
+	config.width = 100;
+	LoopRandomizer randomizer_data = {.length = 1,.position = 0,.pieces =
+		    (const CitrusPiece *[]) {citrus_pieces + CITRUS_COLOR_O}
+	};
+	config.randomizer = loop_randomizer;
+	CitrusGame *game = &games[0];
+	CitrusGame_init(game, boards[0], queues[0], &config, &randomizer_data,
+			NULL);
+	int x = game->position.x;
+	for (int y = 0; y < 2; y++) {
+		for (int i = 0; i < 100; i++) {
+			if (i < x || i > x + 1) {
+				boards[0][y * 100 + i] = (CitrusCell) {
+				CITRUS_COLOR_I, CITRUS_CELL_FULL};
+			}
+		}
+	}
+	CitrusGame_set_occupancy(game, occupancy);
+	occupancy_check(game);
+	CitrusGame_key_down(game, CITRUS_KEY_HARD_DROP);
+	assert(game->lines == 2);
+	occupancy_check(game);
+	for (int i = 0; i < 2 * 2; i++) {
+		assert(occupancy[i] == 0);
+	}
+}
@@ -0,0 +1,77 @@
+/* Copyright (C) 2026 RZ781
+ *
+ * This file is part of libcitrus.
+ *
+ * libcitrus is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 2.1 of the License, or (at your option)
+ * any later version.
+ *
+ * libcitrus is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <assert.h>
+#include <stdint.h>
+#include "citrus.h"
+#include "tests.h"
+
+void random_test(void)
+{
+	// jumping ahead matches generating every number
+	uint64_t state = 12345;
+	uint64_t skipped = 12345;
+	for (uint64_t k = 0; k < 300; k++) {
+		Citrus_random_skip(&skipped, k);
+		for (uint64_t i = 0; i < k; i++) {
+			Citrus_random(&state);
+		}
+		assert(state == skipped);
+	}
+
+	// skipping pieces matches taking them from the bag, whether or not
+	// the skip starts or ends on a bag boundary
+	for (int start = 0; start < 9; start++) {
+		for (int n = 0; n < 40; n++) {
+			CitrusBagRandomizer bag;
+			CitrusBagRandomizer skipped_bag;
+			CitrusBagRandomizer_init(&bag, 99);
+			CitrusBagRandomizer_init(&skipped_bag, 99);
+			for (int i = 0; i < start; i++) {
+				CitrusBagRandomizer_randomizer(&bag);
+				CitrusBagRandomizer_randomizer(&skipped_bag);
+			}
+			for (int i = 0; i < n; i++) {
+				CitrusBagRandomizer_randomizer(&bag);
+			}
+			CitrusBagRandomizer_skip(&skipped_bag, n);
+			for (int i = 0; i < 14; i++) {
+				assert(CitrusBagRandomizer_randomizer(&bag) ==
+				       CitrusBagRandomizer_randomizer
+				       (&skipped_bag));
+			}
+		}
+	}
+
+	// peeking doesn't change the randomizer
+	const CitrusPiece *pieces[10];
+	CitrusBagRandomizer bag;
+	CitrusBagRandomizer_init(&bag, 7);
+	CitrusBagRandomizer_randomizer(&bag);
+	CitrusBagRandomizer_peek(&bag, pieces, 10);
+	for (int i = 0; i < 10; i++) {
+		assert(CitrusBagRandomizer_randomizer(&bag) == pieces[i]);
+	}
+	CitrusClassicRandomizer classic;
+	CitrusClassicRandomizer_init(&classic, 7);
+	CitrusClassicRandomizer_peek(&classic, pieces, 10);
+	for (int i = 0; i < 10; i++) {
+		assert(CitrusClassicRandomizer_randomizer(&classic) ==
+		       pieces[i]);
+	}
+}
@@ -0,0 +1,85 @@
+/* Copyright (C) 2026 RZ781
+ *
+ * This file is part of libcitrus.
+ *
+ * libcitrus is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 2.1 of the License, or (at your option)
+ * any later version.
+ *
+ * libcitrus is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+#include "citrus.h"
+#include "tests.h"
+
+void render_test(void)
+{
+	uint8_t frames[2 * 10 * 4];
+	uint8_t frame[10 * 4] = { 0 };
+	uint8_t buffer[CITRUS_RENDER_BUFFER_SIZE(10, 4)];
+	CitrusRenderer renderer;
+	CitrusRenderer_init(&renderer, frames, 10, 4, 1, 1);
+
+	// the first frame draws every cell, after which nothing has changed
+	const char *start = "\033[1;1H\033[0m    ";
+	int n = CitrusRenderer_draw_frame(&renderer, frame, buffer,
+					  sizeof(buffer));
+	assert(n > 4 * 10 * 2);
+	assert(memcmp(buffer, start, strlen(start)) == 0);
+	assert(CitrusRenderer_draw_frame(&renderer, frame, buffer,
+					 sizeof(buffer)) == 0);
+
+	// a single changed cell only moves the cursor and draws that cell
+	frame[2] = CITRUS_COLOR_T + 1;
+	const char *expected = "\033[4;5H\033[0;48;5;129m  \033[0m";
+	n = CitrusRenderer_draw_frame(&renderer, frame, buffer,
+				      sizeof(buffer));
+	assert(n == (int)strlen(expected));
+	assert(memcmp(buffer, expected, n) == 0);
+
+	// nearby cells in the same style are redrawn instead of moving over
+	frame[3] = CITRUS_COLOR_T + 1;
+	frame[4] = CITRUS_COLOR_Z + 1;
+	frame[5] = CITRUS_COLOR_T + 1;
+	CitrusRenderer_draw_frame(&renderer, frame, buffer, sizeof(buffer));
+	frame[3] = CITRUS_COLOR_Z + 1;
+	frame[5] = CITRUS_COLOR_Z + 1;
+	expected = "\033[4;7H\033[0;48;5;196m      \033[0m";
+	n = CitrusRenderer_draw_frame(&renderer, frame, buffer,
+				      sizeof(buffer));
+	assert(n == (int)strlen(expected));
+	assert(memcmp(buffer, expected, n) == 0);
+
+	// running out of space redraws everything next time
+	frame[0] = CITRUS_COLOR_I + 1;
+	assert(CitrusRenderer_draw_frame(&renderer, frame, buffer, 8) == -1);
+	n = CitrusRenderer_draw_frame(&renderer, frame, buffer,
+				      sizeof(buffer));
+	assert(n > 4 * 10 * 2);
+
+	// games are drawn with their shadows
+	clear_board();
+	CitrusGame game;
+	LoopRandomizer randomizer_data = {.length = 1,.position = 0,.pieces =
+		    (const CitrusPiece *[]) {citrus_pieces + CITRUS_COLOR_O}
+	};
+	CitrusGameConfig config = test_config;
+	config.shadow = true;
+	CitrusGame_init(&game, board, next_piece_queue, &config,
+			&randomizer_data, NULL);
+	n = CitrusRenderer_draw_game(&renderer, &game, buffer, sizeof(buffer));
+	expected = "\033[0;38;5;226m[][]";
+	assert(n > 0 && n < (int)sizeof(buffer));
+	buffer[n] = 0;
+	assert(strstr((char *)buffer, expected) != NULL);
+}
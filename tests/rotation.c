@@ -30,7 +30,7 @@ void rotation_test(void)
 	LoopRandomizer randomizer_data = {.length = 1,.position = 0,.pieces =
 		    (const CitrusPiece *[]) {citrus_pieces + CITRUS_COLOR_T}
 	};
-	CitrusGame_init(&game, board, next_piece_queue, test_config,
+	CitrusGame_init(&game, board, next_piece_queue, &test_config,
 			&randomizer_data, NULL);
 
 	clear_board();
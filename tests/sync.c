@@ -0,0 +1,179 @@
+/* Copyright (C) 2026 RZ781
+ *
+ * This file is part of libcitrus.
+ *
+ * libcitrus is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 2.1 of the License, or (at your option)
+ * any later version.
+ *
+ * libcitrus is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "citrus.h"
+#include "tests.h"
+
+void sync_test(void)
+{
+	clear_board();
+	CitrusGame game;
+	LoopRandomizer randomizer_data = {.length = 1,.position = 0,.pieces =
+		    (const CitrusPiece *[]) {citrus_pieces + CITRUS_COLOR_O}
+	};
+	CitrusGame_init(&game, board, next_piece_queue, &test_config,
+			&randomizer_data, NULL);
+
+	// inputs are only applied once their time has been reached
+	CitrusTimedInput inputs[4];
+	CitrusInputQueue queue;
+	CitrusInputQueue_init(&queue, inputs, 4);
+	assert(CitrusInputQueue_push(&queue, CITRUS_KEY_LEFT, true, 10));
+	assert(CitrusInputQueue_push(&queue, CITRUS_KEY_LEFT, false, 20));
+	assert(CitrusInputQueue_push(&queue, CITRUS_KEY_LEFT, true, 30));
+	assert(CitrusInputQueue_push(&queue, CITRUS_KEY_LEFT, false, 40));
+	assert(!CitrusInputQueue_push(&queue, CITRUS_KEY_LEFT, true, 50));
+	assert(CitrusInputQueue_apply(&queue, &game, 0, 1) == 0);
+	assert(CitrusInputQueue_apply(&queue, &game, 5, 5) == 2);
+	assert(game.position.x == 3);
+	assert(CitrusInputQueue_push(&queue, CITRUS_KEY_HOLD, true, 50));
+	assert(CitrusInputQueue_apply(&queue, &game, 25, 5) == 2);
+	assert(game.position.x == 2);
+	CitrusTimedInput input;
+	assert(CitrusInputQueue_pop(&queue, &input, 50));
+	assert(input.key == CITRUS_KEY_HOLD && input.down && input.time == 50);
+	assert(!CitrusInputQueue_pop(&queue, &input, 100));
+
+	// a press in the middle of a tick moves the piece the same as
+	// applying it directly with the offset of its subtick, and later than
+	// a press at the start of the tick
+	CitrusGame direct;
+	CitrusGame early;
+	CitrusCell direct_board[10 * 40];
+	CitrusCell early_board[10 * 40];
+	const CitrusPiece *direct_queue[3];
+	const CitrusPiece *early_queue[3];
+	LoopRandomizer direct_randomizer = randomizer_data;
+	LoopRandomizer early_randomizer = randomizer_data;
+	CitrusGame_init(&game, board, next_piece_queue, &test_config,
+			&randomizer_data, NULL);
+	CitrusGame_init(&direct, direct_board, direct_queue, &test_config,
+			&direct_randomizer, NULL);
+	CitrusGame_init(&early, early_board, early_queue, &test_config,
+			&early_randomizer, NULL);
+	assert(CitrusInputQueue_push(&queue, CITRUS_KEY_RIGHT, true, 1070));
+	assert(CitrusInputQueue_apply(&queue, &game, 1000, 25) == 1);
+	CitrusGame_key_down_at(&direct, CITRUS_KEY_RIGHT, 2);
+	CitrusGame_key_down(&early, CITRUS_KEY_RIGHT);
+	bool behind = false;
+	for (int tick = 0; tick < 20; tick++) {
+		CitrusGame_tick(&game);
+		CitrusGame_tick(&direct);
+		CitrusGame_tick(&early);
+		assert(game.position.x == direct.position.x);
+		assert(game.position.x <= early.position.x);
+		behind = behind || game.position.x < early.position.x;
+	}
+	assert(behind);
+
+	// nothing has been published yet so the reader sees an empty board
+	uint8_t cells[3 * 10 * 40];
+	const CitrusPiece *next_pieces[3 * 3];
+	CitrusSnapshotBuffer buffer;
+	CitrusSnapshotBuffer_init(&buffer, cells, next_pieces, 10, 40, 3);
+	const CitrusSnapshot *snapshot = CitrusSnapshotBuffer_read(&buffer);
+	assert(snapshot->current_piece == NULL);
+
+	// the current piece is kept out of the locked cells
+	CitrusGame_key_down(&game, CITRUS_KEY_HARD_DROP);
+	CitrusGame_snapshot(&game, CitrusSnapshotBuffer_back(&buffer));
+	CitrusSnapshotBuffer_publish(&buffer);
+	snapshot = CitrusSnapshotBuffer_read(&buffer);
+	assert(snapshot->current_piece == game.current_piece);
+	assert(snapshot->next_pieces[0] == next_piece_queue[0]);
+	int filled = 0;
+	for (int i = 0; i < 10 * 40; i++) {
+		if (snapshot->cells[i] != 0) {
+			assert(snapshot->cells[i] == CITRUS_COLOR_O + 1);
+			filled++;
+		}
+	}
+	assert(filled == 4);
+	CitrusGame_key_down(&game, CITRUS_KEY_SOFT_DROP);
+	assert(snapshot->ghost_y == game.position.y);
+	assert(CitrusSnapshotBuffer_read(&buffer) == snapshot);
+
+	// the reader skips to the latest snapshot
+	CitrusSnapshotBuffer_back(&buffer)->score = 1;
+	CitrusSnapshotBuffer_publish(&buffer);
+	CitrusSnapshotBuffer_back(&buffer)->score = 2;
+	CitrusSnapshotBuffer_publish(&buffer);
+	assert(CitrusSnapshotBuffer_back(&buffer) != snapshot);
+	snapshot = CitrusSnapshotBuffer_read(&buffer);
+	assert(snapshot->score == 2);
+
+	// moving the piece only marks the rows it was drawn on
+	CitrusGame_clear_dirty_rows(&game);
+	CitrusGame_key_down(&game, CITRUS_KEY_RIGHT);
+	CitrusGame_key_up(&game, CITRUS_KEY_RIGHT);
+	uint64_t rows = CitrusGame_get_dirty_rows(&game);
+	assert(rows == (uint64_t) 3 << game.position.y);
+	assert(Citrus_row_dirty(rows, game.position.y + 1));
+	assert(!Citrus_row_dirty(rows, game.position.y + 2));
+	assert(Citrus_row_dirty((uint64_t) 1 << 63, 100));
+	CitrusGame_clear_dirty_rows(&game);
+	CitrusGame_tick(&game);
+	assert(CitrusGame_get_dirty_rows(&game) == 0);
+
+	// snapshots copying only dirty rows match full snapshots while
+	// pieces move, lock and clear lines
+	clear_board();
+	CitrusGame_init(&game, board, next_piece_queue, &test_config,
+			&randomizer_data, NULL);
+	CitrusSnapshotBuffer_init(&buffer, cells, next_pieces, 10, 40, 3);
+	uint8_t full_cells[10 * 40];
+	CitrusSnapshot full = buffer.snapshots[0];
+	full.cells = full_cells;
+	for (int tick = 0; tick < 5000; tick++) {
+		// line up o pieces in columns so that rows get cleared, letting
+		// every other piece lock by itself
+		int piece = tick / 100;
+		int phase = tick % 100;
+		if (phase < 5) {
+			CitrusGame_key_down(&game, CITRUS_KEY_LEFT);
+			CitrusGame_key_up(&game, CITRUS_KEY_LEFT);
+		} else if (phase < 5 + piece % 5 * 2) {
+			CitrusGame_key_down(&game, CITRUS_KEY_RIGHT);
+			CitrusGame_key_up(&game, CITRUS_KEY_RIGHT);
+		} else if (phase < 19) {
+			CitrusGame_key_down(&game, CITRUS_KEY_CLOCKWISE);
+			CitrusGame_key_up(&game, CITRUS_KEY_CLOCKWISE);
+		} else if (phase == 19) {
+			CitrusGame_key_down(&game, piece % 2 ?
+					    CITRUS_KEY_SOFT_DROP :
+					    CITRUS_KEY_HARD_DROP);
+		} else if (phase == 20) {
+			CitrusGame_key_up(&game, CITRUS_KEY_SOFT_DROP);
+			CitrusGame_key_up(&game, CITRUS_KEY_HARD_DROP);
+		}
+		CitrusGame_tick(&game);
+		CitrusSnapshotBuffer_write(&buffer, &game);
+		CitrusGame_snapshot(&game, &full);
+		snapshot = CitrusSnapshotBuffer_back(&buffer);
+		for (int i = 0; i < 10 * 40; i++) {
+			assert(snapshot->cells[i] == full_cells[i]);
+		}
+		CitrusSnapshotBuffer_publish(&buffer);
+		CitrusGame_clear_dirty_rows(&game);
+	}
+	assert(game.alive && game.lines > 0);
+}
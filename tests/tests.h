@@ -43,5 +43,18 @@ const CitrusPiece *loop_randomizer(void *data);
 void hard_drop_test(void);
 void movement_test(void);
 void rotation_test(void);
+void lobby_test(void);
+void parser_test(void);
+void spectator_test(void);
+void validator_test(void);
+void sync_test(void);
+void render_test(void);
+void trace_test(void);
+void random_test(void);
+void bot_test(void);
+void bitboard_test(void);
+void observation_test(void);
+void occupancy_test(void);
+void book_test(void);
 
 #endif
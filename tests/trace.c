@@ -0,0 +1,132 @@
+/* Copyright (C) 2026 RZ781
+ *
+ * This file is part of libcitrus.
+ *
+ * libcitrus is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 2.1 of the License, or (at your option)
+ * any later version.
+ *
+ * libcitrus is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "citrus.h"
+#include "tests.h"
+
+#define TRACE_LOBBY_CAPACITY 4
+
+// clock which advances by one on every call
+uint64_t trace_clock(void *data)
+{
+	uint64_t *time = data;
+	return (*time)++;
+}
+
+// discard data sent to clients
+void trace_send(void *send_data, int n, uint8_t *data, int id)
+{
+	(void)send_data;
+	(void)n;
+	(void)data;
+	(void)id;
+}
+
+// check if a name and phase appear in a list of records
+bool trace_contains(const CitrusTraceRecord *records, int n,
+		    CitrusTraceName name, CitrusTracePhase phase, int id)
+{
+	for (int i = 0; i < n; i++) {
+		if (records[i].name == name && records[i].phase == phase
+		    && records[i].id == id) {
+			return true;
+		}
+	}
+	return false;
+}
+
+void trace_test(void)
+{
+	CitrusLobbySlot slots[TRACE_LOBBY_CAPACITY];
+	int active_slots[TRACE_LOBBY_CAPACITY];
+	CitrusIdEntry connections[8];
+	CitrusParser parsers[TRACE_LOBBY_CAPACITY];
+	uint8_t parser_buffers[TRACE_LOBBY_CAPACITY * 16];
+	uint8_t output_buffers[TRACE_LOBBY_CAPACITY * 64];
+	CitrusServerLobby lobby;
+	assert(CitrusServerLobby_init(&lobby, slots, active_slots, connections,
+				      8, parsers, parser_buffers, 16,
+				      output_buffers, 64, TRACE_LOBBY_CAPACITY,
+				      trace_send, NULL));
+	uint64_t time = 0;
+	CitrusTraceRecord records[64];
+	CitrusTracer tracer;
+	CitrusTracer_init(&tracer, records, 64, trace_clock, &time);
+	CitrusServerLobby_set_tracer(&lobby, &tracer);
+
+	CitrusServerLobby_client_connect(&lobby, 5);
+	CitrusLobbySlot *slot = CitrusServerLobby_get_slot(&lobby, 5);
+	int index = slot - slots;
+	LoopRandomizer randomizer_data = {.length = 1,.position = 0,.pieces =
+		    (const CitrusPiece *[]) {citrus_pieces + CITRUS_COLOR_O}
+	};
+	CitrusGame_init(&slot->game, board, next_piece_queue, &test_config,
+			&randomizer_data, NULL);
+	CitrusServerLobby_start_game(&lobby, 5);
+
+	// a hard drop is traced inside the tick that applies it
+	uint8_t input_buffer[32];
+	CitrusInputEncoder encoder;
+	CitrusInputEncoder_init(&encoder, input_buffer, sizeof(input_buffer),
+				0);
+	unsigned hard_drop = 1 << CITRUS_KEY_HARD_DROP;
+	CitrusInputEncoder_add(&encoder, 1, hard_drop, hard_drop);
+	uint8_t *data;
+	int n = CitrusInputEncoder_finish(&encoder, &data);
+	assert(CitrusServerLobby_recv(&lobby, n, data, 5));
+	CitrusServerLobby_tick(&lobby);
+	CitrusServerLobby_tick(&lobby);
+
+	CitrusTraceRecord copy[64];
+	n = CitrusTracer_copy(&tracer, copy, 64);
+	assert(n == (int)tracer.count);
+	assert(copy[0].name == CITRUS_TRACE_RECV);
+	assert(copy[0].phase == CITRUS_TRACE_BEGIN);
+	assert(copy[0].id == index);
+	assert(trace_contains(copy, n, CITRUS_TRACE_PARSE, CITRUS_TRACE_END,
+			      index));
+	assert(trace_contains(copy, n, CITRUS_TRACE_LOCK, CITRUS_TRACE_END,
+			      index));
+	assert(trace_contains(copy, n, CITRUS_TRACE_TICK, CITRUS_TRACE_BEGIN,
+			      -1));
+	assert(trace_contains(copy, n, CITRUS_TRACE_SEND, CITRUS_TRACE_END,
+			      index));
+	assert(copy[n - 1].name == CITRUS_TRACE_TICK);
+	assert(copy[n - 1].phase == CITRUS_TRACE_END);
+	for (int i = 1; i < n; i++) {
+		assert(copy[i].time > copy[i - 1].time);
+	}
+
+	// once the buffer wraps only the newest records are kept
+	for (int i = 0; i < 100; i++) {
+		CitrusServerLobby_tick(&lobby);
+	}
+	n = CitrusTracer_copy(&tracer, copy, 64);
+	assert(n == 64);
+	assert(copy[63].time == time - 1);
+
+	// nothing is recorded once tracing is disabled
+	CitrusServerLobby_set_tracer(&lobby, NULL);
+	uint64_t count = tracer.count;
+	CitrusServerLobby_tick(&lobby);
+	assert(tracer.count == count);
+}
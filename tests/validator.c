@@ -0,0 +1,103 @@
+/* Copyright (C) 2026 RZ781
+ *
+ * This file is part of libcitrus.
+ *
+ * libcitrus is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 2.1 of the License, or (at your option)
+ * any later version.
+ *
+ * libcitrus is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include "citrus.h"
+#include "tests.h"
+
+void validator_test(void)
+{
+	CitrusGame game;
+	CitrusBagRandomizer bag;
+	CitrusBagRandomizer_init(&bag, 1234);
+	CitrusGame_init(&game, board, next_piece_queue, &citrus_preset_modern,
+			&bag, NULL);
+
+	CitrusValidator validator;
+	CitrusCell validator_board[10 * 40];
+	const CitrusPiece *validator_queue[3];
+	CitrusBagRandomizer validator_bag;
+	CitrusBagRandomizer_init(&validator_bag, 1234);
+	CitrusValidator_init(&validator, validator_board, validator_queue,
+			     &citrus_preset_modern, &validator_bag);
+
+	// play with random inputs, holding movement keys for a while so the
+	// validator has to replay das and soft drop as well as idle ticks
+	uint64_t state = 42;
+	int release_tick[8] = { 0 };
+	bool held[8] = { false };
+	for (int tick = 0; tick < 20000 && CitrusGame_is_alive(&game); tick++) {
+		unsigned down = 0;
+		unsigned up = 0;
+		for (int key = 0; key < 8; key++) {
+			if (held[key] && release_tick[key] == tick) {
+				held[key] = false;
+				up |= 1 << key;
+			}
+		}
+		if (Citrus_random(&state) % 40 == 0) {
+			int key = Citrus_random(&state) % 8;
+			if (!held[key]) {
+				held[key] = true;
+				down |= 1 << key;
+				release_tick[key] =
+				    tick + 1 + Citrus_random(&state) % 30;
+			}
+		}
+		for (int key = 0; key < 8; key++) {
+			if (down & 1 << key) {
+				CitrusGame_key_down(&game, key);
+			}
+			if (up & 1 << key) {
+				CitrusGame_key_up(&game, key);
+			}
+		}
+		if (down || up) {
+			CitrusValidator_input(&validator, tick, down, up);
+		}
+		if (tick % 97 == 0) {
+			assert(CitrusValidator_check(&validator, tick,
+						     CitrusGame_checksum
+						     (&game)));
+		}
+		CitrusGame_tick(&game);
+	}
+	assert(game.lines > 0 || game.score > 0);
+	assert(!validator.desynced);
+
+	// checksums for ticks already replayed past are ignored
+	int checked_tick = validator.checked_tick;
+	assert(CitrusValidator_check(&validator, validator.tick - 1, 0));
+	assert(!validator.desynced && validator.checked_tick == checked_tick);
+
+	// a wrong checksum is detected
+	assert(!CitrusValidator_check(&validator, validator.tick,
+				      CitrusGame_checksum(&game) + 1));
+	assert(validator.desynced);
+
+	// ticks too far ahead to replay cheaply are refused
+	int tick = validator.tick;
+	validator.desynced = false;
+	CitrusValidator_input(&validator, tick + CITRUS_VALIDATOR_MAX_SKIP + 1,
+			      1 << CITRUS_KEY_LEFT, 0);
+	assert(validator.desynced && validator.tick == tick);
+	assert(!CitrusValidator_check(&validator, INT32_MAX, 0));
+	assert(validator.tick == tick);
+}
@@ -0,0 +1,163 @@
+/* Copyright (C) 2026 RZ781
+ *
+ * This file is part of libcitrus.
+ *
+ * libcitrus is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 2.1 of the License, or (at your option)
+ * any later version.
+ *
+ * libcitrus is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// Opening book builder. Games are played by the bot with its full search
+// from seeds passed to CitrusBagRandomizer_init, and the placement it
+// chooses for each of the first pieces is stored under the key of the
+// state it was chosen from. Keys reached by more than one game keep the
+// first placement found, which is the same one as the search is
+// deterministic. The book can be loaded by mapping the file and passing
+// it to CitrusBook_init.
+//
+// usage: bookgen [-g games] [-p pieces per game] [-n next pieces in key]
+//                [-b beam width] [-d depth] [-s first seed] -o file
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "citrus.h"
+
+#define QUEUE_SIZE 5
+#define ARENA_SIZE (4 << 20)
+
+// orders entries by key
+int bookgen_compare(const void *a, const void *b)
+{
+	uint64_t x = ((const CitrusBookEntry *)a)->key;
+	uint64_t y = ((const CitrusBookEntry *)b)->key;
+	return (x > y) - (x < y);
+}
+
+int main(int argc, char **argv)
+{
+	int n_games = 1000;
+	int n_pieces = 10;
+	int n_next = 3;
+	int beam_width = 32;
+	int depth = 3;
+	int first_seed = 0;
+	const char *path = NULL;
+	int option;
+	while ((option = getopt(argc, argv, "g:p:n:b:d:s:o:")) != -1) {
+		switch (option) {
+		case 'g':
+			n_games = atoi(optarg);
+			break;
+		case 'p':
+			n_pieces = atoi(optarg);
+			break;
+		case 'n':
+			n_next = atoi(optarg);
+			break;
+		case 'b':
+			beam_width = atoi(optarg);
+			break;
+		case 'd':
+			depth = atoi(optarg);
+			break;
+		case 's':
+			first_seed = atoi(optarg);
+			break;
+		case 'o':
+			path = optarg;
+			break;
+		default:
+			path = NULL;
+			n_games = 0;
+			break;
+		}
+	}
+	if (path == NULL || n_games < 1 || n_pieces < 1 || beam_width < 1
+	    || depth < 1 || n_next < 0 || n_next >= QUEUE_SIZE) {
+		fprintf(stderr, "usage: %s [-g games] [-p pieces per game] "
+			"[-n next pieces in key, below %d] [-b beam width] "
+			"[-d depth] [-s first seed] -o file\n", argv[0],
+			QUEUE_SIZE);
+		return 1;
+	}
+
+	size_t capacity = (size_t)n_games * n_pieces;
+	CitrusBookEntry *entries = malloc(capacity * sizeof(*entries));
+	uint8_t *arena_memory = malloc(ARENA_SIZE);
+	if (!entries || !arena_memory) {
+		fprintf(stderr, "%s: out of memory\n", argv[0]);
+		return 1;
+	}
+	CitrusArena arena;
+	CitrusArena_init(&arena, arena_memory, ARENA_SIZE);
+	CitrusBot bot;
+	CitrusBot_init(&bot, beam_width, depth);
+	CitrusGameConfig config = citrus_preset_modern;
+	config.next_piece_queue_size = QUEUE_SIZE;
+	size_t n_entries = 0;
+	for (int seed = first_seed; seed < first_seed + n_games; seed++) {
+		CitrusCell board[10 * 40];
+		const CitrusPiece *queue[QUEUE_SIZE];
+		CitrusBagRandomizer bag;
+		CitrusBagRandomizer_init(&bag, seed);
+		CitrusGame game;
+		CitrusGame_init(&game, board, queue, &config, &bag, NULL);
+		for (int piece = 0; piece < n_pieces && game.alive; piece++) {
+			CitrusBotMove move;
+			if (!CitrusBot_plan(&bot, &game, &arena, &move))
+				break;
+			CitrusBookEntry *entry = &entries[n_entries++];
+			entry->key = CitrusBot_book_key(&bot, n_next);
+			entry->value = move.value;
+			entry->x = move.position.x;
+			entry->y = move.position.y;
+			entry->rotation = move.rotation;
+			entry->hold = move.hold;
+			CitrusBotMove_apply(&move, &game);
+			while (game.alive && game.line_clear_delay > 0)
+				CitrusGame_tick(&game);
+		}
+	}
+
+	qsort(entries, n_entries, sizeof(*entries), bookgen_compare);
+	size_t n_unique = 0;
+	for (size_t i = 0; i < n_entries; i++) {
+		if (n_unique > 0 && entries[i].key == entries[n_unique - 1].key)
+			continue;
+		entries[n_unique++] = entries[i];
+	}
+	size_t size = CITRUS_BOOK_HEADER_SIZE +
+	    n_unique * CITRUS_BOOK_ENTRY_SIZE;
+	uint8_t *data = malloc(size);
+	if (!data) {
+		fprintf(stderr, "%s: out of memory\n", argv[0]);
+		return 1;
+	}
+	if (CitrusBook_write(data, size, entries, n_unique, n_next) != size) {
+		fprintf(stderr, "%s: failed to encode the book\n", argv[0]);
+		return 1;
+	}
+	FILE *file = fopen(path, "wb");
+	if (!file || fwrite(data, 1, size, file) != size || fclose(file)) {
+		perror(path);
+		return 1;
+	}
+	printf("%zu placements from %d games, %zu unique, %zu bytes\n",
+	       n_entries, n_games, n_unique, size);
+	free(data);
+	free(entries);
+	free(arena_memory);
+	return 0;
+}
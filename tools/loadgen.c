@@ -0,0 +1,528 @@
+/* Copyright (C) 2026 RZ781
+ *
+ * This file is part of libcitrus.
+ *
+ * libcitrus is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 2.1 of the License, or (at your option)
+ * any later version.
+ *
+ * libcitrus is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// Load generator for servers built on CitrusServerLobby. A server using the
+// threaded driver and thousands of simulated clients run in one process,
+// talking over Unix domain sockets, or loopback TCP if a port is given.
+// Each client taps a random key every tick, and the time from sending an
+// input to receiving the ACK covering it is recorded.
+//
+// usage: loadgen [-c clients] [-l clients per lobby] [-w workers]
+//                [-j client threads] [-s seconds] [-p port]
+
+#define _GNU_SOURCE
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+#include "citrus.h"
+#include "citrus_driver.h"
+
+#define TICK_RATE 60
+#define MESSAGE_SIZE 4096
+#define ENCODER_BUFFER_SIZE 32
+#define PARSER_BUFFER_SIZE 64
+#define SENT_TIMES 256		// ticks of send times kept per client
+#define HISTOGRAM_SIZE 1000000	// one bucket per microsecond up to a second
+
+typedef struct {
+	CitrusCell board[10 * 40];
+	const CitrusPiece *queue[3];
+	CitrusBagRandomizer bag;
+} LoadgenGame;
+
+typedef struct {
+	int fd;
+	CitrusInputEncoder encoder;
+	uint8_t encoder_buffer[ENCODER_BUFFER_SIZE];
+	CitrusParser parser;
+	uint8_t parser_buffer[PARSER_BUFFER_SIZE];
+	uint64_t sent_times[SENT_TIMES];
+	int acked_tick;
+	uint64_t state;
+} LoadgenClient;
+
+typedef struct {
+	pthread_t thread;
+	LoadgenClient *clients;
+	int n_clients;
+	uint32_t *histogram;	// latencies in microseconds
+	uint64_t samples;
+	uint64_t bytes_sent;
+	uint64_t bytes_received;
+	uint64_t errors;
+} LoadgenClientThread;
+
+CitrusServer server;
+LoadgenGame *games;
+int *fd_lobbies;		// lobby of each server side connection
+int max_fds;
+int listen_fd;
+int port;
+int seconds = 10;
+struct sockaddr_un unix_address;
+uint64_t server_bytes_sent;
+uint64_t server_bytes_received;
+uint64_t server_send_errors;
+bool stopping;
+
+// returns the current time in nanoseconds
+uint64_t loadgen_time(void)
+{
+	struct timespec time;
+	clock_gettime(CLOCK_MONOTONIC, &time);
+	return (uint64_t) time.tv_sec * 1000000000 + time.tv_nsec;
+}
+
+// prints an error and exits
+void loadgen_fail(const char *message)
+{
+	perror(message);
+	exit(1);
+}
+
+// sends data to a client from a server worker thread
+void loadgen_send(void *data, int n, uint8_t *bytes, int id)
+{
+	(void)data;
+	ssize_t sent = send(id, bytes, n, MSG_DONTWAIT | MSG_NOSIGNAL);
+	if (sent != n) {
+		// a real server would buffer the rest, but a client that
+		// can't keep up is worth reporting rather than hiding
+		__atomic_fetch_add(&server_send_errors, 1, __ATOMIC_RELAXED);
+		if (sent <= 0)
+			return;
+	}
+	__atomic_fetch_add(&server_bytes_sent, sent, __ATOMIC_RELAXED);
+}
+
+// starts a game for each client as it connects
+void loadgen_connect(void *data, CitrusServerLobby *lobby, int id)
+{
+	(void)data;
+	CitrusLobbySlot *slot = CitrusServerLobby_get_slot(lobby, id);
+	int index = (lobby - server.lobbies) * server.config.lobby_capacity
+	    + (slot - lobby->lobby.slots);
+	LoadgenGame *game = &games[index];
+	CitrusBagRandomizer_init(&game->bag, index);
+	CitrusGame_init(&slot->game, game->board, game->queue,
+			&citrus_preset_modern, &game->bag, NULL);
+	CitrusServerLobby_start_game(lobby, id);
+}
+
+// creates the listening socket
+void loadgen_listen(void)
+{
+	if (port) {
+		struct sockaddr_in address = { 0 };
+		address.sin_family = AF_INET;
+		address.sin_port = htons(port);
+		address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+		int one = 1;
+		setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &one,
+			   sizeof(one));
+		if (bind(listen_fd, (struct sockaddr *)&address,
+			 sizeof(address)))
+			loadgen_fail("bind");
+	} else {
+		unix_address.sun_family = AF_UNIX;
+		snprintf(unix_address.sun_path, sizeof(unix_address.sun_path),
+			 "/tmp/citrus-loadgen-%d.sock", getpid());
+		unlink(unix_address.sun_path);
+		listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+		if (bind(listen_fd, (struct sockaddr *)&unix_address,
+			 sizeof(unix_address)))
+			loadgen_fail("bind");
+	}
+	if (listen(listen_fd, 4096))
+		loadgen_fail("listen");
+}
+
+// connects a client to the server
+int loadgen_dial(void)
+{
+	int fd;
+	if (port) {
+		struct sockaddr_in address = { 0 };
+		address.sin_family = AF_INET;
+		address.sin_port = htons(port);
+		address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		fd = socket(AF_INET, SOCK_STREAM, 0);
+		int one = 1;
+		setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+		if (fd < 0 || connect(fd, (struct sockaddr *)&address,
+				      sizeof(address)))
+			loadgen_fail("connect");
+	} else {
+		fd = socket(AF_UNIX, SOCK_STREAM, 0);
+		if (fd < 0 || connect(fd, (struct sockaddr *)&unix_address,
+				      sizeof(unix_address)))
+			loadgen_fail("connect");
+	}
+	fcntl(fd, F_SETFL, O_NONBLOCK);
+	return fd;
+}
+
+// accepts connections and hands received data to the server's workers
+void *loadgen_server_io(void *data)
+{
+	(void)data;
+	int epoll_fd = epoll_create1(0);
+	struct epoll_event event = {.events = EPOLLIN,.data.fd = listen_fd };
+	epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listen_fd, &event);
+	int capacity = server.config.lobby_capacity;
+	int n_accepted = 0;
+	uint8_t buffer[MESSAGE_SIZE];
+	struct epoll_event events[256];
+	while (!__atomic_load_n(&stopping, __ATOMIC_ACQUIRE)) {
+		int n = epoll_wait(epoll_fd, events, 256, 10);
+		for (int i = 0; i < n; i++) {
+			int fd = events[i].data.fd;
+			if (fd == listen_fd) {
+				int client = accept(listen_fd, NULL, NULL);
+				if (client < 0)
+					continue;
+				if (client >= max_fds) {
+					close(client);
+					continue;
+				}
+				fcntl(client, F_SETFL, O_NONBLOCK);
+				int lobby = n_accepted++ / capacity;
+				fd_lobbies[client] = lobby;
+				while (!CitrusServer_connect(&server, 0, lobby,
+							     client)) ;
+				event.events = EPOLLIN;
+				event.data.fd = client;
+				epoll_ctl(epoll_fd, EPOLL_CTL_ADD, client,
+					  &event);
+				continue;
+			}
+			ssize_t length = recv(fd, buffer, sizeof(buffer), 0);
+			if (length <= 0) {
+				if (length < 0 && errno == EAGAIN)
+					continue;
+				epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+				while (!CitrusServer_disconnect
+				       (&server, 0, fd_lobbies[fd], fd)) ;
+				continue;
+			}
+			server_bytes_received += length;
+			while (!CitrusServer_recv(&server, 0, fd_lobbies[fd],
+						  fd, length, buffer)) ;
+		}
+	}
+	close(epoll_fd);
+	return NULL;
+}
+
+// reads ACKs for a client and records the latency of each acked input
+void loadgen_client_read(LoadgenClientThread *thread, LoadgenClient *client,
+			 uint64_t now)
+{
+	uint8_t buffer[MESSAGE_SIZE];
+	ssize_t length;
+	while ((length = recv(client->fd, buffer, sizeof(buffer), 0)) > 0) {
+		thread->bytes_received += length;
+		CitrusParser_feed(&client->parser, length, buffer);
+		CitrusFrame frame;
+		CitrusParserStatus status;
+		while ((status = CitrusParser_next(&client->parser, &frame))
+		       == CITRUS_PARSER_FRAME) {
+			if (frame.length < 1
+			    || frame.data[0] != CITRUS_EVENT_ACK)
+				continue;
+			uint64_t id, tick;
+			int n = Citrus_read_varint(frame.data + 1,
+						   frame.length - 1, &id);
+			if (n <= 0 || Citrus_read_varint(frame.data + 1 + n,
+							 frame.length - 1 - n,
+							 &tick) <= 0)
+				continue;
+			for (int t = client->acked_tick + 1; t <= (int)tick;
+			     t++) {
+				uint64_t sent = client->sent_times[t %
+								   SENT_TIMES];
+				uint64_t latency = (now - sent) / 1000;
+				if (latency >= HISTOGRAM_SIZE)
+					latency = HISTOGRAM_SIZE - 1;
+				thread->histogram[latency]++;
+				thread->samples++;
+			}
+			if ((int)tick > client->acked_tick)
+				client->acked_tick = tick;
+		}
+		if (status == CITRUS_PARSER_INVALID) {
+			thread->errors++;
+			CitrusParser_init(&client->parser,
+					  client->parser_buffer,
+					  PARSER_BUFFER_SIZE);
+		}
+	}
+}
+
+// simulates a group of clients, each sending one input batch per tick
+void *loadgen_client_run(void *data)
+{
+	LoadgenClientThread *thread = data;
+	int epoll_fd = epoll_create1(0);
+	for (int i = 0; i < thread->n_clients; i++) {
+		struct epoll_event event = {.events = EPOLLIN,.data.u32 = i };
+		epoll_ctl(epoll_fd, EPOLL_CTL_ADD, thread->clients[i].fd,
+			  &event);
+	}
+	struct epoll_event events[256];
+	uint64_t interval = 1000000000 / TICK_RATE;
+	uint64_t deadline = loadgen_time();
+	int n_ticks = seconds * TICK_RATE;
+	for (int tick = 1; tick <= n_ticks; tick++) {
+		for (int i = 0; i < thread->n_clients; i++) {
+			LoadgenClient *client = &thread->clients[i];
+			// tap a random key, mostly moves and rotations
+			unsigned key = 1 << (Citrus_random(&client->state) % 8);
+			CitrusInputEncoder_add(&client->encoder, tick, key, key);
+			uint8_t *frame;
+			int n = CitrusInputEncoder_finish(&client->encoder,
+							  &frame);
+			client->sent_times[tick % SENT_TIMES] = loadgen_time();
+			if (send(client->fd, frame, n, MSG_NOSIGNAL) != n)
+				thread->errors++;
+			else
+				thread->bytes_sent += n;
+		}
+		deadline += interval;
+		uint64_t now;
+		while ((now = loadgen_time()) < deadline) {
+			int timeout = (deadline - now) / 1000000 + 1;
+			int n = epoll_wait(epoll_fd, events, 256, timeout);
+			now = loadgen_time();
+			for (int i = 0; i < n; i++) {
+				LoadgenClient *client =
+				    &thread->clients[events[i].data.u32];
+				loadgen_client_read(thread, client, now);
+			}
+		}
+	}
+	close(epoll_fd);
+	return NULL;
+}
+
+// returns the latency in microseconds below which a fraction of samples lie
+int loadgen_percentile(const uint64_t *histogram, uint64_t samples,
+		       double fraction)
+{
+	uint64_t target = samples * fraction;
+	uint64_t count = 0;
+	for (int i = 0; i < HISTOGRAM_SIZE; i++) {
+		count += histogram[i];
+		if (count > target)
+			return i;
+	}
+	return HISTOGRAM_SIZE;
+}
+
+int main(int argc, char **argv)
+{
+	int n_clients = 2000;
+	int lobby_capacity = 50;
+	int n_workers = sysconf(_SC_NPROCESSORS_ONLN);
+	int n_threads = 2;
+	int option;
+	while ((option = getopt(argc, argv, "c:l:w:j:s:p:")) != -1) {
+		switch (option) {
+		case 'c':
+			n_clients = atoi(optarg);
+			break;
+		case 'l':
+			lobby_capacity = atoi(optarg);
+			break;
+		case 'w':
+			n_workers = atoi(optarg);
+			break;
+		case 'j':
+			n_threads = atoi(optarg);
+			break;
+		case 's':
+			seconds = atoi(optarg);
+			break;
+		case 'p':
+			port = atoi(optarg);
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-c clients] "
+				"[-l clients per lobby] [-w workers] "
+				"[-j client threads] [-s seconds] [-p port]\n",
+				argv[0]);
+			return 1;
+		}
+	}
+	if (n_clients < 1 || lobby_capacity < 1 || n_workers < 1
+	    || n_threads < 1 || seconds < 1) {
+		fprintf(stderr, "%s: arguments must be positive\n", argv[0]);
+		return 1;
+	}
+
+	// both ends of every connection live in this process
+	max_fds = n_clients * 2 + 64;
+	struct rlimit limit;
+	getrlimit(RLIMIT_NOFILE, &limit);
+	limit.rlim_cur = limit.rlim_max;
+	setrlimit(RLIMIT_NOFILE, &limit);
+	if (limit.rlim_cur < (rlim_t) max_fds) {
+		fprintf(stderr, "%s: need %d file descriptors, limit is %llu\n",
+			argv[0], max_fds, (unsigned long long)limit.rlim_cur);
+		return 1;
+	}
+
+	CitrusServerConfig config;
+	config.n_workers = n_workers;
+	config.n_io_threads = 1;
+	config.n_lobbies = (n_clients + lobby_capacity - 1) / lobby_capacity;
+	config.lobby_capacity = lobby_capacity;
+	config.parser_buffer_size = PARSER_BUFFER_SIZE;
+	config.output_buffer_size = 256;
+	config.max_message_size = MESSAGE_SIZE;
+	config.ring_size = 1 << 22;
+	config.tick_rate = TICK_RATE;
+	config.pin_threads = false;
+	config.send = loadgen_send;
+	config.connect = loadgen_connect;
+	config.data = NULL;
+	games = calloc(config.n_lobbies * lobby_capacity, sizeof(LoadgenGame));
+	fd_lobbies = calloc(max_fds, sizeof(int));
+	LoadgenClient *clients = calloc(n_clients, sizeof(LoadgenClient));
+	LoadgenClientThread *threads = calloc(n_threads,
+					      sizeof(LoadgenClientThread));
+	if (!games || !fd_lobbies || !clients || !threads
+	    || !CitrusServer_init(&server, &config)) {
+		fprintf(stderr, "%s: out of memory\n", argv[0]);
+		return 1;
+	}
+
+	loadgen_listen();
+	if (!CitrusServer_start(&server)) {
+		fprintf(stderr, "%s: failed to start workers\n", argv[0]);
+		return 1;
+	}
+	pthread_t io_thread;
+	pthread_create(&io_thread, NULL, loadgen_server_io, NULL);
+	for (int i = 0; i < n_clients; i++) {
+		LoadgenClient *client = &clients[i];
+		client->fd = loadgen_dial();
+		CitrusInputEncoder_init(&client->encoder,
+					client->encoder_buffer,
+					ENCODER_BUFFER_SIZE, 0);
+		CitrusParser_init(&client->parser, client->parser_buffer,
+				  PARSER_BUFFER_SIZE);
+		client->state = i + 1;
+	}
+	printf("%d clients in %d lobbies, %d workers, %s sockets\n",
+	       n_clients, config.n_lobbies, n_workers,
+	       port ? "loopback tcp" : "unix");
+
+	// spread the clients evenly between the threads
+	uint64_t start = loadgen_time();
+	for (int i = 0; i < n_threads; i++) {
+		LoadgenClientThread *thread = &threads[i];
+		int first = (int64_t) n_clients * i / n_threads;
+		int last = (int64_t) n_clients * (i + 1) / n_threads;
+		thread->clients = clients + first;
+		thread->n_clients = last - first;
+		thread->histogram = calloc(HISTOGRAM_SIZE, sizeof(uint32_t));
+		if (!thread->histogram) {
+			fprintf(stderr, "%s: out of memory\n", argv[0]);
+			return 1;
+		}
+		pthread_create(&thread->thread, NULL, loadgen_client_run,
+			       thread);
+	}
+
+	uint64_t *histogram = calloc(HISTOGRAM_SIZE, sizeof(uint64_t));
+	uint64_t samples = 0;
+	uint64_t bytes_sent = 0;
+	uint64_t bytes_received = 0;
+	uint64_t errors = 0;
+	for (int i = 0; i < n_threads; i++) {
+		LoadgenClientThread *thread = &threads[i];
+		pthread_join(thread->thread, NULL);
+		for (int j = 0; j < HISTOGRAM_SIZE; j++)
+			histogram[j] += thread->histogram[j];
+		samples += thread->samples;
+		bytes_sent += thread->bytes_sent;
+		bytes_received += thread->bytes_received;
+		errors += thread->errors;
+	}
+	double elapsed = (loadgen_time() - start) / 1e9;
+	__atomic_store_n(&stopping, true, __ATOMIC_RELEASE);
+	pthread_join(io_thread, NULL);
+	CitrusServer_stop(&server);
+
+	uint64_t ticks = 0;
+	uint64_t late_ticks = 0;
+	uint64_t tick_ns_total = 0;
+	uint64_t tick_ns_max = 0;
+	for (int i = 0; i < n_workers; i++) {
+		CitrusServerWorker *worker = &server.workers[i];
+		ticks += worker->ticks;
+		late_ticks += worker->late_ticks;
+		tick_ns_total += worker->tick_ns_total;
+		if (worker->tick_ns_max > tick_ns_max)
+			tick_ns_max = worker->tick_ns_max;
+	}
+	printf("server ticks: %llu, late: %llu\n", (unsigned long long)ticks,
+	       (unsigned long long)late_ticks);
+	printf("server tick duration: mean %.1f us, max %.1f us, "
+	       "budget %.1f us\n", ticks ? tick_ns_total / 1e3 / ticks : 0.0,
+	       tick_ns_max / 1e3, 1e6 / TICK_RATE);
+	printf("server recv: %.2f MB/s, send: %.2f MB/s, short sends: %llu\n",
+	       server_bytes_received / elapsed / 1e6,
+	       server_bytes_sent / elapsed / 1e6,
+	       (unsigned long long)server_send_errors);
+	printf("clients sent: %.2f MB/s, received: %.2f MB/s, errors: %llu\n",
+	       bytes_sent / elapsed / 1e6, bytes_received / elapsed / 1e6,
+	       (unsigned long long)errors);
+	if (samples == 0)
+		printf("no inputs were acked\n");
+	else
+		printf("input to ack latency (%llu samples): p50 %d us, "
+		       "p99 %d us, p999 %d us\n", (unsigned long long)samples,
+		       loadgen_percentile(histogram, samples, 0.5),
+		       loadgen_percentile(histogram, samples, 0.99),
+		       loadgen_percentile(histogram, samples, 0.999));
+
+	for (int i = 0; i < n_clients; i++)
+		close(clients[i].fd);
+	close(listen_fd);
+	if (!port)
+		unlink(unix_address.sun_path);
+	CitrusServer_destroy(&server);
+	return 0;
+}
@@ -0,0 +1,378 @@
+/* Copyright (C) 2026 RZ781
+ *
+ * This file is part of libcitrus.
+ *
+ * libcitrus is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 2.1 of the License, or (at your option)
+ * any later version.
+ *
+ * libcitrus is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// Self-play harness for the bot. Games are played on every core, each
+// seeded with its index through CitrusBagRandomizer_init, so the results
+// of a seed are the same however many threads are used. Each thread owns
+// a range of seeds and steals half of another thread's remaining range
+// when it runs out.
+//
+// With -w, each seed is also played by a second bot with the given weights
+// and the two are compared, which can be used to check a change to the
+// bot or the scoring against the previous version.
+//
+// With -B, the bots play placements from an opening book made by bookgen
+// instead of searching when they can.
+//
+// usage: selfplay [-g games] [-j threads] [-p max pieces] [-b beam width]
+//                 [-d depth] [-s first seed] [-w height,holes,bumpiness]
+//                 [-B book] [-r]
+
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include "citrus.h"
+
+#define QUEUE_SIZE 5
+#define ARENA_SIZE (4 << 20)
+
+typedef struct {
+	int score;
+	int lines;
+	int pieces;
+	uint32_t checksum;	// final state of the game
+} SelfplayResult;
+
+typedef struct {
+	pthread_t thread;
+	int index;
+	// range of games left to play, which other threads can steal from
+	pthread_mutex_t lock;
+	int next;
+	int end;
+	CitrusBot bots[2];
+	CitrusArena arena;
+	uint8_t *arena_memory;
+	uint64_t pieces;
+	int games;
+	int steals;
+} SelfplayWorker;
+
+SelfplayWorker *workers;
+int n_workers;
+SelfplayResult *results[2];
+int n_players = 1;
+int max_pieces = 500;
+int first_seed = 0;
+
+// returns the current time in nanoseconds
+uint64_t selfplay_time(void)
+{
+	struct timespec time;
+	clock_gettime(CLOCK_MONOTONIC, &time);
+	return (uint64_t) time.tv_sec * 1000000000 + time.tv_nsec;
+}
+
+// plays a game until the bot tops out or reaches the piece limit
+void selfplay_play(SelfplayWorker *worker, int player, int seed,
+		   SelfplayResult *result)
+{
+	CitrusCell board[10 * 40];
+	const CitrusPiece *queue[QUEUE_SIZE];
+	CitrusBagRandomizer bag;
+	CitrusBagRandomizer_init(&bag, seed);
+	CitrusGameConfig config = citrus_preset_modern;
+	config.next_piece_queue_size = QUEUE_SIZE;
+	CitrusGame game;
+	CitrusGame_init(&game, board, queue, &config, &bag, NULL);
+	int pieces = 0;
+	while (game.alive && pieces < max_pieces) {
+		CitrusBotMove move;
+		// the bot only fails to find a move when every move tops out
+		if (!CitrusBot_plan(&worker->bots[player], &game,
+				    &worker->arena, &move))
+			break;
+		CitrusBotMove_apply(&move, &game);
+		pieces++;
+		while (game.alive && game.line_clear_delay > 0)
+			CitrusGame_tick(&game);
+	}
+	result->score = game.score;
+	result->lines = game.lines;
+	result->pieces = pieces;
+	result->checksum = CitrusGame_checksum(&game);
+	worker->pieces += pieces;
+}
+
+// takes the next game from a worker's own range
+bool selfplay_take(SelfplayWorker *worker, int *game)
+{
+	pthread_mutex_lock(&worker->lock);
+	bool found = worker->next < worker->end;
+	if (found)
+		*game = worker->next++;
+	pthread_mutex_unlock(&worker->lock);
+	return found;
+}
+
+// moves the back half of another worker's range into an empty worker
+bool selfplay_steal(SelfplayWorker *worker)
+{
+	for (int i = 1; i < n_workers; i++) {
+		SelfplayWorker *victim = &workers[(worker->index + i) %
+						  n_workers];
+		pthread_mutex_lock(&victim->lock);
+		int remaining = victim->end - victim->next;
+		int taken = (remaining + 1) / 2;
+		victim->end -= taken;
+		pthread_mutex_unlock(&victim->lock);
+		if (taken == 0)
+			continue;
+		pthread_mutex_lock(&worker->lock);
+		worker->next = victim->end;
+		worker->end = victim->end + taken;
+		pthread_mutex_unlock(&worker->lock);
+		worker->steals++;
+		return true;
+	}
+	return false;
+}
+
+// plays games until there are none left to take or steal
+void *selfplay_run(void *data)
+{
+	SelfplayWorker *worker = data;
+	int game;
+	for (;;) {
+		if (!selfplay_take(worker, &game) && !(selfplay_steal(worker)
+						       && selfplay_take(worker,
+									&game)))
+			break;
+		for (int player = 0; player < n_players; player++)
+			selfplay_play(worker, player, first_seed + game,
+				      &results[player][game]);
+		worker->games++;
+	}
+	return NULL;
+}
+
+// adds a value to an fnv-1a hash
+uint32_t selfplay_hash(uint32_t hash, uint32_t value)
+{
+	for (int i = 0; i < 4; i++) {
+		hash ^= value & 0xff;
+		hash *= 16777619;
+		value >>= 8;
+	}
+	return hash;
+}
+
+// compares ints for qsort
+int selfplay_compare(const void *a, const void *b)
+{
+	int x = *(const int *)a;
+	int y = *(const int *)b;
+	return (x > y) - (x < y);
+}
+
+// prints the score distribution of a player
+void selfplay_report(int player, int n_games, int *scores)
+{
+	uint64_t total = 0;
+	uint64_t lines = 0;
+	uint32_t hash = 2166136261;
+	for (int i = 0; i < n_games; i++) {
+		SelfplayResult *result = &results[player][i];
+		scores[i] = result->score;
+		total += result->score;
+		lines += result->lines;
+		hash = selfplay_hash(hash, result->checksum);
+	}
+	qsort(scores, n_games, sizeof(int), selfplay_compare);
+	printf("bot %c: mean score %.1f, mean lines %.1f\n", 'a' + player,
+	       (double)total / n_games, (double)lines / n_games);
+	printf("  score min %d p10 %d p50 %d p90 %d max %d\n", scores[0],
+	       scores[n_games / 10], scores[n_games / 2],
+	       scores[n_games * 9 / 10], scores[n_games - 1]);
+	printf("  results hash %08x\n", hash);
+}
+
+int main(int argc, char **argv)
+{
+	int n_games = 100;
+	int beam_width = 32;
+	int depth = 3;
+	bool print_results = false;
+	const char *book_path = NULL;
+	CitrusBotWeights weights = citrus_bot_default_weights;
+	n_workers = sysconf(_SC_NPROCESSORS_ONLN);
+	int option;
+	while ((option = getopt(argc, argv, "g:j:p:b:d:s:w:B:r")) != -1) {
+		switch (option) {
+		case 'g':
+			n_games = atoi(optarg);
+			break;
+		case 'j':
+			n_workers = atoi(optarg);
+			break;
+		case 'p':
+			max_pieces = atoi(optarg);
+			break;
+		case 'b':
+			beam_width = atoi(optarg);
+			break;
+		case 'd':
+			depth = atoi(optarg);
+			break;
+		case 's':
+			first_seed = atoi(optarg);
+			break;
+		case 'w':
+			if (sscanf(optarg, "%d,%d,%d", &weights.height,
+				   &weights.holes, &weights.bumpiness) != 3) {
+				fprintf(stderr, "%s: -w takes three weights\n",
+					argv[0]);
+				return 1;
+			}
+			n_players = 2;
+			break;
+		case 'B':
+			book_path = optarg;
+			break;
+		case 'r':
+			print_results = true;
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-g games] [-j threads] "
+				"[-p max pieces] [-b beam width] [-d depth] "
+				"[-s first seed] [-w height,holes,bumpiness] "
+				"[-B book] [-r]\n", argv[0]);
+			return 1;
+		}
+	}
+	if (n_games < 1 || n_workers < 1 || max_pieces < 1 || beam_width < 1
+	    || depth < 1) {
+		fprintf(stderr, "%s: arguments must be positive\n", argv[0]);
+		return 1;
+	}
+
+	// the book is read in place from a read only mapping
+	CitrusBook book;
+	if (book_path != NULL) {
+		int fd = open(book_path, O_RDONLY);
+		struct stat stat;
+		if (fd < 0 || fstat(fd, &stat) < 0) {
+			perror(book_path);
+			return 1;
+		}
+		void *data = mmap(NULL, stat.st_size, PROT_READ, MAP_PRIVATE,
+				  fd, 0);
+		close(fd);
+		if (data == MAP_FAILED
+		    || !CitrusBook_init(&book, data, stat.st_size)) {
+			fprintf(stderr, "%s: %s is not a valid book\n",
+				argv[0], book_path);
+			return 1;
+		}
+	}
+
+	workers = calloc(n_workers, sizeof(SelfplayWorker));
+	results[0] = calloc(n_games, sizeof(SelfplayResult));
+	results[1] = calloc(n_games, sizeof(SelfplayResult));
+	int *scores = calloc(n_games, sizeof(int));
+	if (!workers || !results[0] || !results[1] || !scores) {
+		fprintf(stderr, "%s: out of memory\n", argv[0]);
+		return 1;
+	}
+	for (int i = 0; i < n_workers; i++) {
+		SelfplayWorker *worker = &workers[i];
+		worker->index = i;
+		pthread_mutex_init(&worker->lock, NULL);
+		worker->next = (int64_t) n_games * i / n_workers;
+		worker->end = (int64_t) n_games * (i + 1) / n_workers;
+		for (int player = 0; player < 2; player++)
+			CitrusBot_init(&worker->bots[player], beam_width,
+				       depth);
+		worker->bots[1].weights = weights;
+		if (book_path != NULL)
+			for (int player = 0; player < 2; player++)
+				CitrusBot_set_book(&worker->bots[player],
+						   &book);
+		worker->arena_memory = malloc(ARENA_SIZE);
+		if (!worker->arena_memory) {
+			fprintf(stderr, "%s: out of memory\n", argv[0]);
+			return 1;
+		}
+		CitrusArena_init(&worker->arena, worker->arena_memory,
+				 ARENA_SIZE);
+	}
+
+	uint64_t start = selfplay_time();
+	for (int i = 1; i < n_workers; i++) {
+		if (pthread_create(&workers[i].thread, NULL, selfplay_run,
+				   &workers[i])) {
+			fprintf(stderr, "%s: failed to start threads\n",
+				argv[0]);
+			return 1;
+		}
+	}
+	selfplay_run(&workers[0]);
+	for (int i = 1; i < n_workers; i++)
+		pthread_join(workers[i].thread, NULL);
+	double seconds = (selfplay_time() - start) / 1e9;
+
+	uint64_t pieces = 0;
+	int steals = 0;
+	for (int i = 0; i < n_workers; i++) {
+		pieces += workers[i].pieces;
+		steals += workers[i].steals;
+	}
+	if (print_results) {
+		printf("seed");
+		for (int player = 0; player < n_players; player++)
+			printf("  score_%c  lines_%c  pieces_%c  checksum_%c",
+			       'a' + player, 'a' + player, 'a' + player,
+			       'a' + player);
+		printf("\n");
+		for (int i = 0; i < n_games; i++) {
+			printf("%d", first_seed + i);
+			for (int player = 0; player < n_players; player++) {
+				SelfplayResult *result = &results[player][i];
+				printf("  %7d  %7d  %8d  %08x", result->score,
+				       result->lines, result->pieces,
+				       result->checksum);
+			}
+			printf("\n");
+		}
+	}
+	printf("%d games on %d threads in %.2fs, %d steals\n", n_games,
+	       n_workers, seconds, steals);
+	printf("%.1f pieces/s, %.2f games/s\n", pieces / seconds,
+	       n_games * n_players / seconds);
+	for (int player = 0; player < n_players; player++)
+		selfplay_report(player, n_games, scores);
+	if (n_players == 2) {
+		int wins[3] = { 0, 0, 0 };
+		for (int i = 0; i < n_games; i++) {
+			int a = results[0][i].score;
+			int b = results[1][i].score;
+			wins[a > b ? 0 : a < b ? 1 : 2]++;
+		}
+		printf("bot a won %d, bot b won %d, %d draws\n", wins[0],
+		       wins[1], wins[2]);
+	}
+	return 0;
+}
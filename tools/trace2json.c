@@ -0,0 +1,75 @@
+/* Copyright (C) 2026 RZ781
+ *
+ * This file is part of libcitrus.
+ *
+ * libcitrus is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 2.1 of the License, or (at your option)
+ * any later version.
+ *
+ * libcitrus is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// Converts trace records copied by CitrusTracer_copy and written to a file
+// into the Chrome trace event format, which can be opened in chrome://tracing
+// or Perfetto. Lobby events go on thread 0 and each slot's events go on the
+// thread with the slot's index plus one. Times are assumed to be in
+// nanoseconds.
+//
+// usage: trace2json [records file] > trace.json
+
+#include <stdio.h>
+#include <string.h>
+#include "citrus.h"
+
+// names of each CitrusTraceName
+const char *const trace_names[] = {
+	"tick", "recv", "parse", "lock", "send", "line clear", "top out"
+};
+
+// chrome trace phases for each CitrusTracePhase
+const char trace_phases[] = { 'B', 'E', 'i' };
+
+int main(int argc, char **argv)
+{
+	FILE *file = stdin;
+	if (argc > 1 && strcmp(argv[1], "-") != 0) {
+		file = fopen(argv[1], "rb");
+		if (file == NULL) {
+			perror(argv[1]);
+			return 1;
+		}
+	}
+	printf("{\"traceEvents\":[\n");
+	CitrusTraceRecord record;
+	bool first = true;
+	uint64_t start = 0;
+	while (fread(&record, sizeof(record), 1, file) == 1) {
+		if (record.name > CITRUS_TRACE_TOP_OUT
+		    || record.phase > CITRUS_TRACE_INSTANT) {
+			fprintf(stderr, "%s: invalid record\n", argv[0]);
+			return 1;
+		}
+		// timestamps are shown relative to the first record
+		if (first) {
+			start = record.time;
+		}
+		printf("%s{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,"
+		       "\"pid\":0,\"tid\":%d", first ? "" : ",\n",
+		       trace_names[record.name], trace_phases[record.phase],
+		       (record.time - start) / 1000.0, record.id + 1);
+		if (record.phase == CITRUS_TRACE_INSTANT) {
+			printf(",\"s\":\"t\"");
+		}
+		printf(",\"args\":{\"value\":%d}}", record.arg);
+		first = false;
+	}
+	printf("\n],\"displayTimeUnit\":\"ns\"}\n");
+	return 0;
+}